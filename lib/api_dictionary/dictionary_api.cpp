@@ -1,4 +1,6 @@
 #include "dictionary_api.h"
+#include "core_eventing/connectivity_state.h"
+#include "core_eventing/event_recorder.h"
 #include "core_misc/log.h"
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
@@ -9,9 +11,15 @@ namespace dict {
 
 static const char *TAG = "DictionaryApi";
 
+// Clip codec asked for with &format=; empty keeps the server default (MP3).
+// Opus at speech bitrates is several times smaller, which matters on slow WiFi.
+#ifndef DICT_AUDIO_FORMAT
+#define DICT_AUDIO_FORMAT ""
+#endif
+
 DictionaryApi::DictionaryApi()
     : hostname_("dict.liusida.com"), baseUrl_("https://dict.liusida.com/api/define"), audioBaseUrl_("https://dict.liusida.com/api/audio/stream"),
-      initialized_(false), prewarmTaskHandle_(nullptr) {}
+      audioFormat_(DICT_AUDIO_FORMAT), initialized_(false), prewarmTaskHandle_(nullptr) {}
 
 DictionaryApi::~DictionaryApi() {
   shutdown();
@@ -38,14 +46,10 @@ void DictionaryApi::shutdown() {
   initialized_ = false;
 }
 
-bool DictionaryApi::isReady() const { return initialized_ && WiFi.status() == WL_CONNECTED; }
+// WiFi up means associated and the clock set, so HTTPS can verify the server
+bool DictionaryApi::isReady() const { return initialized_ && ConnectivityState::instance().isUp(ConnectivityEvent::WiFi); }
 
 DictionaryResult DictionaryApi::lookupWord(const String &inWord) {
-  if (!isReady()) {
-    ESP_LOGW(TAG, "Service not ready (WiFi not connected)");
-    return DictionaryResult();
-  }
-
   String word = inWord;
   word.trim();
 
@@ -55,13 +59,34 @@ DictionaryResult DictionaryApi::lookupWord(const String &inWord) {
     return DictionaryResult();
   }
 
+  // A replayed run is answered from its trace: no network needed, and identical content every time
+  String payload;
+  if (EventRecorder::instance().replayResponse(word, payload)) {
+    ESP_LOGI(TAG, "Looking up word: %s (replayed)", word.c_str());
+    return parseDefinition(payload);
+  }
+
+  if (!isReady()) {
+    ESP_LOGW(TAG, "Service not ready (WiFi not connected)");
+    return DictionaryResult();
+  }
+
+  payload = fetchDefinition(word);
+  if (payload.length() == 0) {
+    return DictionaryResult();
+  }
+  EventRecorder::instance().recordResponse(word, payload);
+  return parseDefinition(payload);
+}
+
+String DictionaryApi::fetchDefinition(const String &word) {
   ESP_LOGI(TAG, "Looking up word: %s", word.c_str());
 
   // Build JSON body
   JsonDocument *doc = (JsonDocument *)ps_malloc(sizeof(JsonDocument)); // save some SRAM by using ps_malloc
   if (!doc) {
     ESP_LOGE(TAG, "Failed to allocate JSON doc in PSRAM");
-    return DictionaryResult();
+    return String();
   }
   new (doc) JsonDocument();
   (*doc)["word"] = word;
@@ -77,7 +102,7 @@ DictionaryResult DictionaryApi::lookupWord(const String &inWord) {
 
   if (!https.begin(client, baseUrl_.c_str())) {
     ESP_LOGE(TAG, "https.begin failed");
-    return DictionaryResult();
+    return String();
   }
 
   https.addHeader("Content-Type", "application/json");
@@ -91,7 +116,7 @@ DictionaryResult DictionaryApi::lookupWord(const String &inWord) {
     client1.setInsecure();
     if (!https.begin(client1, baseUrl_.c_str())) {
       ESP_LOGE(TAG, "https.begin failed");
-      return DictionaryResult();
+      return String();
     }
 
     https.addHeader("Content-Type", "application/json");
@@ -99,14 +124,14 @@ DictionaryResult DictionaryApi::lookupWord(const String &inWord) {
     if (httpCode <= 0) {
       ESP_LOGE(TAG, "POST failed (2): %s", https.errorToString(httpCode).c_str());
       https.end();
-      return DictionaryResult();
+      return String();
     }
   }
 
   if (httpCode != HTTP_CODE_OK) {
     ESP_LOGW(TAG, "HTTP %d", httpCode);
     https.end();
-    return DictionaryResult();
+    return String();
   }
 
   String payload = https.getString();
@@ -115,9 +140,11 @@ DictionaryResult DictionaryApi::lookupWord(const String &inWord) {
   ESP_LOGD(TAG, "Payload: %s", payload.c_str());
   if (payload.length() == 0) {
     ESP_LOGE(TAG, "Payload is empty");
-    return DictionaryResult();
   }
+  return payload;
+}
 
+DictionaryResult DictionaryApi::parseDefinition(const String &payload) {
   JsonDocument *resp = (JsonDocument *)ps_malloc(sizeof(JsonDocument));
   if (!resp) {
     ESP_LOGE(TAG, "Failed to allocate response JSON in PSRAM");
@@ -206,6 +233,9 @@ AudioUrl DictionaryApi::getAudioUrl(const String &inWord, const String &audioTyp
   }
 
   String url = audioBaseUrl_ + "?word=" + encodedWord + "&type=" + encodedAudioType;
+  if (audioFormat_.length() > 0) {
+    url += "&format=" + urlEncode(audioFormat_);
+  }
   ESP_LOGD(TAG, "Generated audio URL: %s", url.c_str());
 
   return AudioUrl(url, audioType, true);
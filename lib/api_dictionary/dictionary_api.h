@@ -49,9 +49,11 @@ public:
   bool isReady() const; // Check if the API client is ready (WiFi connected)
 
   // Main functionality methods
-  DictionaryResult lookupWord(const String &word);                   // Look up a word in the dictionary
-  AudioUrl getAudioUrl(const String &word, const String &audioType); // Get audio URL for a word
-  void prewarm();                                                    // Prewarm the API client
+  DictionaryResult lookupWord(const String &word);                     // Look up a word in the dictionary
+  AudioUrl getAudioUrl(const String &word, const String &audioType);   // Get audio URL for a word
+  void setAudioFormat(const String &format) { audioFormat_ = format; } // Clip codec to request ("opus"); empty for the server default
+  const String &getAudioFormat() const { return audioFormat_; }        // Clip codec requested in audio URLs
+  void prewarm();                                                      // Prewarm the API client
   bool isPrewarmRunning() const { return prewarmTaskHandle_ != nullptr; }
 
   // Helper methods (public for testing)
@@ -63,11 +65,15 @@ private:
   String hostname_;
   String baseUrl_;
   String audioBaseUrl_;
+  String audioFormat_;
   bool initialized_;
 
   // Async prewarm task
   TaskHandle_t prewarmTaskHandle_;
 
+  String fetchDefinition(const String &word);              // POST the lookup; response body, or "" on failure
+  DictionaryResult parseDefinition(const String &payload); // Response JSON to a result
+
   // Static task function for async prewarm
   static void prewarmTask(void *parameter);
 };
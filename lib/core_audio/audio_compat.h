@@ -0,0 +1,37 @@
+#pragma once
+// Portable audio pipeline stages build both for the device and for the host
+// (PlatformIO native env). This header is the only place that differs.
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include "common.h"
+#include "core_misc/log.h"
+
+namespace dict {
+inline uint32_t audioMillis() { return millis(); }
+inline uint32_t audioMicros() { return micros(); }
+} // namespace dict
+
+#else
+#include <chrono>
+#include <stdio.h>
+
+namespace dict {
+inline uint32_t audioMicros() {
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t audioMillis() {
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+} // namespace dict
+
+#ifndef ESP_LOGI
+#define ESP_LOGE(tag, format, ...) printf("[E][%s] " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("[W][%s] " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) printf("[I][%s] " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)
+#endif
+
+#endif
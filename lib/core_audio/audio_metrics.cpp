@@ -0,0 +1,106 @@
+#include "audio_metrics.h"
+
+namespace dict {
+
+static const char *TAG = "AudioMetrics";
+
+const uint32_t AudioMetrics::DECODE_BUCKET_LIMITS_US[DECODE_BUCKETS - 1] = {500, 1000, 2000, 4000, 8000, 16000, 32000};
+
+static const uint32_t FILL_SAMPLE_INTERVAL_MS = 100;
+static const uint32_t UNDERRUN_GAP_MS = 100; // longer than the I2S DMA buffers can cover
+
+void AudioMetrics::onClipStart() {
+  clipStartMs_ = audioMillis();
+  waitingFirstSample_ = true;
+  decodedSinceStart_ = false;
+  markDecodeStart();
+}
+
+void AudioMetrics::onClipEnd(size_t bytesFetched) {
+  clips_++;
+  lastClipBytes_ = bytesFetched;
+  totalBytes_ += bytesFetched;
+  waitingFirstSample_ = false;
+}
+
+void AudioMetrics::onPcmWrite(size_t bytes) {
+  if (bytes == 0) {
+    return;
+  }
+  lastPcmMs_ = audioMillis();
+  inUnderrun_ = false;
+  decodedSinceStart_ = true;
+
+  uint32_t elapsed = audioMicros() - decodeStartUs_;
+  int bucket = 0;
+  while (bucket < DECODE_BUCKETS - 1 && elapsed >= DECODE_BUCKET_LIMITS_US[bucket]) {
+    bucket++;
+  }
+  decodeHist_[bucket]++;
+  if (elapsed > maxDecodeUs_) {
+    maxDecodeUs_ = elapsed;
+  }
+}
+
+void AudioMetrics::onOutputWrite(size_t bytes) {
+  if (bytes > 0 && waitingFirstSample_ && decodedSinceStart_) {
+    ttfsMs_ = audioMillis() - clipStartMs_;
+    waitingFirstSample_ = false;
+  }
+}
+
+void AudioMetrics::markDecodeStart() { decodeStartUs_ = audioMicros(); }
+
+void AudioMetrics::checkUnderrun() {
+  if (waitingFirstSample_ || inUnderrun_) {
+    return;
+  }
+  if (audioMillis() - lastPcmMs_ > UNDERRUN_GAP_MS) {
+    underruns_++;
+    inUnderrun_ = true;
+  }
+}
+
+void AudioMetrics::sampleBufferFill(size_t bytes) {
+  uint32_t now = audioMillis();
+  if (now - lastFillSampleMs_ < FILL_SAMPLE_INTERVAL_MS) {
+    return;
+  }
+  lastFillSampleMs_ = now;
+  fillSamples_[fillHead_] = bytes > 0xFFFF ? 0xFFFF : bytes;
+  fillHead_ = (fillHead_ + 1) % FILL_SAMPLES;
+  if (fillCount_ < FILL_SAMPLES) {
+    fillCount_++;
+  }
+}
+
+void AudioMetrics::reset() { *this = AudioMetrics(); }
+
+void AudioMetrics::print() const {
+  ESP_LOGI(TAG, "=== Audio Metrics ===");
+  ESP_LOGI(TAG, "Clips: %u, bytes last clip: %u, total: %u", clips_, (unsigned)lastClipBytes_, (unsigned)totalBytes_);
+  ESP_LOGI(TAG, "Time to first sample (last clip): %u ms", ttfsMs_);
+  ESP_LOGI(TAG, "Underruns: %u, stalls: %u", underruns_, stalls_);
+
+  ESP_LOGI(TAG, "Decode time per frame (max %u us):", maxDecodeUs_);
+  for (int i = 0; i < DECODE_BUCKETS; i++) {
+    if (i < DECODE_BUCKETS - 1) {
+      ESP_LOGI(TAG, "  < %5u us: %u", DECODE_BUCKET_LIMITS_US[i], decodeHist_[i]);
+    } else {
+      ESP_LOGI(TAG, "  >=%5u us: %u", DECODE_BUCKET_LIMITS_US[i - 1], decodeHist_[i]);
+    }
+  }
+
+  // Oldest to newest, one sample per 100 ms while playing
+  char line[FILL_SAMPLES * 7 + 1];
+  int pos = 0;
+  for (int i = 0; i < fillCount_; i++) {
+    int idx = (fillHead_ + FILL_SAMPLES - fillCount_ + i) % FILL_SAMPLES;
+    pos += snprintf(line + pos, sizeof(line) - pos, "%u ", fillSamples_[idx]);
+  }
+  line[pos] = '\0';
+  ESP_LOGI(TAG, "Buffered ahead of the decoder (bytes): %s", fillCount_ > 0 ? line : "-");
+  ESP_LOGI(TAG, "=====================");
+}
+
+} // namespace dict
@@ -0,0 +1,107 @@
+#pragma once
+#include "AudioTools.h"
+#include "audio_compat.h"
+
+namespace dict {
+
+/**
+ * @brief Runtime counters for the audio pipeline
+ *
+ * Fed by AudioManager and MeteredOutput; read with AudioManager::getMetrics()
+ * or dumped to the log with print() (F1).
+ */
+class AudioMetrics {
+public:
+  static const int DECODE_BUCKETS = 8;
+  static const int FILL_SAMPLES = 32;
+  static const uint32_t DECODE_BUCKET_LIMITS_US[DECODE_BUCKETS - 1]; // upper bounds, last bucket is open
+
+  // Pipeline hooks
+  void onClipStart();                  // play() or a queued clip was started
+  void onClipEnd(size_t bytesFetched); // Clip finished, stopped or skipped
+  void onPcmWrite(size_t bytes);       // Decoder handed a frame of PCM to the output stages
+  void onOutputWrite(size_t bytes);    // PCM reached the board output (after format, stretch and mixer)
+  void markDecodeStart();              // Encoded bytes go to the decoder now, or it is back from passing a frame on
+  void sampleBufferFill(size_t bytes); // Bytes received but not yet decoded (read-ahead + socket)
+  void checkUnderrun();                // Call while a clip is mid-body; counts gaps in PCM output
+  void onStall() { stalls_++; }        // Stream stalled and had to be resumed
+
+  // Getters
+  uint32_t getTimeToFirstSampleMs() const { return ttfsMs_; } // Last clip: start -> its first PCM at the board output
+  uint32_t getDecodeHistogram(int bucket) const { return bucket >= 0 && bucket < DECODE_BUCKETS ? decodeHist_[bucket] : 0; }
+  uint32_t getMaxDecodeUs() const { return maxDecodeUs_; }
+  uint32_t getUnderruns() const { return underruns_; }
+  uint32_t getStalls() const { return stalls_; }
+  uint32_t getClips() const { return clips_; }
+  size_t getLastClipBytes() const { return lastClipBytes_; }
+  size_t getTotalBytes() const { return totalBytes_; }
+
+  void reset();
+  void print() const;
+
+private:
+  uint32_t clipStartMs_ = 0;
+  bool waitingFirstSample_ = false;
+  bool decodedSinceStart_ = false; // mixer writes before the clip's first frame are not its first sample
+  uint32_t ttfsMs_ = 0;
+
+  uint32_t decodeStartUs_ = 0;
+  uint32_t decodeHist_[DECODE_BUCKETS] = {};
+  uint32_t maxDecodeUs_ = 0;
+
+  uint16_t fillSamples_[FILL_SAMPLES] = {};
+  uint8_t fillHead_ = 0;
+  uint8_t fillCount_ = 0;
+  uint32_t lastFillSampleMs_ = 0;
+
+  uint32_t lastPcmMs_ = 0;
+  bool inUnderrun_ = false;
+  uint32_t underruns_ = 0;
+  uint32_t stalls_ = 0;
+  uint32_t clips_ = 0;
+  size_t lastClipBytes_ = 0;
+  size_t totalBytes_ = 0;
+};
+
+/**
+ * @brief Pass-through output stage that feeds AudioMetrics
+ *
+ * Two taps. Decoder sits directly on the decoder output, ahead of the gain,
+ * time-stretch, format and UI mixer stages: each write is one decoded frame.
+ * Its decode time runs from the later of markDecodeStart() calls (bytes handed
+ * to the decoder, or the previous frame's write coming back) to this write, so
+ * it leaves out network reads, task waits and the stages downstream. Board sits
+ * in front of the board output and ends the time to first sample once the
+ * clip's PCM has made it through every stage.
+ */
+class MeteredOutput : public AudioStream {
+public:
+  enum Tap : uint8_t { Decoder, Board };
+
+  MeteredOutput(AudioStream &out, AudioMetrics &metrics, Tap tap = Decoder) : out_(out), metrics_(metrics), tap_(tap) {}
+
+  bool begin() override { return true; } // the board output is started by AudioManager
+  void end() override {}
+  void setAudioInfo(AudioInfo newInfo) override {
+    AudioStream::setAudioInfo(newInfo);
+    out_.setAudioInfo(newInfo);
+  }
+  int availableForWrite() override { return out_.availableForWrite(); }
+  size_t write(const uint8_t *data, size_t len) override {
+    if (tap_ == Board) {
+      metrics_.onOutputWrite(len);
+      return out_.write(data, len);
+    }
+    metrics_.onPcmWrite(len);
+    size_t result = out_.write(data, len);
+    metrics_.markDecodeStart();
+    return result;
+  }
+
+private:
+  AudioStream &out_;
+  AudioMetrics &metrics_;
+  Tap tap_;
+};
+
+} // namespace dict
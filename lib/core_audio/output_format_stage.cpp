@@ -0,0 +1,99 @@
+#include "output_format_stage.h"
+
+namespace dict {
+
+static const char *TAG = "OutputFormat";
+
+// Rates with ES8311 clock coefficients for our MCLK; everything MP3 can carry except 12 kHz
+static const uint32_t CODEC_RATES[] = {8000, 11025, 16000, 22050, 24000, 32000, 44100, 48000};
+
+uint32_t OutputFormatStage::codecRateFor(uint32_t rate) {
+  for (uint32_t codecRate : CODEC_RATES) {
+    if (codecRate >= rate) {
+      return codecRate; // exact match, or the next one up so we only ever upsample
+    }
+  }
+  return CODEC_RATES[sizeof(CODEC_RATES) / sizeof(CODEC_RATES[0]) - 1];
+}
+
+void OutputFormatStage::setAudioInfo(AudioInfo newInfo) {
+  if (configured_ && newInfo.sample_rate == in_.sample_rate && newInfo.channels == in_.channels &&
+      newInfo.bits_per_sample == in_.bits_per_sample) {
+    return; // same format as the previous clip, keep the link running
+  }
+  AudioStream::setAudioInfo(newInfo);
+  in_ = newInfo;
+  configured_ = true;
+
+  AudioInfo target = newInfo;
+  if (newInfo.bits_per_sample == 16) {
+    target.sample_rate = codecRateFor(newInfo.sample_rate);
+    if (newInfo.channels < linkChannels_) {
+      target.channels = linkChannels_;
+    }
+  } else {
+    ESP_LOGW(TAG, "%d-bit PCM, passing through unconverted", newInfo.bits_per_sample);
+  }
+  upmix_ = newInfo.channels == 1 && target.channels == 2;
+  resampler_.begin(newInfo.sample_rate, target.sample_rate, newInfo.channels);
+
+  ESP_LOGI(TAG, "Stream %d Hz/%d ch -> output %d Hz/%d ch%s%s", newInfo.sample_rate, newInfo.channels, target.sample_rate, target.channels,
+           resampler_.isActive() ? ", resampling" : "", upmix_ ? ", upmixing" : "");
+
+  if (target.sample_rate != out_.sample_rate || target.channels != out_.channels || target.bits_per_sample != out_.bits_per_sample) {
+    out_ = target;
+    next_.setAudioInfo(out_); // reconfigures I2S and the codec
+  }
+}
+
+size_t OutputFormatStage::write(const uint8_t *data, size_t len) {
+  if (!isConverting() || in_.bits_per_sample != 16) {
+    return next_.write(data, len);
+  }
+
+  const int16_t *in = reinterpret_cast<const int16_t *>(data);
+  size_t frames = len / (sizeof(int16_t) * in_.channels);
+
+  if (!resampler_.isActive()) {
+    for (size_t done = 0; done < frames; done += BLOCK_FRAMES) {
+      size_t n = frames - done < BLOCK_FRAMES ? frames - done : BLOCK_FRAMES;
+      writeAll(in + done, n, 1);
+    }
+    return len;
+  }
+
+  while (frames > 0) {
+    size_t consumed = 0;
+    size_t produced = resampler_.process(in, frames, resampled_, BLOCK_FRAMES, consumed);
+    writeAll(resampled_, produced, in_.channels);
+    in += consumed * in_.channels;
+    frames -= consumed;
+    if (produced == 0 && consumed == 0) {
+      break;
+    }
+  }
+  return len;
+}
+
+void OutputFormatStage::writeAll(const int16_t *samples, size_t frames, uint8_t channels) {
+  if (frames == 0) {
+    return;
+  }
+  if (upmix_ && channels == 1) {
+    upmixMonoToStereo(samples, upmixed_, frames);
+    samples = upmixed_;
+    channels = 2;
+  }
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(samples);
+  size_t remaining = frames * channels * sizeof(int16_t);
+  while (remaining > 0) {
+    size_t n = next_.write(bytes, remaining);
+    if (n == 0) {
+      break; // output closed
+    }
+    bytes += n;
+    remaining -= n;
+  }
+}
+
+} // namespace dict
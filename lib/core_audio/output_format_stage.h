@@ -0,0 +1,48 @@
+#pragma once
+#include "AudioTools.h"
+#include "audio_compat.h"
+#include "pcm_convert.h"
+
+namespace dict {
+
+/**
+ * @brief Keeps the output at the decoded stream's own format where the codec allows it
+ *
+ * On every format notification from the decoder the next stage (and through it
+ * the ES8311/I2S) is reconfigured to the stream's native sample rate. Only when
+ * the codec can't run a rate, or the I2S link needs more channels than the
+ * stream has, is the PCM converted, using the fixed-point kernels in pcm_convert.h.
+ * Expects 16-bit samples and whole frames per write (what the decoders produce).
+ */
+class OutputFormatStage : public AudioStream {
+public:
+  static const size_t BLOCK_FRAMES = 256;
+
+  OutputFormatStage(AudioStream &next, uint8_t linkChannels) : next_(next), linkChannels_(linkChannels) {}
+
+  bool begin() override { return true; }
+  void end() override { configured_ = false; }
+  void setAudioInfo(AudioInfo newInfo) override;
+  int availableForWrite() override { return next_.availableForWrite(); }
+  size_t write(const uint8_t *data, size_t len) override;
+
+  AudioInfo outputInfo() const { return out_; }                         // Format the next stage runs at
+  bool isConverting() const { return upmix_ || resampler_.isActive(); } // Any per-sample work
+  static uint32_t codecRateFor(uint32_t rate);                          // Closest rate the codec can run
+
+private:
+  AudioStream &next_;
+  uint8_t linkChannels_;
+  bool configured_ = false;
+  AudioInfo in_;
+  AudioInfo out_;
+  bool upmix_ = false;
+  LinearResampler resampler_;
+
+  alignas(4) int16_t resampled_[BLOCK_FRAMES * 2];
+  alignas(4) int16_t upmixed_[BLOCK_FRAMES * 2];
+
+  void writeAll(const int16_t *samples, size_t frames, uint8_t channels);
+};
+
+} // namespace dict
@@ -0,0 +1,109 @@
+#include "pcm_convert.h"
+#include <string.h>
+
+namespace dict {
+
+static inline int16_t lerp(int16_t a, int16_t b, uint32_t frac) {
+  // frac is Q16; drop one bit so (b - a) * frac stays within int32
+  return (int16_t)(a + (((int32_t)(b - a) * (int32_t)(frac >> 1)) >> 15));
+}
+
+void upmixMonoToStereoReference(const int16_t *in, int16_t *out, size_t frames) {
+  for (size_t i = 0; i < frames; i++) {
+    out[2 * i] = in[i];
+    out[2 * i + 1] = in[i];
+  }
+}
+
+void upmixMonoToStereo(const int16_t *in, int16_t *out, size_t frames) {
+  // One 32-bit store per output frame, four frames per iteration.
+  // Runs back to front so in and out may share a buffer.
+  uint32_t *out32 = reinterpret_cast<uint32_t *>(out);
+  size_t i = frames;
+  while (i >= 4) {
+    i -= 4;
+    uint32_t s0 = (uint16_t)in[i], s1 = (uint16_t)in[i + 1], s2 = (uint16_t)in[i + 2], s3 = (uint16_t)in[i + 3];
+    out32[i + 3] = s3 | (s3 << 16);
+    out32[i + 2] = s2 | (s2 << 16);
+    out32[i + 1] = s1 | (s1 << 16);
+    out32[i] = s0 | (s0 << 16);
+  }
+  while (i > 0) {
+    i--;
+    uint32_t s = (uint16_t)in[i];
+    out32[i] = s | (s << 16);
+  }
+}
+
+void LinearResampler::begin(uint32_t inRate, uint32_t outRate, uint8_t channels) {
+  step_ = outRate > 0 ? (uint32_t)(((uint64_t)inRate << 16) / outRate) : 0;
+  pos_ = 1u << 16; // first output frame lands exactly on in[0]
+  channels_ = channels > 1 ? 2 : 1;
+  prev_[0] = prev_[1] = 0;
+}
+
+size_t LinearResampler::process(const int16_t *in, size_t inFrames, int16_t *out, size_t outCapacity, size_t &inConsumed) {
+  size_t written = 0;
+  uint32_t pos = pos_;
+  const uint32_t step = step_;
+
+  if (channels_ == 1) {
+    while (written < outCapacity) {
+      uint32_t idx = pos >> 16;
+      if (idx >= inFrames) {
+        break; // need in[idx] as the right-hand sample
+      }
+      int16_t a = idx == 0 ? prev_[0] : in[idx - 1];
+      out[written++] = lerp(a, in[idx], pos & 0xFFFF);
+      pos += step;
+    }
+  } else {
+    while (written < outCapacity) {
+      uint32_t idx = pos >> 16;
+      if (idx >= inFrames) {
+        break;
+      }
+      const int16_t *a = idx == 0 ? prev_ : &in[2 * (idx - 1)];
+      const int16_t *b = &in[2 * idx];
+      uint32_t frac = pos & 0xFFFF;
+      out[2 * written] = lerp(a[0], b[0], frac);
+      out[2 * written + 1] = lerp(a[1], b[1], frac);
+      written++;
+      pos += step;
+    }
+  }
+
+  // Everything left of the read position is done; keep the last of it as prev_
+  size_t consumed = pos >> 16;
+  if (consumed > inFrames) {
+    consumed = inFrames;
+  }
+  if (consumed > 0) {
+    memcpy(prev_, &in[channels_ * (consumed - 1)], channels_ * sizeof(int16_t));
+    pos -= (uint32_t)consumed << 16;
+  }
+  pos_ = pos;
+  inConsumed = consumed;
+  return written;
+}
+
+size_t LinearResampler::processReference(const int16_t *in, size_t inFrames, int16_t *out, size_t outCapacity, uint32_t inRate, uint32_t outRate,
+                                         uint8_t channels) {
+  uint32_t step = (uint32_t)(((uint64_t)inRate << 16) / outRate);
+  size_t written = 0;
+  for (uint64_t pos = 1u << 16; written < outCapacity; pos += step) {
+    uint64_t idx = pos >> 16;
+    if (idx >= inFrames) {
+      break;
+    }
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      int16_t a = idx == 0 ? 0 : in[channels * (idx - 1) + ch];
+      int16_t b = in[channels * idx + ch];
+      out[channels * written + ch] = lerp(a, b, (uint32_t)(pos & 0xFFFF));
+    }
+    written++;
+  }
+  return written;
+}
+
+} // namespace dict
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dict {
+
+/**
+ * @brief Fixed-point PCM format conversion (16-bit interleaved)
+ *
+ * Each kernel has a plain scalar reference (*Reference) that the host tests
+ * compare the optimized version against bit for bit.
+ */
+
+// Mono -> stereo by duplicating each sample. out must hold 2 * frames samples.
+void upmixMonoToStereo(const int16_t *in, int16_t *out, size_t frames);
+void upmixMonoToStereoReference(const int16_t *in, int16_t *out, size_t frames);
+
+/**
+ * @brief Streaming linear-interpolation resampler
+ *
+ * The read position is kept in Q16.16 and advanced by inRate/outRate per output
+ * frame; the last input frame of each block is carried over so blocks of any
+ * size give the same output as converting the whole clip at once.
+ */
+class LinearResampler {
+public:
+  void begin(uint32_t inRate, uint32_t outRate, uint8_t channels); // Reset state for a new stream
+  bool isActive() const { return step_ != 0 && step_ != (1u << 16); }
+
+  // Convert as much of in as fits in out; returns frames written, inConsumed = input frames used
+  size_t process(const int16_t *in, size_t inFrames, int16_t *out, size_t outCapacity, size_t &inConsumed);
+
+  // Whole-buffer reference with the same arithmetic; returns frames written
+  static size_t processReference(const int16_t *in, size_t inFrames, int16_t *out, size_t outCapacity, uint32_t inRate, uint32_t outRate,
+                                 uint8_t channels);
+
+private:
+  uint32_t step_ = 0;  // input frames per output frame, Q16.16
+  uint32_t pos_ = 0;   // read position, Q16.16; index 0 is prev_, index 1 is in[0]
+  uint8_t channels_ = 1;
+  int16_t prev_[2] = {0, 0};
+};
+
+} // namespace dict
@@ -0,0 +1,174 @@
+#include "pcm_dsp.h"
+#include <string.h>
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define DSP_USE_PIE 1
+#else
+#define DSP_USE_PIE 0
+#endif
+
+namespace dict {
+
+static inline int16_t saturate16(int32_t x) { return x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t)x); }
+
+// ================================ REFERENCE ================================
+void scaleQ15Reference(int16_t *samples, size_t count, int16_t gain) {
+  for (size_t i = 0; i < count; i++) {
+    samples[i] = (int16_t)(((int32_t)samples[i] * gain) >> 15);
+  }
+}
+
+void mixSaturateReference(const int16_t *a, const int16_t *b, int16_t *out, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = saturate16((int32_t)a[i] + b[i]);
+  }
+}
+
+// ================================== PIE ===================================
+#if DSP_USE_PIE
+static inline bool isAligned16(const void *p) { return ((uintptr_t)p & 15) == 0; }
+
+// 8 samples per iteration: q1 holds the gain in every lane, vmul shifts by SAR (15)
+static void scaleQ15Pie(int16_t *samples, size_t blocks, int16_t gain) {
+  alignas(16) int16_t gains[8] = {gain, gain, gain, gain, gain, gain, gain, gain};
+  int16_t *src = samples;
+  int16_t *dst = samples;
+  int16_t *gp = gains;
+  asm volatile("wsr.sar %[shift]\n"
+               "ee.vld.128.ip q1, %[gp], 0\n"
+               "1:\n"
+               "ee.vld.128.ip q0, %[src], 16\n"
+               "ee.vmul.s16 q2, q0, q1\n"
+               "ee.vst.128.ip q2, %[dst], 16\n"
+               "addi %[n], %[n], -1\n"
+               "bnez %[n], 1b\n"
+               : [src] "+r"(src), [dst] "+r"(dst), [n] "+r"(blocks), [gp] "+r"(gp)
+               : [shift] "r"(15)
+               : "memory");
+}
+
+// 8 samples per iteration with the saturating vector add
+static void mixSaturatePie(const int16_t *a, const int16_t *b, int16_t *out, size_t blocks) {
+  asm volatile("1:\n"
+               "ee.vld.128.ip q0, %[a], 16\n"
+               "ee.vld.128.ip q1, %[b], 16\n"
+               "ee.vadds.s16 q2, q0, q1\n"
+               "ee.vst.128.ip q2, %[out], 16\n"
+               "addi %[n], %[n], -1\n"
+               "bnez %[n], 1b\n"
+               : [a] "+r"(a), [b] "+r"(b), [out] "+r"(out), [n] "+r"(blocks)
+               :
+               : "memory");
+}
+#endif
+
+// ================================ DISPATCH ================================
+void scaleQ15(int16_t *samples, size_t count, int16_t gain) {
+#if DSP_USE_PIE
+  if (count >= 8 && isAligned16(samples)) {
+    size_t blocks = count / 8;
+    scaleQ15Pie(samples, blocks, gain);
+    samples += blocks * 8;
+    count -= blocks * 8;
+  }
+#endif
+  scaleQ15Reference(samples, count, gain);
+}
+
+void mixSaturate(const int16_t *a, const int16_t *b, int16_t *out, size_t count) {
+#if DSP_USE_PIE
+  if (count >= 8 && isAligned16(a) && isAligned16(b) && isAligned16(out)) {
+    size_t blocks = count / 8;
+    mixSaturatePie(a, b, out, blocks);
+    a += blocks * 8;
+    b += blocks * 8;
+    out += blocks * 8;
+    count -= blocks * 8;
+  }
+#endif
+  mixSaturateReference(a, b, out, count);
+}
+
+void mixSoftClip(const int16_t *a, const int16_t *b, int16_t *out, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = softClip((int32_t)a[i] + b[i]);
+  }
+}
+
+// ================================ GAIN RAMP ================================
+void GainRamp::set(int16_t gain) {
+  acc_ = (int32_t)gain << 16;
+  target_ = gain;
+  step_ = 0;
+  framesLeft_ = 0;
+}
+
+void GainRamp::rampTo(int16_t target, uint32_t frames) {
+  if (frames == 0) {
+    set(target);
+    return;
+  }
+  target_ = target;
+  step_ = (((int32_t)target << 16) - acc_) / (int32_t)frames;
+  framesLeft_ = frames;
+}
+
+void GainRamp::process(int16_t *samples, size_t frames, uint8_t channels) {
+  size_t i = 0;
+  for (; i < frames && framesLeft_ > 0; i++) {
+    acc_ += step_;
+    if (--framesLeft_ == 0) {
+      acc_ = (int32_t)target_ << 16; // land exactly on the target despite the rounded step
+    }
+    int32_t g = acc_ >> 16;
+    if (g == Q15_ONE) {
+      continue; // unity is untouched, as in the block path below; (s * Q15_ONE) >> 15 would shave an LSB
+    }
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      int16_t &s = samples[i * channels + ch];
+      s = (int16_t)(((int32_t)s * g) >> 15);
+    }
+  }
+  if (i < frames && target_ != Q15_ONE) {
+    scaleQ15(samples + i * channels, (frames - i) * channels, target_);
+  }
+}
+
+// ================================ GAIN STAGE ===============================
+void GainStage::rampTo(float gain, uint32_t ms) {
+  gain = gain < 0.0f ? 0.0f : (gain > 1.0f ? 1.0f : gain);
+  // Before the first format notification assume 44.1 kHz, the ramp only needs to be roughly right
+  uint32_t rate = audioInfo().sample_rate > 0 ? audioInfo().sample_rate : 44100;
+  uint32_t frames = rate * ms / 1000;
+  gain_.rampTo((int16_t)(gain * Q15_ONE), frames);
+}
+
+size_t GainStage::write(const uint8_t *data, size_t len) {
+  if (!gain_.isRamping() && gain_.target() == Q15_ONE) {
+    return next_.write(data, len); // unity gain, nothing to do per sample
+  }
+  uint8_t channels = audioInfo().channels > 0 ? audioInfo().channels : 1;
+  const int16_t *in = reinterpret_cast<const int16_t *>(data);
+  size_t samples = len / sizeof(int16_t);
+  size_t blockSamples = BLOCK_SAMPLES - BLOCK_SAMPLES % channels;
+  while (samples > 0) {
+    size_t n = samples < blockSamples ? samples : blockSamples;
+    memcpy(block_, in, n * sizeof(int16_t));
+    gain_.process(block_, n / channels, channels);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(block_);
+    size_t remaining = n * sizeof(int16_t);
+    while (remaining > 0) {
+      size_t written = next_.write(bytes, remaining);
+      if (written == 0) {
+        return len; // output closed
+      }
+      bytes += written;
+      remaining -= written;
+    }
+    in += n;
+    samples -= n;
+  }
+  return len;
+}
+
+} // namespace dict
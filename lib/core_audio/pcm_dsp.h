@@ -0,0 +1,93 @@
+#pragma once
+#include "AudioTools.h"
+#include "audio_compat.h"
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dict {
+
+/**
+ * @brief Fixed-point DSP kernels for the output stage (16-bit PCM, Q15 gains)
+ *
+ * scaleQ15 and mixSaturate use the ESP32-S3 PIE vector unit (8 samples per
+ * instruction) on 16-byte aligned buffers and fall back to scalar code
+ * elsewhere. The *Reference versions are the plain definitions; the host and
+ * device tests check the optimized kernels against them bit for bit.
+ */
+
+static const int16_t Q15_ONE = 32767;
+
+// samples[i] = (samples[i] * gain) >> 15, gain in [0, Q15_ONE]
+void scaleQ15(int16_t *samples, size_t count, int16_t gain);
+void scaleQ15Reference(int16_t *samples, size_t count, int16_t gain);
+
+// out[i] = clamp(a[i] + b[i]); out may alias a or b
+void mixSaturate(const int16_t *a, const int16_t *b, int16_t *out, size_t count);
+void mixSaturateReference(const int16_t *a, const int16_t *b, int16_t *out, size_t count);
+
+// out[i] = softClip(a[i] + b[i]); out may alias a or b
+void mixSoftClip(const int16_t *a, const int16_t *b, int16_t *out, size_t count);
+
+// Linear below SOFT_CLIP_KNEE, then a rational curve that approaches full scale without a hard edge
+static const int32_t SOFT_CLIP_KNEE = 24576; // -2.5 dBFS
+inline int16_t softClip(int32_t x) {
+  const int32_t range = 32767 - SOFT_CLIP_KNEE;
+  if (x > SOFT_CLIP_KNEE) {
+    int32_t d = x - SOFT_CLIP_KNEE;
+    return (int16_t)(SOFT_CLIP_KNEE + d * range / (d + range));
+  }
+  if (x < -SOFT_CLIP_KNEE) {
+    int32_t d = -x - SOFT_CLIP_KNEE;
+    return (int16_t)-(SOFT_CLIP_KNEE + d * range / (d + range));
+  }
+  return (int16_t)x;
+}
+
+/**
+ * @brief Gain with a linear per-frame ramp to avoid zipper noise and clicks
+ *
+ * While ramping every frame gets its own gain (scalar); once the target is
+ * reached the block goes through scaleQ15, or is left untouched at unity.
+ */
+class GainRamp {
+public:
+  void set(int16_t gain);                       // Jump to gain immediately
+  void rampTo(int16_t target, uint32_t frames); // Reach target after this many frames
+  void process(int16_t *samples, size_t frames, uint8_t channels);
+  int16_t current() const { return (int16_t)(acc_ >> 16); }
+  int16_t target() const { return target_; }
+  bool isRamping() const { return framesLeft_ > 0; }
+
+private:
+  int32_t acc_ = (int32_t)Q15_ONE << 16; // current gain, Q15 with 16 extra fraction bits
+  int32_t step_ = 0;
+  uint32_t framesLeft_ = 0;
+  int16_t target_ = Q15_ONE;
+};
+
+/**
+ * @brief Output stage applying a GainRamp to everything written through it
+ */
+class GainStage : public AudioStream {
+public:
+  explicit GainStage(AudioStream &next) : next_(next) {}
+
+  bool begin() override { return true; }
+  void setAudioInfo(AudioInfo newInfo) override {
+    AudioStream::setAudioInfo(newInfo);
+    next_.setAudioInfo(newInfo);
+  }
+  int availableForWrite() override { return next_.availableForWrite(); }
+  size_t write(const uint8_t *data, size_t len) override;
+
+  GainRamp &gain() { return gain_; }
+  void rampTo(float gain, uint32_t ms); // Convenience: float gain, ramp length in ms at the current rate
+
+private:
+  static const size_t BLOCK_SAMPLES = 512;
+  AudioStream &next_;
+  GainRamp gain_;
+  alignas(16) int16_t block_[BLOCK_SAMPLES];
+};
+
+} // namespace dict
@@ -0,0 +1,208 @@
+#include "time_stretch.h"
+#include <string.h>
+
+namespace dict {
+
+static const char *TAG = "TimeStretch";
+
+void TimeStretchStage::setWorkBuffer(int16_t *work, size_t samples) {
+  if (!work || samples < WORK_SAMPLES) {
+    ESP_LOGE(TAG, "Working buffer too small (%u < %u samples)", (unsigned)samples, (unsigned)WORK_SAMPLES);
+    return;
+  }
+  in_ = work;
+  target_ = in_ + INPUT_FRAMES * MAX_CHANNELS;
+  out_ = target_ + MAX_OVERLAP_FRAMES * MAX_CHANNELS;
+  configure(audioInfo().sample_rate, audioInfo().channels);
+}
+
+void TimeStretchStage::setSpeed(float speed) {
+  speed = speed < MIN_SPEED ? MIN_SPEED : (speed > MAX_SPEED ? MAX_SPEED : speed);
+  pendingSpeedQ16_ = (uint32_t)(speed * 65536.0f + 0.5f);
+}
+
+void TimeStretchStage::setAudioInfo(AudioInfo newInfo) {
+  flush(); // previous clip's tail, at the previous format
+  AudioStream::setAudioInfo(newInfo);
+  configure(newInfo.sample_rate, newInfo.channels);
+  next_.setAudioInfo(newInfo);
+}
+
+void TimeStretchStage::configure(uint32_t rate, uint8_t channels) {
+  clear();
+  channels_ = channels > 0 ? channels : 1;
+  overlap_ = 0;
+  if (in_ && rate > 0 && channels_ <= MAX_CHANNELS) {
+    overlap_ = rate * OVERLAP_MS / 1000;
+    overlap_ = overlap_ < MAX_OVERLAP_FRAMES ? overlap_ : MAX_OVERLAP_FRAMES;
+    seek_ = rate * SEEK_MS / 1000;
+    decimation_ = rate / 8000 > 1 ? rate / 8000 : 1;
+    fadeStep_ = overlap_ > 0 ? (32768u << 16) / overlap_ : 0;
+  }
+  active_ = overlap_ > 0 && speedQ16_ != (1u << 16);
+}
+
+void TimeStretchStage::applySpeed() {
+  if (pendingSpeedQ16_ == speedQ16_) {
+    return;
+  }
+  if (pendingSpeedQ16_ == (1u << 16)) {
+    flush(); // back to pass-through; what is buffered goes out first
+  }
+  speedQ16_ = pendingSpeedQ16_;
+  active_ = overlap_ > 0 && speedQ16_ != (1u << 16);
+}
+
+// ================================== WSOLA ==================================
+// Normalized cross-correlation against target_ on the first channel, every
+// decimation_-th frame; corr * |corr| / energy orders like corr / sqrt(energy)
+float TimeStretchStage::score(size_t candidate) const {
+  const int16_t *cand = in_ + candidate * channels_;
+  int32_t corr = 0;
+  int32_t energy = 1;
+  for (size_t j = 0; j < overlap_; j += decimation_) {
+    int32_t c = cand[j * channels_] >> 4;
+    corr += (target_[j * channels_] >> 4) * c;
+    energy += c * c;
+  }
+  float fc = (float)corr;
+  return fc * (fc < 0 ? -fc : fc) / (float)energy;
+}
+
+int32_t TimeStretchStage::bestOffset(size_t anaPos) const {
+  const int32_t lo = -(int32_t)(seek_ < anaPos ? seek_ : anaPos);
+  const int32_t hi = (int32_t)seek_;
+  const int32_t stride = (int32_t)decimation_;
+  int32_t best = 0;
+  float bestScore = score(anaPos);
+  for (int32_t k = lo; k <= hi; k += stride) {
+    float s = score(anaPos + k);
+    if (s > bestScore) {
+      bestScore = s;
+      best = k;
+    }
+  }
+  // Refine around the coarse winner at full resolution
+  int32_t coarse = best;
+  for (int32_t k = coarse - stride + 1; k < coarse + stride; k++) {
+    if (k < lo || k > hi || k == coarse) {
+      continue;
+    }
+    float s = score(anaPos + k);
+    if (s > bestScore) {
+      bestScore = s;
+      best = k;
+    }
+  }
+  return best;
+}
+
+void TimeStretchStage::crossFade(const int16_t *from, const int16_t *to, int16_t *out, size_t frames) const {
+  for (size_t i = 0; i < frames; i++) {
+    int32_t w = (int32_t)((i * fadeStep_) >> 16); // 0..32768
+    for (uint8_t ch = 0; ch < channels_; ch++) {
+      size_t n = i * channels_ + ch;
+      out[n] = (int16_t)((from[n] * (32768 - w) + to[n] * w) >> 15);
+    }
+  }
+}
+
+bool TimeStretchStage::step() {
+  if (!primed_) {
+    if (inFrames_ < overlap_) {
+      return false;
+    }
+    memcpy(target_, in_, overlap_ * channels_ * sizeof(int16_t));
+    anaPosQ16_ = (uint32_t)overlap_ * speedQ16_;
+    primed_ = true;
+  }
+  size_t anaPos = anaPosQ16_ >> 16;
+  if (anaPos + seek_ + 2 * overlap_ > inFrames_) {
+    return false;
+  }
+  size_t cand = anaPos + bestOffset(anaPos);
+  crossFade(target_, in_ + cand * channels_, out_, overlap_);
+  memcpy(target_, in_ + (cand + overlap_) * channels_, overlap_ * channels_ * sizeof(int16_t));
+  anaPosQ16_ += (uint32_t)overlap_ * speedQ16_;
+  writeAll(out_, overlap_ * channels_);
+  return true;
+}
+
+void TimeStretchStage::compact() {
+  size_t anaPos = anaPosQ16_ >> 16;
+  if (!primed_ || anaPos <= seek_) {
+    return;
+  }
+  size_t shift = anaPos - seek_;
+  shift = shift < inFrames_ ? shift : inFrames_;
+  memmove(in_, in_ + shift * channels_, (inFrames_ - shift) * channels_ * sizeof(int16_t));
+  inFrames_ -= shift;
+  anaPosQ16_ -= (uint32_t)shift << 16;
+}
+
+// ================================ STREAMING ================================
+size_t TimeStretchStage::writeAll(const int16_t *samples, size_t count) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(samples);
+  size_t remaining = count * sizeof(int16_t);
+  while (remaining > 0) {
+    size_t written = next_.write(bytes, remaining);
+    if (written == 0) {
+      return count * sizeof(int16_t) - remaining; // output closed
+    }
+    bytes += written;
+    remaining -= written;
+  }
+  return count * sizeof(int16_t);
+}
+
+size_t TimeStretchStage::write(const uint8_t *data, size_t len) {
+  applySpeed();
+  if (!active_) {
+    return next_.write(data, len);
+  }
+  const int16_t *in = reinterpret_cast<const int16_t *>(data);
+  size_t frames = len / (channels_ * sizeof(int16_t));
+  while (frames > 0) {
+    compact();
+    size_t n = INPUT_FRAMES - inFrames_;
+    n = n < frames ? n : frames;
+    memcpy(in_ + inFrames_ * channels_, in, n * channels_ * sizeof(int16_t));
+    inFrames_ += n;
+    in += n * channels_;
+    frames -= n;
+    bool stepped = false;
+    while (step()) {
+      stepped = true;
+    }
+    if (n == 0 && !stepped) {
+      break; // can't happen with the sizes above; never spin
+    }
+  }
+  return len;
+}
+
+void TimeStretchStage::flush() {
+  if (active_ && !primed_) {
+    writeAll(in_, inFrames_ * channels_);
+  } else if (active_) {
+    size_t anaPos = anaPosQ16_ >> 16;
+    anaPos = anaPos < inFrames_ ? anaPos : inFrames_;
+    size_t tail = inFrames_ - anaPos;
+    if (tail >= overlap_) {
+      crossFade(target_, in_ + anaPos * channels_, out_, overlap_);
+      writeAll(out_, overlap_ * channels_);
+      writeAll(in_ + (anaPos + overlap_) * channels_, (tail - overlap_) * channels_);
+    } else {
+      writeAll(target_, overlap_ * channels_);
+    }
+  }
+  clear();
+}
+
+void TimeStretchStage::clear() {
+  inFrames_ = 0;
+  primed_ = false;
+  anaPosQ16_ = 0;
+}
+
+} // namespace dict
@@ -0,0 +1,73 @@
+#pragma once
+#include "AudioTools.h"
+#include "audio_compat.h"
+
+namespace dict {
+
+/**
+ * @brief WSOLA time-stretch: changes playback speed without changing pitch
+ *
+ * Every step emits one overlap length (OVERLAP_MS) of output: the natural
+ * continuation of the previous segment is cross-faded into the input segment
+ * near the nominal analysis position that matches it best (searched within
+ * SEEK_MS, coarse then fine). The analysis position advances by speed x the
+ * overlap length, so 0.75x plays a clip 4/3 as long.
+ *
+ * All state lives in a caller-provided working buffer of WORK_SAMPLES (meant
+ * for PSRAM); nothing is allocated. At 1.0x, without a working buffer or for
+ * more than two channels the stage passes PCM straight through.
+ */
+class TimeStretchStage : public AudioStream {
+public:
+  static constexpr float MIN_SPEED = 0.75f;
+  static constexpr float MAX_SPEED = 1.5f;
+  static const uint32_t OVERLAP_MS = 15;
+  static const uint32_t SEEK_MS = 6;
+  static const size_t MAX_CHANNELS = 2;
+  static const size_t MAX_OVERLAP_FRAMES = 1024;
+  static const size_t INPUT_FRAMES = 4096;
+  static const size_t WORK_SAMPLES = (INPUT_FRAMES + 2 * MAX_OVERLAP_FRAMES) * MAX_CHANNELS;
+
+  explicit TimeStretchStage(AudioStream &next) : next_(next) {}
+
+  bool begin() override { return true; }
+  void setAudioInfo(AudioInfo newInfo) override;
+  int availableForWrite() override { return next_.availableForWrite(); }
+  size_t write(const uint8_t *data, size_t len) override;
+
+  void setWorkBuffer(int16_t *work, size_t samples); // At least WORK_SAMPLES
+  void setSpeed(float speed);                        // Clamped to MIN_SPEED..MAX_SPEED, applied on the next write
+  float speed() const { return pendingSpeedQ16_ / 65536.0f; }
+  bool isStretching() const { return active_; } // Current clip goes through WSOLA
+  void flush();                                  // Write out what is buffered (end of clip)
+  void clear();                                  // Drop what is buffered (stop)
+
+private:
+  AudioStream &next_;
+  int16_t *in_ = nullptr;     // INPUT_FRAMES of input, compacted as the analysis position moves
+  int16_t *target_ = nullptr; // natural continuation of the last emitted segment
+  int16_t *out_ = nullptr;    // one step of output
+
+  uint32_t speedQ16_ = 1u << 16;
+  uint32_t pendingSpeedQ16_ = 1u << 16;
+  bool active_ = false;
+  bool primed_ = false;
+  uint8_t channels_ = 1;
+  size_t overlap_ = 0;    // frames emitted per step
+  size_t seek_ = 0;       // search radius in frames
+  size_t decimation_ = 1; // correlation stride, keeps the search cost flat across rates
+  uint32_t fadeStep_ = 0; // cross-fade weight increment per frame, Q15 << 16
+  size_t inFrames_ = 0;
+  uint32_t anaPosQ16_ = 0; // nominal analysis position in in_, Q16.16
+
+  void configure(uint32_t rate, uint8_t channels);
+  void applySpeed();
+  bool step();
+  int32_t bestOffset(size_t anaPos) const;
+  float score(size_t candidate) const;
+  void crossFade(const int16_t *from, const int16_t *to, int16_t *out, size_t frames) const;
+  void compact();
+  size_t writeAll(const int16_t *samples, size_t count);
+};
+
+} // namespace dict
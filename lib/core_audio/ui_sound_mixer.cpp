@@ -0,0 +1,216 @@
+#include "ui_sound_mixer.h"
+#include "pcm_convert.h"
+#include <math.h>
+#include <string.h>
+
+namespace dict {
+
+// ================================ SYNTHESIS ================================
+// Each built-in sound is a few sine segments; a segment with freqHz 0 is a gap
+struct ToneSegment {
+  uint16_t freqHz;
+  uint16_t ms;
+  int16_t amplitude;
+  bool decay; // fade out over the whole segment (clicks) instead of only the tail
+};
+
+static const ToneSegment KEY_CLICK[] = {{2400, 8, 5000, true}};
+static const ToneSegment ERROR_TONE[] = {{440, 90, 8000, false}, {0, 30, 0, false}, {311, 140, 8000, false}};
+static const ToneSegment LOOKUP_DONE[] = {{880, 70, 6500, false}, {1320, 110, 6500, false}};
+
+struct ToneSpec {
+  const ToneSegment *segments;
+  size_t count;
+};
+
+static ToneSpec toneSpec(UiSound sound) {
+  switch (sound) {
+  case UiSound::KeyClick:
+    return {KEY_CLICK, sizeof(KEY_CLICK) / sizeof(KEY_CLICK[0])};
+  case UiSound::Error:
+    return {ERROR_TONE, sizeof(ERROR_TONE) / sizeof(ERROR_TONE[0])};
+  case UiSound::LookupDone:
+  default:
+    return {LOOKUP_DONE, sizeof(LOOKUP_DONE) / sizeof(LOOKUP_DONE[0])};
+  }
+}
+
+size_t UiSoundMixer::synthesizedFrames(UiSound sound) {
+  ToneSpec spec = toneSpec(sound);
+  size_t frames = 0;
+  for (size_t i = 0; i < spec.count; i++) {
+    frames += (size_t)SOUND_RATE * spec.segments[i].ms / 1000;
+  }
+  return frames;
+}
+
+size_t UiSoundMixer::synthesize(UiSound sound, int16_t *out, size_t capacity) {
+  size_t total = synthesizedFrames(sound);
+  if (capacity < total) {
+    return 0;
+  }
+  const size_t attack = SOUND_RATE / 1000;     // 1 ms
+  const size_t release = SOUND_RATE * 20 / 1000; // 20 ms
+  ToneSpec spec = toneSpec(sound);
+  size_t pos = 0;
+  for (size_t i = 0; i < spec.count; i++) {
+    const ToneSegment &seg = spec.segments[i];
+    size_t frames = (size_t)SOUND_RATE * seg.ms / 1000;
+    float phaseStep = 2.0f * (float)M_PI * seg.freqHz / SOUND_RATE;
+    for (size_t n = 0; n < frames; n++) {
+      float env = 1.0f;
+      if (n < attack) {
+        env = (float)n / attack;
+      }
+      if (seg.decay) {
+        float left = 1.0f - (float)n / frames;
+        env *= left * left;
+      } else if (n + release > frames) {
+        env *= (float)(frames - n) / release;
+      }
+      out[pos++] = seg.freqHz ? (int16_t)(seg.amplitude * env * sinf(phaseStep * n)) : 0;
+    }
+  }
+  return total;
+}
+
+// ================================== MIXER ==================================
+void UiSoundMixer::setAudioInfo(AudioInfo newInfo) {
+  AudioStream::setAudioInfo(newInfo);
+  channels_ = newInfo.channels == 1 ? 1 : 2;
+  if (newInfo.sample_rate > 0) {
+    step_ = (uint32_t)(((uint64_t)SOUND_RATE << 16) / newInfo.sample_rate);
+  }
+  next_.setAudioInfo(newInfo);
+}
+
+void UiSoundMixer::setSound(UiSound sound, const int16_t *pcm, size_t frames) {
+  size_t index = (size_t)sound;
+  if (index >= UI_SOUND_COUNT || frames >= 0xFFFF) { // position is Q16.16
+    ESP_LOGE("UiSoundMixer", "Sound %u rejected (%u frames)", (unsigned)index, (unsigned)frames);
+    return;
+  }
+  sounds_[index].pcm = pcm;
+  sounds_[index].frames = (uint32_t)frames;
+}
+
+bool UiSoundMixer::trigger(UiSound sound, int16_t gain) {
+  size_t index = (size_t)sound;
+  if (index >= UI_SOUND_COUNT || !sounds_[index].pcm || sounds_[index].frames == 0) {
+    return false;
+  }
+  Voice *slot = nullptr;
+  for (Voice &voice : voices_) {
+    if (!voice.sound) {
+      slot = &voice;
+      break;
+    }
+    if (!slot || voice.age < slot->age) {
+      slot = &voice; // oldest so far
+    }
+  }
+  if (!slot->sound) {
+    activeVoices_++;
+  }
+  slot->sound = &sounds_[index];
+  slot->pos = 0;
+  slot->gain = gain;
+  slot->age = ++triggerCount_;
+  return true;
+}
+
+void UiSoundMixer::stopAll() {
+  for (Voice &voice : voices_) {
+    voice.sound = nullptr;
+  }
+  activeVoices_ = 0;
+}
+
+void UiSoundMixer::renderVoices(size_t frames) {
+  memset(voiceSum_, 0, frames * sizeof(int16_t));
+  for (Voice &voice : voices_) {
+    if (!voice.sound) {
+      continue;
+    }
+    const int16_t *pcm = voice.sound->pcm;
+    const uint32_t last = voice.sound->frames - 1;
+    size_t n = 0;
+    for (; n < frames; n++) {
+      uint32_t index = voice.pos >> 16;
+      if (index > last) {
+        break;
+      }
+      int32_t a = pcm[index];
+      int32_t b = index < last ? pcm[index + 1] : 0;
+      int32_t s = a + (((b - a) * (int32_t)((voice.pos & 0xFFFF) >> 1)) >> 15);
+      voiceTmp_[n] = (int16_t)(voice.gain == Q15_ONE ? s : (s * voice.gain) >> 15);
+      voice.pos += step_;
+    }
+    if (n < frames) {
+      memset(voiceTmp_ + n, 0, (frames - n) * sizeof(int16_t));
+      voice.sound = nullptr;
+      activeVoices_--;
+    }
+    mixSaturate(voiceSum_, voiceTmp_, voiceSum_, frames);
+  }
+  if (channels_ == 2) {
+    upmixMonoToStereo(voiceSum_, voiceOut_, frames);
+  } else {
+    memcpy(voiceOut_, voiceSum_, frames * sizeof(int16_t));
+  }
+}
+
+size_t UiSoundMixer::writeAll(const int16_t *samples, size_t count) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(samples);
+  size_t remaining = count * sizeof(int16_t);
+  while (remaining > 0) {
+    size_t written = next_.write(bytes, remaining);
+    if (written == 0) {
+      return count * sizeof(int16_t) - remaining; // output closed
+    }
+    bytes += written;
+    remaining -= written;
+  }
+  return count * sizeof(int16_t);
+}
+
+size_t UiSoundMixer::write(const uint8_t *data, size_t len) {
+  if (activeVoices_ == 0) {
+    return next_.write(data, len);
+  }
+  const int16_t *in = reinterpret_cast<const int16_t *>(data);
+  size_t samples = len / sizeof(int16_t);
+  while (samples > 0) {
+    size_t frames = samples / channels_ < BLOCK_FRAMES ? samples / channels_ : BLOCK_FRAMES;
+    if (frames == 0) {
+      break; // partial frame, not produced by the decoders
+    }
+    size_t n = frames * channels_;
+    memcpy(block_, in, n * sizeof(int16_t));
+    renderVoices(frames);
+    mixSoftClip(block_, voiceOut_, block_, n);
+    if (writeAll(block_, n) < n * sizeof(int16_t)) {
+      break;
+    }
+    in += n;
+    samples -= n;
+  }
+  return len;
+}
+
+size_t UiSoundMixer::pump(size_t maxFrames) {
+  if (activeVoices_ == 0) {
+    return 0;
+  }
+  size_t frames = next_.availableForWrite() / (channels_ * sizeof(int16_t));
+  frames = frames < maxFrames ? frames : maxFrames;
+  frames = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+  if (frames == 0) {
+    return 0;
+  }
+  renderVoices(frames);
+  writeAll(voiceOut_, frames * channels_);
+  return frames;
+}
+
+} // namespace dict
@@ -0,0 +1,81 @@
+#pragma once
+#include "AudioTools.h"
+#include "audio_compat.h"
+#include "pcm_dsp.h"
+
+namespace dict {
+
+enum class UiSound : uint8_t {
+  KeyClick,
+  Error,
+  LookupDone,
+};
+static const size_t UI_SOUND_COUNT = 3;
+
+/**
+ * @brief Mixes short UI sounds on top of whatever is written through it
+ *
+ * Sits between the format stage and the board output, so it always sees the
+ * I2S link format. It is behind the decoder meter (MeteredOutput), so pumped
+ * voices don't show up as decoded frames in the metrics, and the board tap
+ * after it only counts a clip's first sample once a frame was decoded.
+ * Sounds are mono PCM at SOUND_RATE, owned by the caller (preloaded once,
+ * e.g. in PSRAM), and are resampled on the fly per voice.
+ * While speech is playing its writes carry the voices; when nothing is
+ * playing pump() writes the voices over silence. Per block the cost is
+ * bounded by MAX_VOICES * BLOCK_FRAMES and nothing is allocated after
+ * construction. trigger() and write() must be called from the same task.
+ */
+class UiSoundMixer : public AudioStream {
+public:
+  static const size_t MAX_VOICES = 4;
+  static const size_t BLOCK_FRAMES = 256;
+  static const uint32_t SOUND_RATE = 16000;
+
+  explicit UiSoundMixer(AudioStream &next) : next_(next) {}
+
+  bool begin() override { return true; }
+  void setAudioInfo(AudioInfo newInfo) override;
+  int availableForWrite() override { return next_.availableForWrite(); }
+  size_t write(const uint8_t *data, size_t len) override;
+
+  void setSound(UiSound sound, const int16_t *pcm, size_t frames); // Mono at SOUND_RATE, not copied
+  bool trigger(UiSound sound, int16_t gain = Q15_ONE);             // Start a voice, steals the oldest if all are busy
+  size_t pump(size_t maxFrames);                                   // Nothing else playing: write voices over silence
+  bool isActive() const { return activeVoices_ > 0; }              // Any voice still sounding
+  void stopAll();                                                  // Silence all voices
+
+  // Procedural versions of the built-in sounds; returns frames written (0 if capacity is too small)
+  static size_t synthesizedFrames(UiSound sound);
+  static size_t synthesize(UiSound sound, int16_t *out, size_t capacity);
+
+private:
+  struct Sound {
+    const int16_t *pcm = nullptr;
+    uint32_t frames = 0;
+  };
+  struct Voice {
+    const Sound *sound = nullptr;
+    uint32_t pos = 0; // read position in the sound, Q16.16
+    int16_t gain = Q15_ONE;
+    uint32_t age = 0;
+  };
+
+  AudioStream &next_;
+  Sound sounds_[UI_SOUND_COUNT];
+  Voice voices_[MAX_VOICES];
+  size_t activeVoices_ = 0;
+  uint32_t triggerCount_ = 0;
+  uint32_t step_ = 1u << 16; // sound frames per output frame, Q16.16
+  uint8_t channels_ = 2;
+
+  alignas(16) int16_t voiceSum_[BLOCK_FRAMES];
+  alignas(16) int16_t voiceTmp_[BLOCK_FRAMES];
+  alignas(16) int16_t voiceOut_[BLOCK_FRAMES * 2];
+  alignas(16) int16_t block_[BLOCK_FRAMES * 2];
+
+  void renderVoices(size_t frames); // Sum of all voices into voiceOut_, interleaved at the link channel count
+  size_t writeAll(const int16_t *samples, size_t count);
+};
+
+} // namespace dict
@@ -0,0 +1,23 @@
+#include "connectivity_state.h"
+#include "event_system.h"
+
+namespace dict {
+
+ConnectivityState &ConnectivityState::instance() {
+  static ConnectivityState instance;
+  return instance;
+}
+
+ConnectivityState::ConnectivityState() { EventSystem::instance().registerEventBus<ConnectivityEvent>(); }
+
+void ConnectivityState::set(Link link, bool up) {
+  uint8_t bit = 1 << link;
+  uint8_t previous = up ? links_.fetch_or(bit) : links_.fetch_and((uint8_t)~bit);
+  if (((previous & bit) != 0) == up) {
+    return;
+  }
+  transitions_++;
+  EventSystem::instance().getEventBus<ConnectivityEvent>().publish(ConnectivityEvent{link, up});
+}
+
+} // namespace dict
@@ -0,0 +1,41 @@
+#pragma once
+#include "common.h"
+#include "events.h"
+#include <atomic>
+
+namespace dict {
+
+/**
+ * @brief Cached up/down state of the keyboard, WiFi and audio links
+ *
+ * The drivers call set() from their connection callbacks (NimBLE host
+ * task, WiFi event task, SNTP) or their lifecycle methods. A ConnectivityEvent is
+ * published only when a link actually changes, so the UI updates on real
+ * transitions and nobody polls the drivers; isUp() is one atomic load.
+ * The bus is drained by processAllEvents() at Normal priority.
+ */
+class ConnectivityState {
+public:
+  using Link = ConnectivityEvent::Link;
+
+  static ConnectivityState &instance();
+
+  void set(Link link, bool up); // Any task; publishes on a change only
+  bool isUp(Link link) const { return (links_.load() >> link) & 1; }
+
+  // Station associated with an IP (GOT_IP until DISCONNECTED). WiFi goes up only once the clock is
+  // set as well, so associated but not up is a clock sync in progress. Not published.
+  void setAssociated(bool associated) { associated_ = associated; }
+  bool isAssociated() const { return associated_; }
+
+  uint32_t getTransitions() const { return transitions_; } // Events published since boot
+
+private:
+  ConnectivityState();
+
+  std::atomic<uint8_t> links_{0}; // bit per Link
+  std::atomic<uint32_t> transitions_{0};
+  std::atomic<bool> associated_{false};
+};
+
+} // namespace dict
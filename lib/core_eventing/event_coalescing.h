@@ -0,0 +1,90 @@
+#pragma once
+#include "common.h"
+#include "events.h"
+#include <utility>
+
+namespace dict {
+
+// How a bus folds events that are already queued when it drains
+enum class CoalescePolicy {
+  None,       // Deliver every event
+  LatestWins, // Deliver only the newest queued event (state snapshots)
+  Merge       // Fold runs of events with EventCoalescing<T>::merge() (repeated keys)
+};
+
+/**
+ * @brief Per-event-type coalescing policy, applied by EventBus and RingEventBus while draining
+ *
+ * Specialize for an event type to coalesce it; merge(into, next) folds next
+ * into into and returns true, or returns false to deliver both.
+ */
+template <typename T> struct EventCoalescing {
+  static constexpr CoalescePolicy policy = CoalescePolicy::None;
+  static bool merge(T &, const T &) { return false; }
+};
+
+// Status snapshots: a listener only needs the latest one
+template <> struct EventCoalescing<AudioStateEvent> {
+  static constexpr CoalescePolicy policy = CoalescePolicy::LatestWins;
+  static bool merge(AudioStateEvent &, const AudioStateEvent &) { return false; }
+};
+
+// Held-down arrow keys: one event with a repeat count instead of one scroll per report
+template <> struct EventCoalescing<FunctionKeyEvent> {
+  static constexpr CoalescePolicy policy = CoalescePolicy::Merge;
+  static bool merge(FunctionKeyEvent &into, const FunctionKeyEvent &next) {
+    if (next.type != into.type || !into.isNavigation() || into.repeat == UINT8_MAX) {
+      return false;
+    }
+    into.repeat++;
+    return true;
+  }
+};
+
+/**
+ * @brief Drain up to `pending` queued events through the type's coalescing policy
+ *
+ * pop(T &) takes the oldest queued event, dispatch(const T &) delivers one.
+ * With a deadline (micros()), stops once it has passed; an event already
+ * taken to look for a merge is still delivered. Returns events delivered.
+ */
+template <typename T, typename Pop, typename Dispatch>
+size_t drainCoalesced(size_t pending, bool hasDeadline, uint32_t deadlineUs, Pop pop, Dispatch dispatch) {
+  using Coalescing = EventCoalescing<T>;
+  T current;
+  if (pending == 0 || !pop(current)) {
+    return 0;
+  }
+  pending--;
+  size_t delivered = 0;
+  for (;;) {
+    T next;
+    bool haveNext = false;
+    while (Coalescing::policy != CoalescePolicy::None && pending > 0 && pop(next)) {
+      pending--;
+      if (Coalescing::policy == CoalescePolicy::LatestWins) {
+        current = std::move(next);
+      } else if (!Coalescing::merge(current, next)) {
+        haveNext = true;
+        break;
+      }
+    }
+    dispatch(current);
+    delivered++;
+    bool expired = hasDeadline && (int32_t)(micros() - deadlineUs) >= 0;
+    if (haveNext && expired) {
+      dispatch(next);
+      return delivered + 1;
+    }
+    if (haveNext) {
+      current = std::move(next);
+      continue;
+    }
+    if (expired || pending == 0 || !pop(current)) {
+      return delivered;
+    }
+    pending--;
+  }
+}
+
+} // namespace dict
@@ -0,0 +1,127 @@
+#include "event_recorder.h"
+#include "LittleFS.h"
+
+namespace dict {
+
+static const char *TAG = "EventRecorder";
+
+EventRecorder &EventRecorder::instance() {
+  static EventRecorder instance;
+  return instance;
+}
+
+bool EventRecorder::mountFilesystem() {
+  static bool mounted = false;
+  if (!mounted) {
+    mounted = LittleFS.begin(true); // mounts at /littlefs; formats a blank partition
+    if (!mounted) {
+      ESP_LOGE(TAG, "LittleFS mount failed");
+    }
+  }
+  return mounted;
+}
+
+// ================================= RECORDING =================================
+bool EventRecorder::startRecording(const char *path) {
+  if (isRecording() || isReplaying()) {
+    ESP_LOGW(TAG, "Already %s", isRecording() ? "recording" : "replaying");
+    return false;
+  }
+  if (!mountFilesystem() || !writer_.open(path)) {
+    ESP_LOGE(TAG, "Cannot create %s", path);
+    return false;
+  }
+  startUs_ = micros();
+  auto &system = EventSystem::instance();
+  keySubscription_ = system.getEventBus<KeyEvent>().subscribeScoped([this](const KeyEvent &event) { onKeyEvent(event); });
+  functionKeySubscription_ = system.getEventBus<FunctionKeyEvent>().subscribeScoped([this](const FunctionKeyEvent &event) { onFunctionKeyEvent(event); });
+  ESP_LOGI(TAG, "Recording to %s", path);
+  return true;
+}
+
+void EventRecorder::stopRecording() {
+  if (!isRecording()) {
+    return;
+  }
+  keySubscription_.reset();
+  functionKeySubscription_.reset();
+  uint32_t records = writer_.getRecordCount();
+  writer_.close();
+  ESP_LOGI(TAG, "Recorded %u events in %u ms", (unsigned)records, (unsigned)((micros() - startUs_) / 1000));
+}
+
+void EventRecorder::onKeyEvent(const KeyEvent &event) {
+  if (!event.valid) {
+    return;
+  }
+  // HID report time, not queueing time; a key reported just before the start counts as at the start
+  int32_t timeUs = (int32_t)(event.reportUs - startUs_);
+  writer_.writeKey(timeUs > 0 ? timeUs : 0, event.key, event.keyCode, event.modifiers, event.pressed);
+}
+
+void EventRecorder::onFunctionKeyEvent(const FunctionKeyEvent &event) {
+  if (event.type == FunctionKeyEvent::ToggleRecording || event.type == FunctionKeyEvent::ToggleReplay) {
+    return; // controls the recorder itself
+  }
+  writer_.writeFunctionKey(micros() - startUs_, (uint8_t)event.type, event.repeat);
+}
+
+void EventRecorder::recordResponse(const String &key, const String &body) {
+  if (isRecording() && !writer_.writeResponse(micros() - startUs_, key.c_str(), body.c_str())) {
+    ESP_LOGW(TAG, "Response for %s not recorded (%u bytes)", key.c_str(), (unsigned)body.length());
+  }
+}
+
+// ================================== REPLAY ==================================
+bool EventRecorder::startReplay(const char *path, float speed) {
+  if (isRecording() || isReplaying()) {
+    ESP_LOGW(TAG, "Already %s", isRecording() ? "recording" : "replaying");
+    return false;
+  }
+  startUs_ = micros();
+  if (!mountFilesystem() || !player_.open(path, speed, startUs_)) {
+    ESP_LOGE(TAG, "Cannot replay %s", path);
+    return false;
+  }
+  ESP_LOGI(TAG, "Replaying %s at %.2fx (%u responses)", path, speed, (unsigned)player_.getResponseCount());
+  return true;
+}
+
+void EventRecorder::stopReplay() {
+  if (!isReplaying()) {
+    return;
+  }
+  ESP_LOGI(TAG, "Replayed %u events in %u ms", (unsigned)player_.getDeliveredCount(), (unsigned)((micros() - startUs_) / 1000));
+  player_.close();
+}
+
+bool EventRecorder::replayResponse(const String &key, String &body) {
+  std::string recorded;
+  if (!isReplaying() || !player_.response(key.c_str(), recorded)) {
+    return false;
+  }
+  body = recorded.c_str();
+  return true;
+}
+
+void EventRecorder::tick() {
+  if (!isReplaying()) {
+    return;
+  }
+  auto &system = EventSystem::instance();
+  bool more = player_.poll(micros(), [&system](const TraceRecord &record) {
+    uint32_t now = micros();
+    if (record.kind == TraceRecord::Key) {
+      system.getEventBus<KeyEvent>().publish(KeyEvent{(char)record.data[0], record.data[1], record.data[2], true, now, now, record.data[3] != 0, false, true});
+    } else {
+      FunctionKeyEvent event((FunctionKeyEvent::Type)record.data[0]);
+      event.repeat = record.data[1];
+      system.getEventBus<FunctionKeyEvent>().publish(event);
+    }
+  });
+  if (!more) {
+    stopReplay();
+  }
+}
+
+} // namespace dict
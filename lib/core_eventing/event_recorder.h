@@ -0,0 +1,55 @@
+#pragma once
+#include "common.h"
+#include "core_replay/event_trace.h"
+#include "event_system.h"
+
+namespace dict {
+
+/**
+ * @brief Records input and network responses to a trace file and replays them
+ *
+ * While recording, every KeyEvent and FunctionKeyEvent the UI loop receives
+ * is appended with its time, and DictionaryApi adds each lookup response.
+ * While replaying, tick() publishes the recorded input on the event buses at
+ * the recorded pace (or faster) and DictionaryApi answers lookups from the
+ * trace instead of the network, so two firmware builds see identical input.
+ * Traces are plain files (see core_replay), readable on the host as well.
+ */
+class EventRecorder {
+public:
+  static constexpr const char *DEFAULT_PATH = "/littlefs/events.trc";
+
+  static EventRecorder &instance();
+
+  // Core lifecycle methods
+  void tick(); // Publish the replayed events that are due (call from main loop)
+
+  bool startRecording(const char *path = DEFAULT_PATH);
+  void stopRecording();
+  bool isRecording() const { return writer_.isOpen(); }
+
+  bool startReplay(const char *path = DEFAULT_PATH, float speed = 1.0f); // speed 0: as fast as the loop runs
+  void stopReplay();
+  bool isReplaying() const { return player_.isOpen(); }
+
+  // Network responses (used by DictionaryApi)
+  void recordResponse(const String &key, const String &body); // No-op unless recording
+  bool replayResponse(const String &key, String &body);       // Recorded body for key while replaying
+
+private:
+  EventRecorder() = default;
+  EventRecorder(const EventRecorder &) = delete;
+  EventRecorder &operator=(const EventRecorder &) = delete;
+
+  EventTraceWriter writer_;
+  TracePlayer player_;
+  uint32_t startUs_ = 0;
+  Subscription<EventBusFor<KeyEvent>> keySubscription_;
+  Subscription<EventBusFor<FunctionKeyEvent>> functionKeySubscription_;
+
+  bool mountFilesystem();
+  void onKeyEvent(const KeyEvent &event);
+  void onFunctionKeyEvent(const FunctionKeyEvent &event);
+};
+
+} // namespace dict
@@ -4,27 +4,50 @@
 
 namespace dict {
 
+static const char *TAG = "EventSystem";
+
 EventSystem &EventSystem::instance() {
   static EventSystem instance;
   return instance;
 }
 
-void EventSystem::processAllEvents() {
-  // Process built-in event types (for backward compatibility)
-  getEventBus<KeyEvent>().processEvents();
-  getEventBus<FunctionKeyEvent>().processEvents();
+size_t EventSystem::processAllEvents(uint32_t budgetUs) {
+  uint32_t start = micros();
+
+  // Input first and never deferred: typing latency matters more than anything queued behind it
+  size_t delivered = getEventBus<KeyEvent>().processEvents();
+  delivered += getEventBus<FunctionKeyEvent>().processEvents();
 
-  // Process any registered custom event buses
+  // Registered buses by priority, within the budget
+  uint32_t deadline = start + budgetUs;
+  bool exhausted = false;
   {
     std::lock_guard<std::mutex> lock(processorsMutex_);
     for (auto &proc : processors_) {
-      proc();
+      delivered += proc.process(deadline);
+      if ((int32_t)(micros() - deadline) >= 0) {
+        exhausted = true;
+        break;
+      }
     }
   }
+
+  lastProcessUs_ = micros() - start;
+  if (exhausted) {
+    budgetExhausted_++;
+    ESP_LOGD(TAG, "Event budget used up after %u us, %u delivered", (unsigned)lastProcessUs_, (unsigned)delivered);
+  }
+  return delivered;
+}
+
+void publishAudioCommand(const AudioCommandEvent &command) {
+  // The audio task is the bus's only consumer; with none attached publish() queues nothing
+  EventSystem::instance().getEventBus<AudioCommandEvent>().publish(command);
 }
 
 } // namespace dict
 
 // Explicit template instantiations to ensure one bus per type across TUs
-template dict::EventBus<dict::KeyEvent> &dict::EventSystem::getEventBus<dict::KeyEvent>();
-template dict::EventBus<dict::FunctionKeyEvent> &dict::EventSystem::getEventBus<dict::FunctionKeyEvent>();
+template dict::EventBusFor<dict::KeyEvent> &dict::EventSystem::getEventBus<dict::KeyEvent>();
+template dict::EventBusFor<dict::FunctionKeyEvent> &dict::EventSystem::getEventBus<dict::FunctionKeyEvent>();
+template dict::EventBusFor<dict::AudioCommandEvent> &dict::EventSystem::getEventBus<dict::AudioCommandEvent>();
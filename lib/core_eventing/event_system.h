@@ -1,10 +1,15 @@
 #pragma once
 #include "common.h"
+#include "event_coalescing.h"
 #include "events.h"
+#include "listener_registry.h"
 #include "psram_allocator.h"
+#include "ring_event_bus.h"
+#include "task_event_bus.h"
+#include <deque>
 #include <functional>
+#include <iterator>
 #include <mutex>
-#include <queue>
 #include <vector>
 
 namespace dict {
@@ -13,22 +18,26 @@ namespace dict {
  * @brief Simple event bus for decoupled communication between modules
  *
  * This provides a publish-subscribe pattern for loose coupling between
- * different parts of the system.
+ * different parts of the system. Up to MaxListeners listeners (function
+ * pointers or small lambdas, see Delegate); subscribing never allocates.
+ * Queued events are folded per EventCoalescing<T> when they are drained.
  */
-template <typename T> class EventBus {
+template <typename T, size_t MaxListeners = 8> class EventBus {
 public:
-  using Listener = std::function<void(const T &)>;
-  using ListenerId = size_t;
+  using Listener = typename ListenerRegistry<T, MaxListeners>::Listener;
+  using ListenerId = typename ListenerRegistry<T, MaxListeners>::ListenerId;
 
   /**
    * @brief Subscribe to events of type T
    * @param listener Function to call when event is published
-   * @return Unique listener ID for unsubscribing
+   * @return Unique listener ID for unsubscribing (ListenerRegistry::INVALID_ID when full)
    */
-  ListenerId subscribe(Listener listener) {
-    listeners_.push_back(listener);
-    return listeners_.size() - 1;
-  }
+  ListenerId subscribe(Listener listener) { return listeners_.add(listener); }
+
+  /**
+   * @brief Subscribe for the lifetime of the returned Subscription
+   */
+  Subscription<EventBus> subscribeScoped(Listener listener) { return Subscription<EventBus>(*this, subscribe(listener)); }
 
   /**
    * @brief Publish an event to all subscribers (queued for later processing)
@@ -36,42 +45,31 @@ public:
    */
   void publish(const T &event) {
     std::lock_guard<std::mutex> lock(eventQueueMutex_);
-    eventQueue_.push(event);
+    eventQueue_.push_back(event);
   }
 
   /**
    * @brief Process all queued events (call from main loop)
+   * @return Events delivered (after coalescing)
    */
-  void processEvents() {
-    std::queue<T, std::deque<T>> eventsToProcess;
+  size_t processEvents() { return drain(false, 0); }
 
-    // Move events from queue to local queue (minimize lock time)
-    {
-      std::lock_guard<std::mutex> lock(eventQueueMutex_);
-      eventsToProcess = std::move(eventQueue_);
-    }
+  /**
+   * @brief Process queued events until micros() passes deadlineUs; the rest stay queued in order
+   * @return Events delivered (after coalescing)
+   */
+  size_t processEventsUntil(uint32_t deadlineUs) { return drain(true, deadlineUs); }
 
-    // Process events outside of lock
-    while (!eventsToProcess.empty()) {
-      const T &event = eventsToProcess.front();
-      for (const auto &listener : listeners_) {
-        if (listener) {
-          listener(event);
-        }
-      }
-      eventsToProcess.pop();
-    }
+  size_t pending() {
+    std::lock_guard<std::mutex> lock(eventQueueMutex_);
+    return eventQueue_.size();
   }
 
   /**
    * @brief Unsubscribe a listener
    * @param id The listener ID returned by subscribe()
    */
-  void unsubscribe(ListenerId id) {
-    if (id < listeners_.size()) {
-      listeners_[id] = nullptr;
-    }
-  }
+  void unsubscribe(ListenerId id) { listeners_.remove(id); }
 
   /**
    * @brief Clear all listeners
@@ -79,54 +77,133 @@ public:
   void clear() { listeners_.clear(); }
 
 private:
-  std::vector<Listener> listeners_;
-  std::queue<T, std::deque<T>> eventQueue_;
+  ListenerRegistry<T, MaxListeners> listeners_;
+  std::deque<T> eventQueue_;
   std::mutex eventQueueMutex_;
+
+  size_t drain(bool hasDeadline, uint32_t deadlineUs) {
+    std::deque<T> eventsToProcess;
+
+    // Move events from queue to local queue (minimize lock time)
+    {
+      std::lock_guard<std::mutex> lock(eventQueueMutex_);
+      eventsToProcess.swap(eventQueue_);
+    }
+
+    // Process events outside of lock
+    size_t delivered = drainCoalesced<T>(
+        eventsToProcess.size(), hasDeadline, deadlineUs,
+        [&](T &event) {
+          event = std::move(eventsToProcess.front());
+          eventsToProcess.pop_front();
+          return true;
+        },
+        [&](const T &event) { listeners_.dispatch(event); });
+
+    // Out of time: put the rest back in front of anything published meanwhile
+    if (!eventsToProcess.empty()) {
+      std::lock_guard<std::mutex> lock(eventQueueMutex_);
+      eventQueue_.insert(eventQueue_.begin(), std::make_move_iterator(eventsToProcess.begin()), std::make_move_iterator(eventsToProcess.end()));
+    }
+    return delivered;
+  }
+};
+
+/**
+ * @brief Bus type used for events of type T
+ *
+ * EventBus by default. Input events are published from the NimBLE host
+ * task, so they get a lock-free ring instead. When a stalled UI loop lets
+ * the ring fill up, keystrokes drop the newest, so typed text stays in
+ * order; function keys drop the oldest, so the latest one is kept.
+ * Audio commands are consumed on the audio task, which sleeps until one is
+ * queued for it.
+ */
+template <typename T> struct EventBusTraits {
+  using Bus = EventBus<T>;
+};
+template <> struct EventBusTraits<KeyEvent> {
+  using Bus = RingEventBus<KeyEvent, 64, OverflowPolicy::DropNewest>;
+};
+template <> struct EventBusTraits<FunctionKeyEvent> {
+  using Bus = RingEventBus<FunctionKeyEvent, 16, OverflowPolicy::DropOldest>;
+};
+template <> struct EventBusTraits<AudioCommandEvent> {
+  using Bus = TaskEventBus<AudioCommandEvent>;
+};
+template <typename T> using EventBusFor = typename EventBusTraits<T>::Bus;
+
+// Order in which registered buses are drained by processAllEvents(); input events always go first
+enum class EventPriority : uint8_t {
+  High,   // Drained right after input
+  Normal, // Default
+  Low     // Status and telemetry; may wait for the next loop when the budget runs out
 };
 
 /**
  * @brief Global event bus manager
  *
- * Provides access to all event buses in the system
+ * Provides access to all event buses in the system. processAllEvents()
+ * drains the input buses completely, then the registered buses by priority
+ * until the time budget is used up; whatever is left waits for the next call.
  */
 class EventSystem {
 public:
+  static constexpr uint32_t DEFAULT_BUDGET_US = 5000; // Per processAllEvents() call, after input
+
   static EventSystem &instance();
 
   // Event bus accessors
-  template <typename T> EventBus<T> &getEventBus() {
-    static EventBus<T> bus;
+  template <typename T> EventBusFor<T> &getEventBus() {
+    static EventBusFor<T> bus;
     return bus;
   }
 
-  // Register an event bus type for inclusion in processAllEvents()
-  template <typename T> void registerEventBus() {
+  // Register an event bus type for inclusion in processAllEvents(); same-priority buses run in registration order
+  template <typename T> void registerEventBus(EventPriority priority = EventPriority::Normal) {
     static bool registered = false;
     if (registered) {
       return;
     }
     {
       std::lock_guard<std::mutex> lock(processorsMutex_);
-      processors_.push_back([]() { EventSystem::instance().getEventBus<T>().processEvents(); });
+      auto it = processors_.begin();
+      while (it != processors_.end() && it->priority <= priority) {
+        ++it;
+      }
+      processors_.insert(it, Processor{priority, [](uint32_t deadlineUs) { return EventSystem::instance().getEventBus<T>().processEventsUntil(deadlineUs); }});
       registered = true;
     }
   }
 
   /**
-   * @brief Process all queued events (call from main loop)
+   * @brief Process queued events (call from main loop)
+   * @param budgetUs Time for the registered buses once input events are handled
+   * @return Events delivered
    */
-  void processAllEvents();
+  size_t processAllEvents(uint32_t budgetUs = DEFAULT_BUDGET_US);
+
+  uint32_t getLastProcessUs() const { return lastProcessUs_; }         // Duration of the last processAllEvents()
+  uint32_t getBudgetExhaustedCount() const { return budgetExhausted_; } // Calls that left events queued for lack of time
 
 private:
   EventSystem() = default;
 
-  // Additional processors registered by users for custom event types
-  std::vector<std::function<void()>, PsramAllocator<std::function<void()>>> processors_;
+  struct Processor {
+    EventPriority priority;
+    std::function<size_t(uint32_t deadlineUs)> process;
+  };
+
+  // Additional processors registered by users for custom event types, sorted by priority
+  std::vector<Processor, PsramAllocator<Processor>> processors_;
   std::mutex processorsMutex_;
+  uint32_t lastProcessUs_ = 0;
+  uint32_t budgetExhausted_ = 0;
 };
 
 // Ensure a single EventBus<T> instance per type across translation units
-extern template EventBus<KeyEvent> &EventSystem::getEventBus<KeyEvent>();
-extern template EventBus<FunctionKeyEvent> &EventSystem::getEventBus<FunctionKeyEvent>();
+extern template EventBusFor<KeyEvent> &EventSystem::getEventBus<KeyEvent>();
+extern template EventBusFor<FunctionKeyEvent> &EventSystem::getEventBus<FunctionKeyEvent>();
+extern template EventBusFor<AudioCommandEvent> &EventSystem::getEventBus<AudioCommandEvent>();
 
 } // namespace dict
@@ -9,10 +9,19 @@ struct KeyEvent {
   uint8_t keyCode;
   uint8_t modifiers;
   bool valid;
+  uint32_t reportUs;      // micros() when the HID report arrived (see InputLatency)
+  uint32_t publishedUs;   // micros() when the event was published
+  bool pressed = true;    // false when the key was released (one event per transition)
+  bool synthetic = false; // auto-repeat, not a keystroke: InputLatency skips it
+  bool replayed = false;  // from an event trace: no HID report, InputLatency samples it from Dispatch on
+
+  // Backspace, Enter or a printable character; the keys InputLatency samples
+  bool isText() const { return key == 0x08 || key == '\n' || (key >= 32 && key <= 126); }
 };
 
 // Function Key Event (for internal KeyProcessor use)
 struct FunctionKeyEvent {
+  // Event traces store these by value: append new types at the end
   enum Type {
     None = 0,
     VolumeDown,
@@ -22,25 +31,105 @@ struct FunctionKeyEvent {
     ReadWord,
     ReadExplanation,
     ReadSampleSentence,
+    ReadAll,
+    SpeedDown,
+    SpeedUp,
     DownArrow,
     UpArrow,
     LeftArrow,
     RightArrow,
-    Escape
+    Escape,
+    ToggleRecording, // Start/stop recording input to a trace (EventRecorder)
+    ToggleReplay     // Start/stop replaying the recorded trace
   };
   Type type;
+  uint8_t repeat; // Presses folded into this event (held arrow keys, see EventCoalescing)
+
+  FunctionKeyEvent() : type(None), repeat(1) {}
+  FunctionKeyEvent(Type t) : type(t), repeat(1) {}
+  bool isNavigation() const { return type == DownArrow || type == UpArrow || type == LeftArrow || type == RightArrow; }
+};
 
-  FunctionKeyEvent() : type(None) {}
-  FunctionKeyEvent(Type t) : type(t) {}
-  FunctionKeyEvent(const FunctionKeyEvent &other) : type(other.type) {}
-  FunctionKeyEvent &operator=(const FunctionKeyEvent &other) {
-    type = other.type;
-    return *this;
+// Audio commands: published by the UI, executed on the audio task
+struct AudioCommandEvent {
+  enum Type {
+    Play,       // Stop whatever plays, then play url
+    Stop,       // Stop playback and drop the queue
+    Enqueue,    // Append url to the queue (plays at once when idle)
+    Skip,       // Jump to the next queued clip
+    Volume,     // Set volume to value (0.0 to 1.0), or change it by value if relative
+    Speed,      // Set playback speed to value, or change it by value if relative
+    PlayUiSound // Mix UI sound number `sound` over the current output
+  };
+  Type type;
+  String url;
+  float value;
+  bool relative;
+  uint8_t sound;
+
+  AudioCommandEvent(Type t = Stop) : type(t), value(0), relative(false), sound(0) {}
+  static AudioCommandEvent play(const String &url) { return withUrl(Play, url); }
+  static AudioCommandEvent enqueue(const String &url) { return withUrl(Enqueue, url); }
+  static AudioCommandEvent volumeStep(float delta) { return withValue(Volume, delta, true); }
+  static AudioCommandEvent speedStep(float delta) { return withValue(Speed, delta, true); }
+  static AudioCommandEvent uiSound(uint8_t sound) {
+    AudioCommandEvent cmd(PlayUiSound);
+    cmd.sound = sound;
+    return cmd;
+  }
+
+private:
+  static AudioCommandEvent withUrl(Type t, const String &url) {
+    AudioCommandEvent cmd(t);
+    cmd.url = url;
+    return cmd;
   }
-  FunctionKeyEvent &operator=(FunctionKeyEvent &&other) {
-    type = other.type;
-    return *this;
+  static AudioCommandEvent withValue(Type t, float value, bool relative) {
+    AudioCommandEvent cmd(t);
+    cmd.value = value;
+    cmd.relative = relative;
+    return cmd;
   }
 };
 
+// Send a command to the audio task; dropped while no audio task is running
+void publishAudioCommand(const AudioCommandEvent &command);
+
+// Audio state: published by the audio task whenever playback state or settings change
+struct AudioStateEvent {
+  enum State {
+    Idle,       // Nothing playing
+    Connecting, // Opening a clip
+    Playing,    // Clip is playing
+    Error       // Last clip could not be started
+  };
+  State state;
+  const char *codec; // "mp3" or "opus" once the decoder has picked one, "" before (static string)
+  uint8_t queued;    // Clips waiting behind the current one
+  float volume;
+  float speed;
+};
+
+// Connectivity: published by ConnectivityState when a link really goes up or down
+struct ConnectivityEvent {
+  enum Link : uint8_t {
+    Keyboard, // BLE keyboard connected and its reports subscribed
+    WiFi,     // Station connected with an IP address
+    Audio,    // Audio manager initialized
+    LINK_COUNT
+  };
+  Link link;
+  bool up;
+};
+
+// WiFi settings scan progress: published by the scan task, shown by the UI loop
+struct WifiScanEvent {
+  enum Type {
+    Status, // text is the new status line ("" clears it)
+    Results // text is the newline-separated SSID list
+  };
+  Type type;
+  String text;
+};
+
 } // namespace dict
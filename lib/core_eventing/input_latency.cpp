@@ -0,0 +1,101 @@
+#include "input_latency.h"
+
+namespace dict {
+
+static const char *TAG = "InputLatency";
+
+const uint32_t InputLatency::BUCKET_LIMITS_US[BUCKETS - 1] = {250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000};
+
+static const char *STAGE_NAMES[InputLatency::STAGE_COUNT] = {"Publish", "Dispatch", "Apply", "Render", "Total"};
+
+InputLatency &InputLatency::instance() {
+  static InputLatency instance;
+  return instance;
+}
+
+void InputLatency::record(Stage stage, uint32_t elapsedUs) {
+  int bucket = 0;
+  while (bucket < BUCKETS - 1 && elapsedUs >= BUCKET_LIMITS_US[bucket]) {
+    bucket++;
+  }
+  hist_[stage][bucket]++;
+  count_[stage]++;
+  if (elapsedUs > maxUs_[stage]) {
+    maxUs_[stage] = elapsedUs;
+  }
+}
+
+void InputLatency::onTextChanged(uint32_t reportUs, uint32_t dispatchUs) {
+  uint32_t now = micros();
+  record(Apply, now - dispatchUs);
+  if (flushArmed_ && now - armedAppliedUs_ < FLUSH_TIMEOUT_US) {
+    return; // an earlier key is still waiting; the same flush paints both
+  }
+  if (flushArmed_) {
+    missedFlushes_++;
+  }
+  flushArmed_ = true;
+  armedReportUs_ = reportUs;
+  armedAppliedUs_ = now;
+}
+
+void InputLatency::onFlush() {
+  if (!flushArmed_) {
+    return;
+  }
+  flushArmed_ = false;
+  uint32_t now = micros();
+  if (now - armedAppliedUs_ >= FLUSH_TIMEOUT_US) {
+    missedFlushes_++; // text changed off screen, or nothing was redrawn
+    return;
+  }
+  record(Render, now - armedAppliedUs_);
+  record(Total, now - armedReportUs_);
+}
+
+uint32_t InputLatency::percentileUs(Stage stage, int percent) const {
+  if (count_[stage] == 0) {
+    return 0;
+  }
+  uint32_t target = (count_[stage] * (uint32_t)percent + 99) / 100;
+  uint32_t seen = 0;
+  for (int i = 0; i < BUCKETS - 1; i++) {
+    seen += hist_[stage][i];
+    if (seen >= target) {
+      return BUCKET_LIMITS_US[i];
+    }
+  }
+  return maxUs_[stage];
+}
+
+void InputLatency::reset() {
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    for (int i = 0; i < BUCKETS; i++) {
+      hist_[s][i] = 0;
+    }
+    count_[s] = 0;
+    maxUs_[s] = 0;
+  }
+  flushArmed_ = false;
+  missedFlushes_ = 0;
+}
+
+void InputLatency::print() const {
+  ESP_LOGI(TAG, "=== Input Latency (keystroke -> flush) ===");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    Stage stage = (Stage)s;
+    ESP_LOGI(TAG, "%-8s n=%u p50<=%u us p95<=%u us max=%u us", STAGE_NAMES[s], count_[s], percentileUs(stage, 50), percentileUs(stage, 95), maxUs_[s]);
+  }
+  ESP_LOGI(TAG, "Total histogram:");
+  for (int i = 0; i < BUCKETS; i++) {
+    if (i < BUCKETS - 1) {
+      ESP_LOGI(TAG, "  < %5u us: %u", BUCKET_LIMITS_US[i], hist_[Total][i]);
+    } else {
+      ESP_LOGI(TAG, "  >=%5u us: %u", BUCKET_LIMITS_US[i - 1], hist_[Total][i]);
+    }
+  }
+  ESP_LOGI(TAG, "Changes with no flush within %u ms: %u", (unsigned)(FLUSH_TIMEOUT_US / 1000), missedFlushes_);
+  ESP_LOGI(TAG, "==========================================");
+}
+
+} // namespace dict
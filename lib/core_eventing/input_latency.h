@@ -0,0 +1,64 @@
+#pragma once
+#include "common.h"
+
+namespace dict {
+
+/**
+ * @brief Keystroke-to-display latency, per pipeline stage
+ *
+ * Each KeyEvent carries the time its HID report arrived (BLEKeyboard's
+ * notify callback) and the time it was published. The stages are:
+ *   Publish  report -> KeyEvent published (HID decode, NimBLE host task)
+ *   Dispatch published -> listener called (waiting in the ring for the UI loop)
+ *   Apply    listener called -> text area changed
+ *   Render   text area changed -> end of the first frame flushed after it (LVGL render + SPI push)
+ *   Total    report -> that flush
+ * Only presses of text keys (KeyEvent::isText()) are sampled; releases,
+ * modifiers and function keys are not. Render and Total cover keys that
+ * changed the text only. Auto-repeats (KeyEvent::synthetic) are not sampled
+ * at any stage; replayed keys (KeyEvent::replayed) have no HID report, so
+ * they skip Publish and their Total starts at the replay. Read with getters
+ * or dump to the log with print() (F1).
+ */
+class InputLatency {
+public:
+  enum Stage { Publish, Dispatch, Apply, Render, Total, STAGE_COUNT };
+
+  static const int BUCKETS = 10;
+  static const uint32_t BUCKET_LIMITS_US[BUCKETS - 1]; // upper bounds, last bucket is open
+  static const uint32_t FLUSH_TIMEOUT_US = 500000;     // a flush later than this is not attributed to the key
+
+  static InputLatency &instance();
+
+  // Pipeline hooks
+  void record(Stage stage, uint32_t elapsedUs);               // One sample for a stage
+  void onTextChanged(uint32_t reportUs, uint32_t dispatchUs); // Apply done; arms the flush probe
+  void onFlush();                                             // Display flush finished pushing the last area of a frame
+
+  // Getters
+  uint32_t getCount(Stage stage) const { return count_[stage]; }
+  uint32_t getMaxUs(Stage stage) const { return maxUs_[stage]; }
+  uint32_t getHistogram(Stage stage, int bucket) const { return bucket >= 0 && bucket < BUCKETS ? hist_[stage][bucket] : 0; }
+  uint32_t percentileUs(Stage stage, int percent) const; // Upper bound of the bucket holding that percentile (max for the open one)
+  uint32_t getMissedFlushes() const { return missedFlushes_; }
+
+  void reset();
+  void print() const;
+
+private:
+  InputLatency() = default;
+  InputLatency(const InputLatency &) = delete;
+  InputLatency &operator=(const InputLatency &) = delete;
+
+  uint32_t hist_[STAGE_COUNT][BUCKETS] = {};
+  uint32_t count_[STAGE_COUNT] = {};
+  uint32_t maxUs_[STAGE_COUNT] = {};
+
+  // Oldest key not yet on screen; later keys are painted by the same flush
+  bool flushArmed_ = false;
+  uint32_t armedReportUs_ = 0;
+  uint32_t armedAppliedUs_ = 0;
+  uint32_t missedFlushes_ = 0;
+};
+
+} // namespace dict
@@ -0,0 +1,196 @@
+#pragma once
+#include "common.h"
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+namespace dict {
+
+/**
+ * @brief Callable with inline storage: a function pointer or a small lambda, never allocates
+ *
+ * Holds any trivially copyable callable of up to Storage bytes (a plain
+ * function, or a lambda capturing `this` or a few references) plus one thunk
+ * pointer. Larger or non-trivial captures fail to compile; capture a pointer
+ * to them instead.
+ */
+template <typename Signature, size_t Storage = 4 * sizeof(void *)> class Delegate;
+
+template <typename R, typename... Args, size_t Storage> class Delegate<R(Args...), Storage> {
+public:
+  Delegate() = default;
+  Delegate(std::nullptr_t) {}
+
+  template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+  Delegate(F f) {
+    static_assert(sizeof(F) <= Storage, "Capture too large for a Delegate; capture a pointer instead");
+    static_assert(std::is_trivially_copyable<F>::value && std::is_trivially_destructible<F>::value,
+                  "Delegate only holds trivially copyable callables (no String/std::function captures)");
+    new (storage_) F(f);
+    invoke_ = [](void *storage, Args... args) -> R { return (*static_cast<F *>(storage))(std::forward<Args>(args)...); };
+  }
+
+  R operator()(Args... args) const { return invoke_(const_cast<unsigned char *>(storage_), std::forward<Args>(args)...); }
+  explicit operator bool() const { return invoke_ != nullptr; }
+
+private:
+  alignas(void *) unsigned char storage_[Storage] = {};
+  R (*invoke_)(void *, Args...) = nullptr;
+};
+
+/**
+ * @brief Fixed-capacity listener table with generation-checked handles
+ *
+ * Listeners live in MaxListeners slots and are called in subscription
+ * order through a dense index, so dispatch is one thunk call per listener.
+ * A handle is the slot number plus the slot's generation, which moves on
+ * every remove: a stale handle (already removed, or from before a clear())
+ * never removes the listener that reused its slot. Removing a listener
+ * from inside dispatch() is safe; its slot is reused once dispatch returns.
+ * Nothing is allocated after construction. Not thread-safe; used from the
+ * consumer task.
+ */
+template <typename T, size_t MaxListeners = 8> class ListenerRegistry {
+  static_assert(MaxListeners > 0 && MaxListeners <= 256, "Slot number must fit in a byte");
+
+public:
+  using Listener = Delegate<void(const T &)>;
+  using ListenerId = size_t;
+  static constexpr ListenerId INVALID_ID = ~(ListenerId)0;
+
+  ListenerId add(Listener listener) {
+    if (!listener || count_ == MaxListeners) {
+      ESP_LOGE("ListenerRegistry", "Listener rejected (%u of %u slots used)", (unsigned)count_, (unsigned)MaxListeners);
+      return INVALID_ID;
+    }
+    size_t slot = 0;
+    while (slots_[slot].state != Slot::Free) {
+      slot++;
+    }
+    slots_[slot].listener = listener;
+    slots_[slot].state = Slot::Active;
+    order_[count_++] = (uint8_t)slot;
+    return ((ListenerId)slots_[slot].generation << 8) | slot;
+  }
+
+  bool remove(ListenerId id) {
+    size_t slot = id & 0xFF;
+    if (id == INVALID_ID || slot >= MaxListeners || slots_[slot].state != Slot::Active || slots_[slot].generation != (uint32_t)(id >> 8)) {
+      return false;
+    }
+    release(slot);
+    if (dispatching_ == 0) {
+      compact();
+    }
+    return true;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < count_; i++) {
+      if (slots_[order_[i]].state == Slot::Active) {
+        release(order_[i]);
+      }
+    }
+    if (dispatching_ == 0) {
+      compact();
+    }
+  }
+
+  // Listeners added during dispatch see the next event; listeners removed during dispatch are skipped
+  void dispatch(const T &event) {
+    dispatching_++;
+    const size_t count = count_;
+    for (size_t i = 0; i < count; i++) {
+      const Slot &slot = slots_[order_[i]];
+      if (slot.state == Slot::Active) {
+        slot.listener(event);
+      }
+    }
+    if (--dispatching_ == 0 && removed_) {
+      compact();
+    }
+  }
+
+  size_t size() const { return count_ - removed_; }
+  static constexpr size_t capacity() { return MaxListeners; }
+
+private:
+  struct Slot {
+    enum State : uint8_t { Free, Active, Removed }; // Removed: still listed in order_ until the next compact()
+    Listener listener;
+    uint32_t generation = 0;
+    State state = Free;
+  };
+
+  Slot slots_[MaxListeners];
+  uint8_t order_[MaxListeners] = {}; // listed slots in subscription order
+  size_t count_ = 0;                 // entries in order_
+  size_t removed_ = 0;               // entries in order_ waiting for compact()
+  uint8_t dispatching_ = 0;          // nesting depth of dispatch(); order_ is only compacted at depth 0
+
+  void release(size_t slot) {
+    slots_[slot].listener = nullptr;
+    slots_[slot].state = Slot::Removed;
+    slots_[slot].generation = (slots_[slot].generation + 1) & 0x00FFFFFF; // keeps handles within 32 bits
+    removed_++;
+  }
+
+  void compact() {
+    size_t kept = 0;
+    for (size_t i = 0; i < count_; i++) {
+      Slot &slot = slots_[order_[i]];
+      if (slot.state == Slot::Removed) {
+        slot.state = Slot::Free;
+      } else {
+        order_[kept++] = order_[i];
+      }
+    }
+    count_ = kept;
+    removed_ = 0;
+  }
+};
+
+/**
+ * @brief Unsubscribes from its bus when it goes out of scope
+ *
+ * Returned by EventBus::subscribeScoped() and RingEventBus::subscribeScoped().
+ * Move-only; reset() unsubscribes early. A rejected subscription (bus full,
+ * INVALID_ID) is never active.
+ */
+template <typename Bus> class Subscription {
+  static constexpr typename Bus::ListenerId INVALID_ID = ~(typename Bus::ListenerId)0;
+
+public:
+  Subscription() = default;
+  Subscription(Bus &bus, typename Bus::ListenerId id) : bus_(id != INVALID_ID ? &bus : nullptr), id_(id) {}
+  ~Subscription() { reset(); }
+
+  Subscription(const Subscription &) = delete;
+  Subscription &operator=(const Subscription &) = delete;
+  Subscription(Subscription &&other) noexcept : bus_(other.bus_), id_(other.id_) { other.bus_ = nullptr; }
+  Subscription &operator=(Subscription &&other) noexcept {
+    if (this != &other) {
+      reset();
+      bus_ = other.bus_;
+      id_ = other.id_;
+      other.bus_ = nullptr;
+    }
+    return *this;
+  }
+
+  void reset() {
+    if (bus_) {
+      bus_->unsubscribe(id_);
+      bus_ = nullptr;
+    }
+  }
+  bool isActive() const { return bus_ != nullptr && id_ != INVALID_ID; }
+  typename Bus::ListenerId id() const { return id_; }
+
+private:
+  Bus *bus_ = nullptr;
+  typename Bus::ListenerId id_ = INVALID_ID;
+};
+
+} // namespace dict
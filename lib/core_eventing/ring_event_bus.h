@@ -0,0 +1,176 @@
+#pragma once
+#include "common.h"
+#include "event_coalescing.h"
+#include "listener_registry.h"
+#include <atomic>
+#include <type_traits>
+
+namespace dict {
+
+// What publish() does when the ring is full
+enum class OverflowPolicy {
+  DropOldest, // Evict the oldest queued event to make room
+  DropNewest, // Discard the event being published
+  Block       // Wait for the consumer (task context only; from an ISR it drops the new event)
+};
+
+/**
+ * @brief Fixed-capacity, lock-free multi-producer/single-consumer event bus
+ *
+ * Same interface as EventBus, for events published from the NimBLE host
+ * task, other tasks or ISRs. Events live in a ring of Capacity slots, each
+ * with a sequence number (Vyukov's bounded queue): producers claim a slot
+ * with one compare-and-swap on the write index and never take a lock or
+ * allocate. processEvents() delivers at most the events queued when it
+ * starts, so its run time is bounded; events published by listeners are
+ * delivered on the next call. Queued events are folded per
+ * EventCoalescing<T> while draining. Listeners are managed as in EventBus
+ * and must only be changed from the consumer task.
+ */
+template <typename T, size_t Capacity, OverflowPolicy Policy = OverflowPolicy::DropOldest> class RingEventBus {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "Events are copied from ISR context; keep them trivially copyable");
+
+public:
+  using Listener = typename ListenerRegistry<T>::Listener;
+  using ListenerId = typename ListenerRegistry<T>::ListenerId;
+
+  RingEventBus() {
+    for (size_t i = 0; i < Capacity; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Subscribe to events of type T
+   * @param listener Function to call when event is published
+   * @return Unique listener ID for unsubscribing
+   */
+  ListenerId subscribe(Listener listener) { return listeners_.add(listener); }
+
+  /**
+   * @brief Subscribe for the lifetime of the returned Subscription
+   */
+  Subscription<RingEventBus> subscribeScoped(Listener listener) { return Subscription<RingEventBus>(*this, subscribe(listener)); }
+
+  /**
+   * @brief Publish an event (queued for later processing); safe from any task or ISR
+   * @param event The event to publish
+   * @return false if this event was dropped because the ring was full
+   */
+  bool publish(const T &event) {
+    if (tryPush(event)) {
+      return true;
+    }
+    if (Policy == OverflowPolicy::DropOldest) {
+      // A producer preempted mid-write can leave the oldest slot not yet readable; give up after a few tries
+      for (int attempt = 0; attempt < 4; attempt++) {
+        T oldest;
+        if (tryPop(oldest)) {
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (tryPush(event)) {
+          return true;
+        }
+      }
+    } else if (Policy == OverflowPolicy::Block && !xPortInIsrContext()) {
+      while (!tryPush(event)) {
+        vTaskDelay(1);
+      }
+      return true;
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  /**
+   * @brief Process the events queued so far (call from the consumer task only)
+   * @return Events delivered (after coalescing)
+   */
+  size_t processEvents() { return drain(false, 0); }
+
+  /**
+   * @brief Process queued events until micros() passes deadlineUs; the rest stay queued
+   * @return Events delivered (after coalescing)
+   */
+  size_t processEventsUntil(uint32_t deadlineUs) { return drain(true, deadlineUs); }
+
+  /**
+   * @brief Unsubscribe a listener
+   * @param id The listener ID returned by subscribe()
+   */
+  void unsubscribe(ListenerId id) { listeners_.remove(id); }
+
+  /**
+   * @brief Clear all listeners
+   */
+  void clear() { listeners_.clear(); }
+
+  size_t pending() const { return size(); }
+  size_t size() const {
+    size_t queued = writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_acquire);
+    return queued < Capacity ? queued : Capacity;
+  }
+  static constexpr size_t capacity() { return Capacity; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); } // Events lost to overflow so far
+
+private:
+  static constexpr size_t MASK = Capacity - 1;
+
+  struct Cell {
+    std::atomic<size_t> sequence; // == index: free for the write at index; == index + 1: holds that event
+    T event;
+  };
+
+  Cell cells_[Capacity];
+  std::atomic<size_t> writeIndex_{0};
+  std::atomic<size_t> readIndex_{0};
+  std::atomic<uint32_t> dropped_{0};
+  ListenerRegistry<T> listeners_;
+
+  size_t drain(bool hasDeadline, uint32_t deadlineUs) {
+    return drainCoalesced<T>(
+        size(), hasDeadline, deadlineUs, [this](T &event) { return tryPop(event); }, [this](const T &event) { listeners_.dispatch(event); });
+  }
+
+  bool tryPush(const T &event) {
+    size_t pos = writeIndex_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & MASK];
+      intptr_t diff = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+      if (diff == 0) {
+        if (writeIndex_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.event = event;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = writeIndex_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Used by the consumer, and by producers evicting the oldest event
+  bool tryPop(T &event) {
+    size_t pos = readIndex_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & MASK];
+      intptr_t diff = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (readIndex_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          event = cell.event;
+          cell.sequence.store(pos + Capacity, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // empty, or the oldest event is still being written
+      } else {
+        pos = readIndex_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+} // namespace dict
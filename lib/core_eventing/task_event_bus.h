@@ -0,0 +1,207 @@
+#pragma once
+#include "common.h"
+#include "event_coalescing.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "listener_registry.h"
+#include <deque>
+#include <iterator>
+#include <mutex>
+
+namespace dict {
+
+/**
+ * @brief Event bus whose listeners run on their own FreeRTOS tasks
+ *
+ * Each consumer is a task (on any core) with one listener, its own queue of
+ * up to QueueDepth events and a set of task-notification bits. publish()
+ * copies the event into every consumer queue and sets the consumer's bits,
+ * so a consumer sleeps in waitAndProcess() instead of polling and wakes as
+ * soon as something arrives. processEvents() and waitAndProcess() deliver
+ * the calling task's queue only; from any other task they do nothing, which
+ * also lets EventSystem drain the UI loop's queue. A full queue drops its
+ * oldest event. publish() takes a mutex: task context only, not from ISRs.
+ */
+template <typename T, size_t MaxConsumers = 4, size_t QueueDepth = 16> class TaskEventBus {
+public:
+  using Listener = typename ListenerRegistry<T>::Listener;
+  using ListenerId = size_t;
+  static constexpr ListenerId INVALID_ID = ~(ListenerId)0;
+  static constexpr uint32_t DEFAULT_NOTIFY_BITS = 1u << 0;
+
+  /**
+   * @brief Attach a consumer task
+   * @param listener Called on the consumer task from processEvents()/waitAndProcess()
+   * @param notifyBits Notification bits set on the task when an event is queued for it
+   * @param task Consumer task; nullptr for the calling task
+   * @return Consumer ID for detach()
+   */
+  ListenerId attach(Listener listener, uint32_t notifyBits = DEFAULT_NOTIFY_BITS, TaskHandle_t task = nullptr) {
+    if (task == nullptr) {
+      task = xTaskGetCurrentTaskHandle();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < MaxConsumers; i++) {
+      Consumer &consumer = consumers_[i];
+      if (consumer.task == nullptr) {
+        consumer.task = task;
+        consumer.listener = listener;
+        consumer.notifyBits = notifyBits;
+        consumer.queue.clear();
+        return i;
+      }
+    }
+    ESP_LOGE("TaskEventBus", "No free consumer slot (%u used)", (unsigned)MaxConsumers);
+    return INVALID_ID;
+  }
+
+  // Same interface as EventBus: attaches the calling task
+  ListenerId subscribe(Listener listener) { return attach(listener); }
+
+  /**
+   * @brief Detach a consumer; its queued events are dropped
+   */
+  void detach(ListenerId id) {
+    if (id >= MaxConsumers) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    consumers_[id].task = nullptr;
+    consumers_[id].listener = nullptr;
+    consumers_[id].queue.clear();
+  }
+  void unsubscribe(ListenerId id) { detach(id); }
+
+  /**
+   * @brief Queue an event for every consumer and wake their tasks
+   */
+  void publish(const T &event) {
+    TaskHandle_t wake[MaxConsumers];
+    uint32_t bits[MaxConsumers];
+    size_t count = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (Consumer &consumer : consumers_) {
+        if (consumer.task == nullptr) {
+          continue;
+        }
+        if (consumer.queue.size() >= QueueDepth) {
+          consumer.queue.pop_front();
+          dropped_++;
+        }
+        consumer.queue.push_back(event);
+        wake[count] = consumer.task;
+        bits[count++] = consumer.notifyBits;
+      }
+    }
+    for (size_t i = 0; i < count; i++) {
+      xTaskNotify(wake[i], bits[i], eSetBits);
+    }
+  }
+
+  /**
+   * @brief Deliver the calling task's queued events (after coalescing)
+   */
+  size_t processEvents() { return drain(false, 0); }
+  size_t processEventsUntil(uint32_t deadlineUs) { return drain(true, deadlineUs); }
+
+  /**
+   * @brief Sleep until an event is queued for the calling task (or timeout), then deliver
+   * @return Events delivered
+   */
+  size_t waitAndProcess(TickType_t timeout) {
+    uint32_t notifyBits = 0;
+    bool empty = true;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Consumer *consumer = find(xTaskGetCurrentTaskHandle());
+      if (consumer != nullptr) {
+        notifyBits = consumer->notifyBits;
+        empty = consumer->queue.empty();
+      }
+    }
+    if (notifyBits == 0) {
+      vTaskDelay(timeout); // not attached (yet)
+      return 0;
+    }
+    if (empty) {
+      // Clears only our bits, so the task can share its notification value with other sources
+      xTaskNotifyWait(0, notifyBits, nullptr, timeout);
+    }
+    return processEvents();
+  }
+
+  // Events waiting for the calling task
+  size_t pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Consumer *consumer = find(xTaskGetCurrentTaskHandle());
+    return consumer ? consumer->queue.size() : 0;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Consumer &consumer : consumers_) {
+      consumer.task = nullptr;
+      consumer.listener = nullptr;
+      consumer.queue.clear();
+    }
+  }
+
+  uint32_t dropped() const { return dropped_; } // Events lost to full consumer queues so far
+
+private:
+  struct Consumer {
+    TaskHandle_t task = nullptr;
+    Listener listener;
+    uint32_t notifyBits = 0;
+    std::deque<T> queue;
+  };
+
+  Consumer consumers_[MaxConsumers];
+  std::mutex mutex_;
+  uint32_t dropped_ = 0;
+
+  Consumer *find(TaskHandle_t task) {
+    for (Consumer &consumer : consumers_) {
+      if (consumer.task == task) {
+        return &consumer;
+      }
+    }
+    return nullptr;
+  }
+
+  size_t drain(bool hasDeadline, uint32_t deadlineUs) {
+    std::deque<T> events;
+    Listener listener;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Consumer *consumer = find(xTaskGetCurrentTaskHandle());
+      if (consumer == nullptr || consumer->queue.empty()) {
+        return 0;
+      }
+      events.swap(consumer->queue);
+      listener = consumer->listener;
+    }
+
+    size_t delivered = drainCoalesced<T>(
+        events.size(), hasDeadline, deadlineUs,
+        [&](T &event) {
+          event = std::move(events.front());
+          events.pop_front();
+          return true;
+        },
+        [&](const T &event) { listener(event); });
+
+    // Out of time: put the rest back in front of anything published meanwhile
+    if (!events.empty()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Consumer *consumer = find(xTaskGetCurrentTaskHandle());
+      if (consumer != nullptr) {
+        consumer->queue.insert(consumer->queue.begin(), std::make_move_iterator(events.begin()), std::make_move_iterator(events.end()));
+      }
+    }
+    return delivered;
+  }
+};
+
+} // namespace dict
@@ -0,0 +1,53 @@
+#include "function_key_map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace dict {
+
+void FunctionKeyMap::reset() { memcpy(actions_, defaults_.actions, KEY_COUNT); }
+
+bool FunctionKeyMap::isRemapped() const { return memcmp(actions_, defaults_.actions, KEY_COUNT) != 0; }
+
+size_t FunctionKeyMap::format(char *out, size_t size) const {
+  if (out == nullptr || size == 0) {
+    return 0;
+  }
+  size_t length = 0;
+  out[0] = 0;
+  for (size_t keyCode = 0; keyCode < KEY_COUNT; keyCode++) {
+    if (actions_[keyCode] == defaults_.actions[keyCode]) {
+      continue;
+    }
+    int written = snprintf(out + length, size - length, "%s%02x=%u", length ? "," : "", (unsigned)keyCode, (unsigned)actions_[keyCode]);
+    if (written < 0 || (size_t)written >= size - length) {
+      out[0] = 0;
+      return 0;
+    }
+    length += written;
+  }
+  return length;
+}
+
+size_t FunctionKeyMap::parse(const char *text) {
+  size_t applied = 0;
+  while (text != nullptr && *text) {
+    char *end = nullptr;
+    unsigned long keyCode = strtoul(text, &end, 16);
+    if (end != text && *end == '=' && keyCode < KEY_COUNT) {
+      const char *value = end + 1;
+      unsigned long action = strtoul(value, &end, 10);
+      if (end != value && action <= 0xFF) {
+        actions_[keyCode] = (uint8_t)action;
+        applied++;
+      }
+    }
+    text = strchr(text, ',');
+    if (text != nullptr) {
+      text++;
+    }
+  }
+  return applied;
+}
+
+} // namespace dict
@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dict {
+
+/**
+ * @brief HID usage ID -> function key action, remappable at run time
+ *
+ * Actions are plain numbers to keep this portable; the driver stores its
+ * FunctionKeyEvent::Type values (0 is no action). The defaults are a
+ * compile-time table (makeFunctionKeyTable); remap() changes single keys
+ * and reset() goes back to the defaults. format() and parse() turn the
+ * remapped keys into a short string for the settings store, e.g. "3a=5,4f=0".
+ */
+class FunctionKeyMap {
+public:
+  static const size_t KEY_COUNT = 256;
+
+  struct Binding {
+    uint8_t keyCode;
+    uint8_t action;
+  };
+
+  struct Table {
+    uint8_t actions[KEY_COUNT];
+  };
+
+  template <size_t N> static constexpr Table makeFunctionKeyTable(const Binding (&bindings)[N]) {
+    Table table{};
+    for (size_t i = 0; i < N; i++) {
+      table.actions[bindings[i].keyCode] = bindings[i].action;
+    }
+    return table;
+  }
+
+  explicit FunctionKeyMap(const Table &defaults) : defaults_(defaults) { reset(); }
+
+  uint8_t lookup(uint8_t keyCode) const { return actions_[keyCode]; }
+  void remap(uint8_t keyCode, uint8_t action) { actions_[keyCode] = action; } // action 0 unbinds the key
+  void reset();
+  bool isRemapped() const;
+
+  size_t format(char *out, size_t size) const; // Keys that differ from the defaults; returns the length, 0 if it does not fit
+  size_t parse(const char *text);              // Applies "kk=a,..." over the current map; returns the bindings applied
+
+private:
+  const Table &defaults_;
+  uint8_t actions_[KEY_COUNT];
+};
+
+} // namespace dict
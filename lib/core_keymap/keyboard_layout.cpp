@@ -0,0 +1,81 @@
+#include "keyboard_layout.h"
+#include <ctype.h>
+
+namespace dict {
+
+// Each plane is written as one string over the keys that differ between
+// layouts, in HID usage order: the letter keys 0x04..0x1D (a..z on US
+// keycaps), the digit row 0x1E..0x27, the punctuation keys 0x2D..0x38,
+// then the ISO key 0x64. A space marks a key with no ASCII character.
+static const size_t PLANE_CHARS = 26 + 10 + 12 + 1;
+using PlaneString = char[PLANE_CHARS + 1];
+
+static constexpr uint8_t planeKeyCode(size_t i) {
+  return i < 26 ? 0x04 + i : i < 36 ? 0x1E + (i - 26) : i < 48 ? 0x2D + (i - 36) : 0x64;
+}
+
+static constexpr void fillPlane(char *keys, const char *plane) {
+  for (size_t i = 0; i < PLANE_CHARS; i++) {
+    keys[planeKeyCode(i)] = plane[i] == ' ' ? 0 : plane[i];
+  }
+  // Same on every layout and plane: Enter, Escape (a function key), Backspace, Tab, Space
+  keys[0x28] = '\n';
+  keys[0x29] = 0;
+  keys[0x2A] = 0x08;
+  keys[0x2B] = '\t';
+  keys[0x2C] = ' ';
+}
+
+static constexpr KeyboardLayout makeLayout(const char *name, const PlaneString &base, const PlaneString &shift, const PlaneString *altGr = nullptr) {
+  KeyboardLayout layout{name, altGr != nullptr, {}};
+  fillPlane(layout.keys[KeyboardLayout::Base], base);
+  fillPlane(layout.keys[KeyboardLayout::Shift], shift);
+  if (altGr != nullptr) {
+    fillPlane(layout.keys[KeyboardLayout::AltGr], *altGr);
+  }
+  return layout;
+}
+
+// clang-format off
+//                                    letters (US keycaps a..z)       digits 1..0    punctuation     ISO
+static constexpr PlaneString DE_ALTGR = "                @         " "      {[]}" "\\  ~        " "|";
+static constexpr PlaneString FR_ALTGR = "                          " "  #{[| \\^@" "]}          " " ";
+
+static constexpr KeyboardLayout LAYOUTS[(size_t)LayoutId::COUNT] = {
+  makeLayout("US",     "abcdefghijklmnopqrstuvwxyz" "1234567890" "-=[]\\\\;'`,./" "<",
+                       "ABCDEFGHIJKLMNOPQRSTUVWXYZ" "!@#$%^&*()" "_+{}||:\"~<>?" ">"),
+  makeLayout("UK",     "abcdefghijklmnopqrstuvwxyz" "1234567890" "-=[]##;'`,./" "\\",
+                       "ABCDEFGHIJKLMNOPQRSTUVWXYZ" "!\" $%^&*()" "_+{}~~:@ <>?" "|"),
+  makeLayout("DE",     "abcdefghijklmnopqrstuvwxzy" "1234567890" "   +##   ,.-" "<",
+                       "ABCDEFGHIJKLMNOPQRSTUVWXZY" "!\" $%&/()=" "?  *''   ;:_" ">", &DE_ALTGR),
+  makeLayout("FR",     "qbcdefghijkl,noparstuvzxyw" "& \"'(- _  " ")= $**m  ;:!" "<",
+                       "QBCDEFGHIJKL?NOPARSTUVZXYW" "1234567890" " +    M% ./ " ">", &FR_ALTGR),
+  makeLayout("Dvorak", "axje.uidchtnmbrl'poygk,qf;" "1234567890" "[]/=\\\\s-`wvz" "<",
+                       "AXJE>UIDCHTNMBRL\"POYGK<QF:" "!@#$%^&*()" "{}?+||S_~WVZ" ">"),
+};
+// clang-format on
+
+const KeyboardLayout &getKeyboardLayout(LayoutId id) {
+  return (size_t)id < (size_t)LayoutId::COUNT ? LAYOUTS[(size_t)id] : LAYOUTS[(size_t)LayoutId::US];
+}
+
+bool findKeyboardLayout(const char *name, LayoutId &id) {
+  if (name == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < (size_t)LayoutId::COUNT; i++) {
+    const char *a = name;
+    const char *b = LAYOUTS[i].name;
+    while (*a && *b && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+      a++;
+      b++;
+    }
+    if (*a == 0 && *b == 0) {
+      id = (LayoutId)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace dict
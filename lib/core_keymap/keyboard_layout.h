@@ -0,0 +1,53 @@
+#pragma once
+// Keyboard layouts build both for the device and for the host (PlatformIO
+// native env): plain tables, no Arduino types.
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dict {
+
+/**
+ * @brief HID usage ID -> character table for one keyboard layout
+ *
+ * Three planes (unshifted, Shift, AltGr) indexed by HID usage ID, so a
+ * translation is one table index. Tables are generated at compile time from
+ * one string per plane (see keyboard_layout.cpp) and live in flash.
+ * Characters outside printable ASCII (the text areas take ASCII only) and
+ * dead keys map to 0, as do keys the layout leaves empty.
+ */
+struct KeyboardLayout {
+  static const uint8_t KEY_COUNT = 0x65; // Usages 0x00..0x64; 0x64 is the ISO key left of Z
+  enum Plane { Base, Shift, AltGr, PLANES };
+
+  const char *name;
+  bool hasAltGr; // Right Alt selects the AltGr plane; otherwise Alt is ignored
+  char keys[PLANES][KEY_COUNT];
+};
+
+enum class LayoutId : uint8_t { US = 0, UK, DE, FR, Dvorak, COUNT }; // Stored in settings: append new layouts at the end
+
+// HID modifier byte bits
+static const uint8_t HID_MOD_LEFT_SHIFT = 0x02;
+static const uint8_t HID_MOD_RIGHT_SHIFT = 0x20;
+static const uint8_t HID_MOD_RIGHT_ALT = 0x40;
+
+const KeyboardLayout &getKeyboardLayout(LayoutId id); // US for an unknown id
+bool findKeyboardLayout(const char *name, LayoutId &id); // By name, case-insensitive ("us", "de", "dvorak", ...)
+
+// Character for a key under the given modifiers and CapsLock state (CapsLock flips Shift for letters only); 0 if none
+inline char translateKey(const KeyboardLayout &layout, uint8_t keyCode, uint8_t modifiers, bool capsLock) {
+  if (keyCode >= KeyboardLayout::KEY_COUNT) {
+    return 0;
+  }
+  if (layout.hasAltGr && (modifiers & HID_MOD_RIGHT_ALT)) {
+    return layout.keys[KeyboardLayout::AltGr][keyCode];
+  }
+  bool shift = (modifiers & (HID_MOD_LEFT_SHIFT | HID_MOD_RIGHT_SHIFT)) != 0;
+  char base = layout.keys[KeyboardLayout::Base][keyCode];
+  if (capsLock && base >= 'a' && base <= 'z') {
+    shift = !shift;
+  }
+  return layout.keys[shift ? KeyboardLayout::Shift : KeyboardLayout::Base][keyCode];
+}
+
+} // namespace dict
@@ -0,0 +1,211 @@
+#include "event_trace.h"
+#include <string.h>
+
+namespace dict {
+
+static const char MAGIC[4] = {'D', 'T', 'R', 'C'};
+
+static void putU16(uint8_t *out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static void putU32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+static uint16_t getU16(const uint8_t *in) { return in[0] | (in[1] << 8); }
+
+static uint32_t getU32(const uint8_t *in) { return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24); }
+
+// ================================== WRITER ==================================
+bool EventTraceWriter::open(const char *path) {
+  close();
+  file_ = fopen(path, "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  uint8_t header[8];
+  memcpy(header, MAGIC, 4);
+  putU16(header + 4, VERSION);
+  putU16(header + 6, 0);
+  records_ = 0;
+  if (fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void EventTraceWriter::close() {
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool EventTraceWriter::writeKey(uint32_t timeUs, char key, uint8_t keyCode, uint8_t modifiers, bool pressed) {
+  const uint8_t payload[4] = {(uint8_t)key, keyCode, modifiers, (uint8_t)pressed};
+  return writeRecord(timeUs, TraceRecord::Key, payload, sizeof(payload));
+}
+
+bool EventTraceWriter::writeFunctionKey(uint32_t timeUs, uint8_t type, uint8_t repeat) {
+  const uint8_t payload[2] = {type, repeat};
+  return writeRecord(timeUs, TraceRecord::FunctionKey, payload, sizeof(payload));
+}
+
+bool EventTraceWriter::writeResponse(uint32_t timeUs, const std::string &key, const std::string &body) {
+  if (key.size() > 0xFFFF - 2 || 2 + key.size() + body.size() > 0xFFFF) {
+    return false; // does not fit a record
+  }
+  std::string payload(2, '\0');
+  putU16((uint8_t *)&payload[0], (uint16_t)key.size());
+  payload += key;
+  return writeRecord(timeUs, TraceRecord::Response, (const uint8_t *)payload.data(), payload.size(), &body);
+}
+
+bool EventTraceWriter::writeRecord(uint32_t timeUs, TraceRecord::Kind kind, const uint8_t *payload, size_t length, const std::string *tail) {
+  if (file_ == nullptr) {
+    return false;
+  }
+  size_t total = length + (tail ? tail->size() : 0);
+  uint8_t header[7];
+  putU32(header, timeUs);
+  header[4] = kind;
+  putU16(header + 5, (uint16_t)total);
+  bool ok = fwrite(header, 1, sizeof(header), file_) == sizeof(header) && fwrite(payload, 1, length, file_) == length;
+  if (ok && tail && !tail->empty()) {
+    ok = fwrite(tail->data(), 1, tail->size(), file_) == tail->size();
+  }
+  if (ok) {
+    records_++;
+  }
+  return ok;
+}
+
+// ================================== READER ==================================
+bool EventTraceReader::open(const char *path) {
+  close();
+  file_ = fopen(path, "rb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  if (!rewind()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void EventTraceReader::close() {
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool EventTraceReader::rewind() {
+  if (file_ == nullptr || fseek(file_, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  uint8_t header[8];
+  return fread(header, 1, sizeof(header), file_) == sizeof(header) && memcmp(header, MAGIC, 4) == 0 && getU16(header + 4) == EventTraceWriter::VERSION;
+}
+
+bool EventTraceReader::next(TraceRecord &record) {
+  if (file_ == nullptr) {
+    return false;
+  }
+  uint8_t header[7];
+  if (fread(header, 1, sizeof(header), file_) != sizeof(header)) {
+    return false;
+  }
+  record.timeUs = getU32(header);
+  record.kind = (TraceRecord::Kind)header[4];
+  size_t length = getU16(header + 5);
+  std::string payload(length, '\0');
+  if (length > 0 && fread(&payload[0], 1, length, file_) != length) {
+    return false;
+  }
+
+  record.key.clear();
+  record.body.clear();
+  memset(record.data, 0, sizeof(record.data));
+  if (record.kind == TraceRecord::Response) {
+    if (length < 2) {
+      return false;
+    }
+    size_t keyLength = getU16((const uint8_t *)payload.data());
+    if (2 + keyLength > length) {
+      return false;
+    }
+    record.key = payload.substr(2, keyLength);
+    record.body = payload.substr(2 + keyLength);
+  } else {
+    memcpy(record.data, payload.data(), length < sizeof(record.data) ? length : sizeof(record.data));
+    if (record.kind == TraceRecord::Key && length < 4) {
+      record.data[3] = 1; // traces from before key releases were recorded hold presses only
+    }
+  }
+  return true;
+}
+
+// ================================== PLAYER ==================================
+bool TracePlayer::open(const char *path, float speed, uint32_t nowUs) {
+  close();
+  if (!reader_.open(path)) {
+    return false;
+  }
+
+  // Responses first: the lookup that needs one comes before the record of its answer
+  TraceRecord record;
+  while (reader_.next(record)) {
+    if (record.kind == TraceRecord::Response) {
+      responses_[record.key] = record.body;
+    }
+  }
+  reader_.rewind();
+
+  speed_ = speed;
+  startUs_ = nowUs;
+  delivered_ = 0;
+  havePending_ = readInput(pending_);
+  firstRecordUs_ = havePending_ ? pending_.timeUs : 0;
+  return true;
+}
+
+void TracePlayer::close() {
+  reader_.close();
+  responses_.clear();
+  havePending_ = false;
+}
+
+bool TracePlayer::response(const std::string &key, std::string &body) const {
+  auto it = responses_.find(key);
+  if (it == responses_.end()) {
+    return false;
+  }
+  body = it->second;
+  return true;
+}
+
+bool TracePlayer::readInput(TraceRecord &record) {
+  while (reader_.next(record)) {
+    if (record.isInput()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TracePlayer::isDue(uint32_t recordUs, uint32_t nowUs) const {
+  if (speed_ <= 0.0f) {
+    return true;
+  }
+  uint32_t offsetUs = (uint32_t)((recordUs - firstRecordUs_) / speed_);
+  return (int32_t)(nowUs - (startUs_ + offsetUs)) >= 0;
+}
+
+} // namespace dict
@@ -0,0 +1,125 @@
+#pragma once
+// Event traces build both for the device and for the host (PlatformIO native
+// env): plain stdio files and std containers only, no Arduino types.
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+namespace dict {
+
+/**
+ * @brief One record of an event trace
+ *
+ * File layout (little endian): an 8-byte header "DTRC", u16 version, u16 0;
+ * then records of u32 timeUs, u8 kind, u16 payload length, payload.
+ *   Key          char key, u8 keyCode, u8 modifiers, u8 pressed (absent: pressed)
+ *   FunctionKey  u8 type, u8 repeat
+ *   Response     u16 key length, key, body (rest of the payload)
+ */
+struct TraceRecord {
+  enum Kind : uint8_t {
+    Key = 1,         // KeyEvent
+    FunctionKey = 2, // FunctionKeyEvent
+    Response = 3     // Network response body, looked up by key (the word) on replay
+  };
+  uint32_t timeUs = 0; // Since recording started
+  Kind kind = Key;
+  uint8_t data[4] = {}; // Key: key, keyCode, modifiers, pressed; FunctionKey: type, repeat
+  std::string key;      // Response only
+  std::string body;     // Response only
+
+  bool isInput() const { return kind == Key || kind == FunctionKey; }
+};
+
+/**
+ * @brief Appends records to a trace file
+ */
+class EventTraceWriter {
+public:
+  static const uint16_t VERSION = 1;
+
+  ~EventTraceWriter() { close(); }
+
+  bool open(const char *path); // Create (or truncate) the file and write the header
+  void close();
+  bool isOpen() const { return file_ != nullptr; }
+
+  bool writeKey(uint32_t timeUs, char key, uint8_t keyCode, uint8_t modifiers, bool pressed = true);
+  bool writeFunctionKey(uint32_t timeUs, uint8_t type, uint8_t repeat);
+  bool writeResponse(uint32_t timeUs, const std::string &key, const std::string &body);
+  uint32_t getRecordCount() const { return records_; }
+
+private:
+  FILE *file_ = nullptr;
+  uint32_t records_ = 0;
+
+  bool writeRecord(uint32_t timeUs, TraceRecord::Kind kind, const uint8_t *payload, size_t length, const std::string *tail = nullptr);
+};
+
+/**
+ * @brief Reads records back in file order
+ */
+class EventTraceReader {
+public:
+  ~EventTraceReader() { close(); }
+
+  bool open(const char *path); // Fails on a missing file or a header from another version
+  void close();
+  bool isOpen() const { return file_ != nullptr; }
+
+  bool next(TraceRecord &record); // false at the end or on a truncated record
+  bool rewind();
+
+private:
+  FILE *file_ = nullptr;
+};
+
+/**
+ * @brief Plays a trace back against a clock
+ *
+ * open() loads every Response record up front (a lookup happens before its
+ * response was recorded) and then hands out input records through poll()
+ * once they are due: record time / speed after the first input record.
+ * Speed 0 plays as fast as the consumer polls, at most MAX_PER_POLL records
+ * per call so bounded event queues are not overrun.
+ */
+class TracePlayer {
+public:
+  static const size_t MAX_PER_POLL = 8;
+
+  bool open(const char *path, float speed, uint32_t nowUs);
+  void close();
+  bool isOpen() const { return reader_.isOpen(); }
+
+  // Calls deliver(const TraceRecord &) for each input record due at nowUs; false once the trace is used up
+  template <typename Deliver> bool poll(uint32_t nowUs, Deliver deliver) {
+    size_t count = 0;
+    while (havePending_ && count < MAX_PER_POLL && isDue(pending_.timeUs, nowUs)) {
+      deliver(pending_);
+      delivered_++;
+      count++;
+      havePending_ = readInput(pending_);
+    }
+    return havePending_;
+  }
+
+  bool response(const std::string &key, std::string &body) const; // Recorded response for key, if any
+  uint32_t getDeliveredCount() const { return delivered_; }
+  size_t getResponseCount() const { return responses_.size(); }
+
+private:
+  EventTraceReader reader_;
+  std::map<std::string, std::string> responses_;
+  TraceRecord pending_;
+  bool havePending_ = false;
+  float speed_ = 1.0f;
+  uint32_t startUs_ = 0;
+  uint32_t firstRecordUs_ = 0;
+  uint32_t delivered_ = 0;
+
+  bool readInput(TraceRecord &record);
+  bool isDue(uint32_t recordUs, uint32_t nowUs) const;
+};
+
+} // namespace dict
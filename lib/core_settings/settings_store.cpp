@@ -0,0 +1,251 @@
+#include "settings_store.h"
+#include "log.h"
+#include <string.h>
+
+namespace dict {
+
+static const char *TAG = "Settings";
+
+SettingsStore &SettingsStore::instance() {
+  static SettingsStore instance;
+  return instance;
+}
+
+bool SettingsStore::initialize() {
+  initialized_ = true;
+  ESP_LOGI(TAG, "Settings store ready (commit after %u ms idle)", (unsigned)COMMIT_DELAY_MS);
+  return true;
+}
+
+void SettingsStore::shutdown() {
+  flush();
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  initialized_ = false;
+}
+
+void SettingsStore::tick() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_) {
+      return;
+    }
+    uint32_t now = millis();
+    if (now - lastChangeMs_ < COMMIT_DELAY_MS && now - firstDirtyMs_ < MAX_DEFER_MS) {
+      return;
+    }
+  }
+  commit();
+}
+
+void SettingsStore::flush() { commit(); }
+
+bool SettingsStore::hasPendingWrites() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dirty_;
+}
+
+// ================================== CACHE ==================================
+SettingsStore::Entry &SettingsStore::entry(const char *ns, const char *key, Type type) {
+  for (Entry &e : entries_) {
+    if (strcmp(e.key, key) == 0 && strcmp(e.ns, ns) == 0) {
+      if (e.type != type && !e.present) {
+        e.type = type; // removed or never written: free to take the new type
+      } else if (e.type != type) {
+        ESP_LOGW(TAG, "%s/%s used with a different type", ns, key);
+      }
+      return e;
+    }
+  }
+
+  Entry e{ns, key, type, false, false, 0.0f, 0, String()};
+  Preferences preferences;
+  if (preferences.begin(ns, true)) { // fails when the namespace was never written
+    e.present = preferences.isKey(key);
+    if (e.present) {
+      switch (type) {
+      case Type::Float:
+        e.f = preferences.getFloat(key, 0.0f);
+        break;
+      case Type::Int:
+        e.i = preferences.getInt(key, 0);
+        break;
+      case Type::String:
+        e.s = preferences.getString(key, "");
+        break;
+      }
+    }
+    preferences.end();
+  }
+  ESP_LOGD(TAG, "Loaded %s/%s (%s)", ns, key, e.present ? "present" : "missing");
+  entries_.push_back(e);
+  return entries_.back();
+}
+
+void SettingsStore::markDirty(Entry &e) {
+  uint32_t now = millis();
+  if (!dirty_) {
+    firstDirtyMs_ = now;
+  }
+  e.dirty = true;
+  dirty_ = true;
+  lastChangeMs_ = now;
+}
+
+float SettingsStore::getFloat(const char *ns, const char *key, float defaultValue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry &e = entry(ns, key, Type::Float);
+  return e.present ? e.f : defaultValue;
+}
+
+void SettingsStore::putFloat(const char *ns, const char *key, float value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry &e = entry(ns, key, Type::Float);
+  if (e.present && e.f == value) {
+    return;
+  }
+  e.f = value;
+  e.present = true;
+  markDirty(e);
+}
+
+int32_t SettingsStore::getInt(const char *ns, const char *key, int32_t defaultValue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry &e = entry(ns, key, Type::Int);
+  return e.present ? e.i : defaultValue;
+}
+
+void SettingsStore::putInt(const char *ns, const char *key, int32_t value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry &e = entry(ns, key, Type::Int);
+  if (e.present && e.i == value) {
+    return;
+  }
+  e.i = value;
+  e.present = true;
+  markDirty(e);
+}
+
+String SettingsStore::getString(const char *ns, const char *key, const String &defaultValue) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry &e = entry(ns, key, Type::String);
+  return e.present ? e.s : defaultValue;
+}
+
+void SettingsStore::putString(const char *ns, const char *key, const String &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry &e = entry(ns, key, Type::String);
+  if (e.present && e.s == value) {
+    return;
+  }
+  e.s = value;
+  e.present = true;
+  markDirty(e);
+}
+
+bool SettingsStore::has(const char *ns, const char *key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Entry &e : entries_) {
+    if (strcmp(e.key, key) == 0 && strcmp(e.ns, ns) == 0) {
+      return e.present;
+    }
+  }
+  // Not cached yet: only the key matters, not its type
+  Preferences preferences;
+  if (!preferences.begin(ns, true)) {
+    return false;
+  }
+  bool present = preferences.isKey(key);
+  preferences.end();
+  return present;
+}
+
+void SettingsStore::remove(const char *ns, const char *key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Entry &e : entries_) {
+    if (strcmp(e.key, key) == 0 && strcmp(e.ns, ns) == 0) {
+      if (e.present) {
+        e.present = false;
+        markDirty(e);
+      }
+      return;
+    }
+  }
+  // Not cached: cache it as removed so the NVS copy goes on the next commit
+  entries_.push_back(Entry{ns, key, Type::String, false, false, 0.0f, 0, String()});
+  markDirty(entries_.back());
+}
+
+// ================================== COMMIT ==================================
+void SettingsStore::commit() {
+  // Take a snapshot so NVS is written without holding the lock
+  std::vector<Entry, PsramAllocator<Entry>> pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_) {
+      return;
+    }
+    for (Entry &e : entries_) {
+      if (e.dirty) {
+        pending.push_back(e);
+        e.dirty = false;
+      }
+    }
+    dirty_ = false;
+  }
+
+  // One transaction per namespace, however many keys changed in it
+  std::vector<bool> done(pending.size(), false);
+  for (size_t first = 0; first < pending.size(); first++) {
+    if (done[first]) {
+      continue;
+    }
+    const char *ns = pending[first].ns;
+    Preferences preferences;
+    bool opened = preferences.begin(ns, false);
+    size_t written = 0;
+    for (size_t n = first; n < pending.size(); n++) {
+      const Entry &e = pending[n];
+      if (done[n] || strcmp(e.ns, ns) != 0) {
+        continue;
+      }
+      done[n] = true;
+      bool ok = false;
+      if (opened && !e.present) {
+        ok = !preferences.isKey(e.key) || preferences.remove(e.key);
+      } else if (opened) {
+        switch (e.type) {
+        case Type::Float:
+          ok = preferences.putFloat(e.key, e.f) > 0;
+          break;
+        case Type::Int:
+          ok = preferences.putInt(e.key, e.i) > 0;
+          break;
+        case Type::String:
+          ok = preferences.putString(e.key, e.s) > 0 || e.s.length() == 0;
+          break;
+        }
+      }
+      if (ok) {
+        written++;
+        continue;
+      }
+      // Keep it dirty for the next commit unless it changed meanwhile (then it is dirty already)
+      ESP_LOGE(TAG, "Failed to write %s/%s", ns, e.key);
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (Entry &cached : entries_) {
+        if (strcmp(cached.key, e.key) == 0 && strcmp(cached.ns, ns) == 0) {
+          markDirty(cached);
+          break;
+        }
+      }
+    }
+    if (opened) {
+      preferences.end();
+      commits_++;
+    }
+    ESP_LOGI(TAG, "Committed %u setting(s) in %s", (unsigned)written, ns);
+  }
+}
+
+} // namespace dict
@@ -0,0 +1,82 @@
+#pragma once
+#include "common.h"
+#include "psram_allocator.h"
+#include <Preferences.h>
+#include <mutex>
+#include <vector>
+
+namespace dict {
+
+/**
+ * @brief Typed in-RAM cache of all persisted settings, written back to NVS lazily
+ *
+ * A setting is read from NVS once, on first access; after that reads and
+ * writes only touch RAM. Changed settings are marked dirty and committed by
+ * tick() once no change has happened for COMMIT_DELAY_MS (or, under constant
+ * changes, at most MAX_DEFER_MS after the first one), one NVS open per
+ * namespace. flush() commits at once, for settings that must survive an
+ * immediate power loss. Namespaces and keys are the existing NVS ones and
+ * must be string literals (they are kept by pointer). Safe to call from any
+ * task; NVS is only written from the task calling tick() or flush().
+ */
+class SettingsStore {
+public:
+  static const uint32_t COMMIT_DELAY_MS = 2000;
+  static const uint32_t MAX_DEFER_MS = 10000;
+
+  // Singleton access
+  static SettingsStore &instance(); // Get singleton instance
+
+  // Core lifecycle methods
+  bool initialize();                            // Prepare the store (settings are loaded lazily)
+  void shutdown();                              // Commit pending changes and drop the cache
+  void tick();                                  // Commit dirty settings once they have settled
+  bool isReady() const { return initialized_; } // Check if the store is ready
+
+  // Typed access; a missing setting reads as the default
+  float getFloat(const char *ns, const char *key, float defaultValue);
+  void putFloat(const char *ns, const char *key, float value);
+  int32_t getInt(const char *ns, const char *key, int32_t defaultValue);
+  void putInt(const char *ns, const char *key, int32_t value);
+  String getString(const char *ns, const char *key, const String &defaultValue = String());
+  void putString(const char *ns, const char *key, const String &value);
+  bool has(const char *ns, const char *key);    // Setting exists (in RAM or NVS)
+  void remove(const char *ns, const char *key); // Delete the setting (from NVS on commit)
+
+  void flush();                                        // Commit dirty settings now
+  bool hasPendingWrites() const;                       // Any setting not yet committed
+  uint32_t getCommitCount() const { return commits_; } // NVS write transactions so far
+
+private:
+  // Private constructor/destructor for singleton
+  SettingsStore() = default;
+  ~SettingsStore() = default;
+  SettingsStore(const SettingsStore &) = delete;
+  SettingsStore &operator=(const SettingsStore &) = delete;
+
+  enum class Type : uint8_t { Float, Int, String };
+  struct Entry {
+    const char *ns;
+    const char *key;
+    Type type;
+    bool present; // false: not in NVS / removed
+    bool dirty;   // differs from NVS
+    float f;
+    int32_t i;
+    String s;
+  };
+
+  bool initialized_ = false;
+  std::vector<Entry, PsramAllocator<Entry>> entries_;
+  mutable std::mutex mutex_;
+  uint32_t firstDirtyMs_ = 0;
+  uint32_t lastChangeMs_ = 0;
+  bool dirty_ = false;
+  uint32_t commits_ = 0;
+
+  Entry &entry(const char *ns, const char *key, Type type); // Cached entry, loaded from NVS on first use (lock held)
+  void markDirty(Entry &e);                                 // Record a change (lock held)
+  void commit();                                            // Write dirty entries to NVS, one transaction per namespace
+};
+
+} // namespace dict
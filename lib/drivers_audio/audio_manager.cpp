@@ -1,27 +1,71 @@
 #include "audio_manager.h"
+#include "core_eventing/connectivity_state.h"
 #include "core_misc/log.h"
 #include "drivers_i2c/i2c_manager.h"
-#include "network_control.h"
-#include "ui_status.h"
 
 namespace dict {
 
 static const char *TAG = "AudioManager";
 
+// Stall handling: after STALL_RESUME_MS without data from the connection we
+// reconnect with a Range request on the fetch task, up to MAX_RESUMES times per
+// clip, while the read-ahead keeps playing. The source's own no-data timeout
+// only ends the clip once resuming has had a fair chance.
+static const uint32_t STALL_RESUME_MS = 750;
+static const uint8_t MAX_RESUMES = 4;
+static const uint32_t NO_DATA_TIMEOUT_MS = 10000;
+
+// Per stream; about 16 s of a 32 kbps clip, so the next request usually goes out
+// long before the current clip ends
+static const size_t READ_AHEAD_BYTES = 64 * 1024;
+static const char *URL_SOURCE_MIME = "audio/mp3";
+
+// The ES8311 I2S link runs stereo frames; mono clips are upmixed on the way out
+static const uint8_t I2S_LINK_CHANNELS = 2;
+
+// Short fade-in at the start of each clip, hides the click of a non-zero first sample
+static const uint32_t CLIP_FADE_IN_MS = 8;
+
+// UI sounds sit under speech level; the key click quieter still since it repeats a lot
+static const int16_t UI_SOUND_GAIN = Q15_ONE / 2;
+static const int16_t KEY_CLICK_GAIN = Q15_ONE / 4;
+
+// Audio task: core 0 keeps decoding off the LVGL core; the stack is sized for the Opus decoder
+static const uint32_t AUDIO_TASK_STACK = 16 * 1024;
+static const UBaseType_t AUDIO_TASK_PRIORITY = 3;
+static const BaseType_t AUDIO_TASK_CORE = 0;
+static const uint32_t AUDIO_TASK_IDLE_WAIT_MS = 100;   // Longest sleep between ticks while silent; commands wake the task at once
+static const uint32_t AUDIO_TASK_COMMAND_BIT = 1u << 0; // Task notification bit for queued commands
+
+// Fetch task: below the audio task, so decoding from the read-ahead always wins; mostly waits on the network.
+// The stack holds a TLS handshake.
+static const uint32_t FETCH_TASK_STACK = 8 * 1024;
+static const UBaseType_t FETCH_TASK_PRIORITY = 2;
+static const uint32_t FETCH_TASK_IDLE_WAIT_MS = 100; // Longest sleep between stop-flag checks
+
+// Status line label for the decoder MultiDecoder picked; only MP3 and Opus are registered
+static const char *codecLabel(const char *mime) {
+  return strcmp(mime, "audio/ogg") == 0 || strcmp(mime, "audio/opus") == 0 ? "opus" : "mp3";
+}
+
 AudioManager &AudioManager::instance() {
   static AudioManager instance;
   return instance;
 }
 
 AudioManager::AudioManager()
-    : board(AudioDriverES8311, NoPins), out(board), info(32000, 2, 16), player(nullptr), decoder(), urlSource(nullptr), urlStream(),
-      initialized_(false), isPlaying(false), volume_(0.7f) {
-  // Initialize preferences for volume persistence
-  if (!preferences.begin("audio_config", false)) {
-    ESP_LOGE(TAG, "Failed to open audio preferences");
-  } else {
-    ESP_LOGI(TAG, "Audio preferences initialized successfully");
-  }
+    : board(AudioDriverES8311, NoPins), out(board), boardTap(out, metrics_, MeteredOutput::Board), uiMixer(boardTap),
+      formatStage(uiMixer, I2S_LINK_CHANNELS), timeStretch(formatStage), gainStage(timeStretch), meteredOut(gainStage, metrics_), player(nullptr), decoder(), mp3Decoder(), opusDecoder(), keepAliveClient(client), urlStream(), urlSource{nullptr, nullptr},
+      current_(0), readAhead_(nullptr), prefetchTried_(false), initialized_(false), isPlaying(false), volume_(0.7f), uiSoundPcm_(nullptr), stretchWork_(nullptr),
+      taskHandle_(nullptr), taskStopRequested_(false), taskAttached_(false),
+      commandListenerId_(EventBusFor<AudioCommandEvent>::INVALID_ID), state_(AudioStateEvent::Idle), codec_(""), fetchTaskHandle_(nullptr),
+      fetchStopRequested_(false), fetchJob_(FetchNone), fetchStream_(0) {
+  // Codec per clip: the response's Content-Type, or the Ogg/MP3 signature when the header is missing
+  decoder.setMimeSource(urlStream[0]);
+  decoder.addDecoder(mp3Decoder, "audio/mpeg");
+  decoder.addDecoder(mp3Decoder, "audio/mp3"); // non-standard, but what some servers send
+  decoder.addDecoder(opusDecoder, "audio/ogg");
+  decoder.addDecoder(opusDecoder, "audio/opus");
 }
 
 bool AudioManager::initialize() {
@@ -59,13 +103,51 @@ bool AudioManager::initialize() {
     return false;
   }
 
-  // Load saved volume from preferences, default to 0.7 if not found
-  float savedVolume = preferences.getFloat("volume", 0.7f);
-  volume_ = savedVolume;
+  // One TLS client for all clips; ask the server to keep the connection open
+  client.setInsecure();
+  if (!readAhead_) {
+    readAhead_ = (uint8_t *)ps_malloc(2 * READ_AHEAD_BYTES);
+    if (!readAhead_) {
+      ESP_LOGE(TAG, "No PSRAM for read-ahead, next clips are requested when the current one ends");
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    urlStream[i].setClient(keepAliveClient);
+    urlStream[i].httpRequest().setConnection(CON_KEEP_ALIVE);
+    urlStream[i].setReadAheadBuffer(readAhead_ ? readAhead_ + i * READ_AHEAD_BYTES : nullptr, READ_AHEAD_BYTES);
+    urlStream[i].setMetrics(&metrics_);
+  }
+
+  // Load saved volume from settings, default to 0.7 if not found
+  volume_ = SettingsStore::instance().getFloat("audio_config", "volume", 0.7f);
   out.setVolume(volume_);
-  ESP_LOGI(TAG, "Volume loaded from preferences: %.2f", volume_);
+  ESP_LOGI(TAG, "Volume loaded from settings: %.2f", volume_);
+
+  // UI sounds can play before any clip has configured the link
+  uiMixer.setAudioInfo(out.audioInfo());
+  loadUiSounds();
+
+  // Fixed working buffer for the time-stretch; without it playback stays at 1.0x
+  if (!stretchWork_) {
+    stretchWork_ = (int16_t *)ps_malloc(TimeStretchStage::WORK_SAMPLES * sizeof(int16_t));
+    if (stretchWork_) {
+      timeStretch.setWorkBuffer(stretchWork_, TimeStretchStage::WORK_SAMPLES);
+    } else {
+      ESP_LOGE(TAG, "No PSRAM for time-stretch, speed control disabled");
+    }
+  }
+
+  // State events are handled wherever processAllEvents() runs (the UI loop); status only, so after everything else
+  EventSystem::instance().registerEventBus<AudioStateEvent>(EventPriority::Low);
+
+  fetchStopRequested_ = false;
+  if (xTaskCreatePinnedToCore(fetchTask, "audio_fetch", FETCH_TASK_STACK, this, FETCH_TASK_PRIORITY, &fetchTaskHandle_, AUDIO_TASK_CORE) != pdPASS) {
+    fetchTaskHandle_ = nullptr;
+    ESP_LOGE(TAG, "Failed to create fetch task, resumes block playback while they run");
+  }
 
   initialized_ = true;
+  ConnectivityState::instance().set(ConnectivityEvent::Audio, true);
   ESP_LOGI(TAG, "AudioManager initialized successfully");
   return true;
 }
@@ -76,18 +158,36 @@ void AudioManager::shutdown() {
   }
 
   ESP_LOGI(TAG, "Shutting down AudioManager...");
+  stopTask();
 
   // Stop any current playback
   if (isPlaying) {
     stop();
   }
+  if (fetchTaskHandle_ != nullptr) {
+    fetchStopRequested_ = true;
+    xTaskNotifyGive(fetchTaskHandle_);
+    while (fetchTaskHandle_ != nullptr) {
+      delay(5);
+    }
+  }
+  keepAliveClient.close();
+  uiMixer.stopAll();
 
   initialized_ = false;
+  ConnectivityState::instance().set(ConnectivityEvent::Audio, false);
   ESP_LOGI(TAG, "AudioManager shutdown complete");
 }
 
 void AudioManager::tick() {
-  if (!initialized_ || !player) {
+  if (!initialized_) {
+    return;
+  }
+  // No speech to carry them: write UI sounds over silence, one block per tick
+  if (!isPlaying && uiMixer.isActive()) {
+    uiMixer.pump(UiSoundMixer::BLOCK_FRAMES);
+  }
+  if (!player) {
     return;
   }
   if (player && player->getStream()) {
@@ -97,9 +197,33 @@ void AudioManager::tick() {
       } catch (...) {
         ESP_LOGE(TAG, "player->copy() failed, ignoring.");
       }
+      // The codec is known once the decoder has seen the Content-Type or the first bytes
+      const char *mime = decoder.selectedMime();
+      if (isPlaying && codec_[0] == '\0' && mime != nullptr && mime[0] != '\0') {
+        codec_ = codecLabel(mime);
+        publishState(state_);
+      }
+      if (isPlaying && !queue_.empty()) {
+        prefetchNext();
+      }
+      // Butt the next clip against this one as soon as its body is consumed,
+      // rather than waiting for the source's no-data timeout
+      if (isPlaying && !queue_.empty() && isClipDrained()) {
+        if (!isFetchBusy()) {
+          startNextInQueue(); // else the next request is still on its way: switch once it is in
+        }
+      } else if (isPlaying && !isClipDrained()) {
+        metrics_.sampleBufferFill(urlStream[current_].available());
+        metrics_.checkUnderrun();
+        resumeIfStalled();
+      }
     } else { // timeout detected, clean up
       if (isPlaying) {
+        if (startNextInQueue()) {
+          return;
+        }
         ESP_LOGI(TAG, "Player timeout detected, stopping and cleaning up");
+        timeStretch.flush(); // the last few ms of the clip are still in the stretch buffer
         stop();
       }
     }
@@ -118,27 +242,40 @@ bool AudioManager::play(const char *url) {
   if (isPlaying) {
     stop();
   }
+  clearQueue();
 
   decoder.begin();
 
   // Create appropriate source based on URL
   if (!isUrl(url)) {
     ESP_LOGE(TAG, "URL is not a valid URL");
+    publishState(AudioStateEvent::Error);
     return false;
   }
 
-  createUrlSource(url);
-  if (!urlSource) {
+  // Keep our own copy, the source only holds on to the pointer
+  currentUrl_ = url;
+  createUrlSources(currentUrl_.c_str());
+  if (!urlSource[0] || !urlSource[1]) {
     ESP_LOGE(TAG, "Failed to create URL source");
+    publishState(AudioStateEvent::Error);
     return false;
   }
   // Create player with URL source
-  player = new AudioPlayer(*urlSource, out, decoder);
+  // decoder -> meteredOut -> gainStage -> timeStretch -> formatStage -> uiMixer -> boardTap -> out; the decoder's format
+  // notification reaches formatStage, which reconfigures I2S/ES8311 only when the format changes
+  current_ = 0;
+  prefetchTried_ = false;
+  decoder.setMimeSource(urlStream[current_]);
+  player = new AudioPlayer(*urlSource[current_], meteredOut, decoder);
 
   if (!player) {
     ESP_LOGE(TAG, "Failed to create AudioPlayer");
     return false;
   }
+  // Fades are done by gainStage (fixed point, unity passes through); the player's
+  // own float fade would touch every sample
+  player->setAutoFade(false);
 
   // Set up metadata callback
   // player->setMetadataCallback(staticMetadataCallback);
@@ -149,14 +286,20 @@ bool AudioManager::play(const char *url) {
   //  [ 43842][I][audio_manager.cpp:266] staticMetadataCallback(): [AudioManager] Metadata [Other]: Drum Solo
 
   // Start playback
-  StatusOverlay::instance().updateAudioStatus(AudioState::Working, "mp3");
+  codec_ = ""; // set from the decoder's choice in tick()
+  publishState(AudioStateEvent::Connecting);
+  metrics_.onClipStart();
+  gainStage.gain().set(0);
+  gainStage.rampTo(1.0f, CLIP_FADE_IN_MS);
   if (player->begin()) {
     isPlaying = true;
 
     ESP_LOGI(TAG, "Playback started successfully");
+    publishState(AudioStateEvent::Playing);
     return true;
   } else {
     ESP_LOGE(TAG, "Failed to start playback");
+    publishState(AudioStateEvent::Error);
     return false;
   }
 }
@@ -173,9 +316,16 @@ bool AudioManager::stop() {
     ESP_LOGI(TAG, "Stopping playback");
 
     isPlaying = false; // Stop the player before cleaning up
+    waitForFetch();
+    clearQueue();
+    metrics_.onClipEnd(urlStream[current_].position());
+    if (!urlStream[current_].isReusable()) {
+      keepAliveClient.close(); // unread body left on the socket, or a body that only ends on close
+    }
     player->stop();
+    timeStretch.clear();
     decoder.clearNotifyAudioChange();
-    StatusOverlay::instance().updateAudioStatus(AudioState::Ready);
+    publishState(AudioStateEvent::Idle);
     player->end();
     delay(10);
     decoder.end();
@@ -189,6 +339,215 @@ bool AudioManager::stop() {
   return true;
 }
 
+bool AudioManager::playUiSound(UiSound sound) {
+  if (!initialized_) {
+    return false;
+  }
+  return uiMixer.trigger(sound, sound == UiSound::KeyClick ? KEY_CLICK_GAIN : UI_SOUND_GAIN);
+}
+
+void AudioManager::loadUiSounds() {
+  if (uiSoundPcm_) {
+    return;
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < UI_SOUND_COUNT; i++) {
+    total += UiSoundMixer::synthesizedFrames((UiSound)i);
+  }
+  uiSoundPcm_ = (int16_t *)ps_malloc(total * sizeof(int16_t));
+  if (!uiSoundPcm_) {
+    ESP_LOGE(TAG, "No PSRAM for UI sounds, they stay silent");
+    return;
+  }
+  int16_t *pcm = uiSoundPcm_;
+  for (size_t i = 0; i < UI_SOUND_COUNT; i++) {
+    size_t frames = UiSoundMixer::synthesize((UiSound)i, pcm, total - (pcm - uiSoundPcm_));
+    uiMixer.setSound((UiSound)i, pcm, frames);
+    pcm += frames;
+  }
+  ESP_LOGI(TAG, "UI sounds loaded: %u bytes", (unsigned)(total * sizeof(int16_t)));
+}
+
+bool AudioManager::enqueue(const char *url) {
+  if (!initialized_) {
+    ESP_LOGE(TAG, "AudioManager not initialized");
+    return false;
+  }
+  if (!isUrl(url)) {
+    ESP_LOGE(TAG, "URL is not a valid URL");
+    return false;
+  }
+  if (!isPlaying) {
+    return play(url);
+  }
+
+  queue_.push_back(url);
+  ESP_LOGI(TAG, "Queued: %s (%u waiting)", url, (unsigned)queue_.size());
+  publishState(state_);
+  return true;
+}
+
+bool AudioManager::skip() {
+  if (!initialized_ || !isPlaying) {
+    return false;
+  }
+  if (queue_.empty()) {
+    return stop();
+  }
+  return startNextInQueue();
+}
+
+void AudioManager::clearQueue() {
+  queue_.clear();
+  cancelPrefetch();
+}
+
+bool AudioManager::startNextInQueue() {
+  if (queue_.empty() || !player || !urlSource[0] || !urlSource[1]) {
+    return false;
+  }
+
+  waitForFetch(); // a resume still holding the connection is abandoned with the clip
+  ResumableURLStream &previous = urlStream[current_];
+  uint8_t next = 1 - current_;
+  metrics_.onClipEnd(previous.position());
+  currentUrl_ = queue_.front();
+  queue_.pop_front();
+  ESP_LOGI(TAG, "Next in queue: %s (%u waiting, %s)", currentUrl_.c_str(), (unsigned)queue_.size(),
+           urlStream[next].isPrefetched() ? "prefetched" : "requesting");
+
+  // I2S, codec, decoder and player stay up; the player moves over to the other source.
+  // A fully read, explicitly framed response leaves the keep-alive connection ready for the next GET;
+  // a prefetch is only sent on such a connection.
+  if (!urlStream[next].isPrefetched() && !previous.isReusable()) {
+    keepAliveClient.close();
+  }
+  previous.end();
+  timeStretch.flush();
+  current_ = next;
+  prefetchTried_ = false;
+  codec_ = "";
+  urlSource[current_]->clear();
+  urlSource[current_]->addURL(currentUrl_.c_str());
+  decoder.setMimeSource(urlStream[current_]);
+  player->setAudioSource(*urlSource[current_]);
+  metrics_.onClipStart();
+  gainStage.gain().set(0);
+  gainStage.rampTo(1.0f, CLIP_FADE_IN_MS);
+  if (!player->setIndex(0)) {
+    ESP_LOGE(TAG, "Failed to open next queued clip");
+    return false;
+  }
+  player->setActive(true);
+  publishState(AudioStateEvent::Playing);
+  return true;
+}
+
+// Once the current body is off the connection (into the read-ahead), the same
+// keep-alive connection can carry the next clip's request while this one plays.
+// The request and its reply headers are handled by the fetch task.
+void AudioManager::prefetchNext() {
+  if (prefetchTried_ || isFetchBusy() || queue_.empty() || !urlStream[current_].isReusable()) {
+    return;
+  }
+  prefetchTried_ = true;
+  prefetchUrl_ = queue_.front();
+  startFetch(FetchPrefetch, 1 - current_);
+}
+
+void AudioManager::cancelPrefetch() {
+  waitForFetch();
+  ResumableURLStream &next = urlStream[1 - current_];
+  if (next.isPrefetched()) {
+    next.cancelPrefetch();
+    keepAliveClient.close(); // its body is still on the connection
+  }
+  prefetchTried_ = false;
+}
+
+bool AudioManager::isClipDrained() { return urlStream[current_].isDrained(); }
+
+// Runs as soon as the connection stalls, usually with seconds of the clip still in the
+// read-ahead; the reconnect happens on the fetch task while that plays
+void AudioManager::resumeIfStalled() {
+  ResumableURLStream &stream = urlStream[current_];
+  if (isFetchBusy() || stream.isBodyComplete()) {
+    return;
+  }
+  bool dropped = stream.isConnectionLost();
+  if (!dropped && stream.msSinceLastData() < STALL_RESUME_MS) {
+    return;
+  }
+  if (stream.resumeCount() >= MAX_RESUMES || !ConnectivityState::instance().isUp(ConnectivityEvent::WiFi)) {
+    return; // leave it to the no-data timeout
+  }
+
+  ESP_LOGW(TAG, "Stream %s at byte %u (%d buffered), resuming (attempt %u)", dropped ? "dropped" : "stalled", (unsigned)stream.position(),
+           stream.available(), (unsigned)stream.resumeCount() + 1);
+  metrics_.onStall();
+  startFetch(FetchResume, current_);
+}
+
+void AudioManager::dropConnection() { keepAliveClient.close(); }
+
+// ================================ FETCH TASK ================================
+void AudioManager::startFetch(FetchJob job, uint8_t stream) {
+  urlStream[stream].setFetching(true);
+  fetchStream_ = stream;
+  fetchJob_ = job;
+  if (fetchTaskHandle_ == nullptr) {
+    runFetchJob(job); // no fetch task: block here, as before there was one
+    fetchJob_ = FetchNone;
+    return;
+  }
+  xTaskNotifyGive(fetchTaskHandle_);
+}
+
+void AudioManager::runFetchJob(FetchJob job) {
+  ResumableURLStream &stream = urlStream[fetchStream_];
+  switch (job) {
+  case FetchResume:
+    keepAliveClient.close(); // never resume on a connection that may still carry the old body
+    if (!stream.resume()) {
+      ESP_LOGW(TAG, "Resume failed");
+    }
+    break;
+  case FetchPrefetch:
+    if (!stream.prefetch(prefetchUrl_.c_str(), URL_SOURCE_MIME)) {
+      ESP_LOGW(TAG, "Prefetch of %s failed, requesting it at the switch", prefetchUrl_.c_str());
+      keepAliveClient.close(); // a half-read reply must not be taken for the next one
+    }
+    break;
+  case FetchNone:
+    break;
+  }
+  stream.setFetching(false);
+}
+
+void AudioManager::waitForFetch() {
+  if (!isFetchBusy()) {
+    return;
+  }
+  urlStream[fetchStream_].abortFetch();
+  while (isFetchBusy()) {
+    delay(1);
+  }
+}
+
+void AudioManager::fetchTask(void *parameter) {
+  AudioManager *self = static_cast<AudioManager *>(parameter);
+  while (!self->fetchStopRequested_) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FETCH_TASK_IDLE_WAIT_MS));
+    FetchJob job = (FetchJob)self->fetchJob_.load();
+    if (job != FetchNone) {
+      self->runFetchJob(job);
+      self->fetchJob_ = FetchNone;
+    }
+  }
+  self->fetchTaskHandle_ = nullptr;
+  vTaskDelete(nullptr);
+}
+
 void AudioManager::setVolume(float volume) {
   if (!initialized_) {
     return;
@@ -201,10 +560,132 @@ void AudioManager::setVolume(float volume) {
   volume_ = volume;
   out.setVolume(volume_);
 
-  // Save volume to preferences for persistence across reboots
-  preferences.putFloat("volume", volume_);
+  // Persist across reboots; a run of F10/F11 presses ends up as one NVS write
+  SettingsStore::instance().putFloat("audio_config", "volume", volume_);
+
+  ESP_LOGI(TAG, "Volume set to: %.2f", volume_);
+  publishState(state_);
+}
+
+void AudioManager::setSpeed(float speed) {
+  if (!initialized_) {
+    return;
+  }
+  timeStretch.setSpeed(speed); // takes effect on the next decoded frame, also mid-clip
+  ESP_LOGI(TAG, "Playback speed set to: %.3fx", timeStretch.speed());
+  publishState(state_);
+}
+
+// ================================ AUDIO TASK ================================
+bool AudioManager::startTask() {
+  if (!initialized_) {
+    ESP_LOGE(TAG, "AudioManager not initialized");
+    return false;
+  }
+  if (taskHandle_ != nullptr) {
+    return true;
+  }
+
+  taskStopRequested_ = false;
+  taskAttached_ = false;
+
+  BaseType_t result = xTaskCreatePinnedToCore(audioTask,           // Task function
+                                              "audio_task",        // Task name
+                                              AUDIO_TASK_STACK,    // Stack size
+                                              this,                // Parameter (this instance)
+                                              AUDIO_TASK_PRIORITY, // Priority (above the UI loop)
+                                              &taskHandle_,        // Task handle
+                                              AUDIO_TASK_CORE      // Core (0 or 1)
+  );
+  if (result != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create audio task");
+    taskHandle_ = nullptr;
+    return false;
+  }
+
+  // The task attaches itself before its first wait; commands published after we return are queued for it
+  while (!taskAttached_) {
+    delay(1);
+  }
+  ESP_LOGI(TAG, "Audio task created successfully");
+  publishState(state_);
+  return true;
+}
+
+void AudioManager::stopTask() {
+  if (taskHandle_ == nullptr) {
+    return;
+  }
+  taskStopRequested_ = true; // seen within AUDIO_TASK_IDLE_WAIT_MS even while the task sleeps
+  while (taskHandle_ != nullptr) {
+    delay(5);
+  }
+  ESP_LOGI(TAG, "Audio task stopped");
+}
+
+void AudioManager::audioTask(void *parameter) {
+  AudioManager *self = static_cast<AudioManager *>(parameter);
+  auto &commands = EventSystem::instance().getEventBus<AudioCommandEvent>();
+
+  // Commands are queued for this task and executed here, never on the UI loop
+  self->commandListenerId_ = commands.attach([self](const AudioCommandEvent &command) { self->handleCommand(command); }, AUDIO_TASK_COMMAND_BIT);
+  if (self->commandListenerId_ == EventBusFor<AudioCommandEvent>::INVALID_ID) {
+    ESP_LOGE(TAG, "Audio task could not attach to the command bus");
+  }
+  self->taskAttached_ = true;
+
+  while (!self->taskStopRequested_) {
+    self->tick();
+    // While sound is going out, wait at most one tick and let I2S back-pressure pace the copy;
+    // when silent, sleep until a command arrives
+    bool busy = self->isPlaying || self->uiMixer.isActive();
+    commands.waitAndProcess(busy ? 1 : pdMS_TO_TICKS(AUDIO_TASK_IDLE_WAIT_MS));
+  }
+
+  // Detach before the handle is cleared, so no command is queued for a deleted task
+  commands.detach(self->commandListenerId_);
+  self->commandListenerId_ = EventBusFor<AudioCommandEvent>::INVALID_ID;
+
+  // Clean up task handle and delete self
+  self->taskHandle_ = nullptr;
+  vTaskDelete(nullptr);
+}
+
+void AudioManager::handleCommand(const AudioCommandEvent &command) {
+  switch (command.type) {
+  case AudioCommandEvent::Play:
+    play(command.url.c_str());
+    break;
+  case AudioCommandEvent::Stop:
+    stop();
+    break;
+  case AudioCommandEvent::Enqueue:
+    enqueue(command.url.c_str());
+    break;
+  case AudioCommandEvent::Skip:
+    skip();
+    break;
+  case AudioCommandEvent::Volume:
+    setVolume(command.relative ? volume_ + command.value : command.value);
+    break;
+  case AudioCommandEvent::Speed:
+    setSpeed(command.relative ? getSpeed() + command.value : command.value);
+    break;
+  case AudioCommandEvent::PlayUiSound:
+    playUiSound((UiSound)command.sound);
+    break;
+  }
+}
 
-  ESP_LOGI(TAG, "Volume set to: %.2f (saved to preferences)", volume_);
+void AudioManager::publishState(AudioStateEvent::State state) {
+  state_ = state;
+  AudioStateEvent event;
+  event.state = state;
+  event.codec = (state == AudioStateEvent::Connecting || state == AudioStateEvent::Playing) ? codec_ : "";
+  event.queued = queue_.size() < 255 ? (uint8_t)queue_.size() : 255;
+  event.volume = volume_;
+  event.speed = timeStretch.speed();
+  EventSystem::instance().getEventBus<AudioStateEvent>().publish(event);
 }
 
 bool AudioManager::isUrl(const char *path) const { 
@@ -214,26 +695,27 @@ bool AudioManager::isUrl(const char *path) const {
   return strstr(path, "http://") == path || strstr(path, "https://") == path; 
 }
 
-void AudioManager::createUrlSource(const char *url) {
-  ESP_LOGI(TAG, "Creating URL source for: %s", url);
+void AudioManager::createUrlSources(const char *url) {
+  ESP_LOGI(TAG, "Creating URL source for: %s (connection reused %u times)", url, (unsigned)keepAliveClient.getReuseCount());
 
-  client.setInsecure();
-  urlStream.setClient(client);
-
-  // Create URL source with single URL
-  urlSource = new AudioSourceDynamicURLNoAutoNext(urlStream, "audio/mp3");
-  urlSource->addURL(url);
-  urlSource->setTimeoutAutoNext(2000); // if no data for 2 sec, stop the player
-
-  if (!urlSource) {
-    ESP_LOGE(TAG, "Failed to create AudioSourceURL");
+  // One source per stream; queued clips alternate between them
+  for (int i = 0; i < 2; i++) {
+    urlSource[i] = new AudioSourceDynamicURLNoAutoNext(urlStream[i], URL_SOURCE_MIME);
+    if (!urlSource[i]) {
+      ESP_LOGE(TAG, "Failed to create AudioSourceURL");
+      return;
+    }
+    urlSource[i]->setTimeoutAutoNext(NO_DATA_TIMEOUT_MS); // stalls are resumed first, see resumeIfStalled()
   }
+  urlSource[0]->addURL(url);
 }
 
 void AudioManager::cleanupSources() {
-  if (urlSource) {
-    delete urlSource;
-    urlSource = nullptr;
+  for (int i = 0; i < 2; i++) {
+    if (urlSource[i]) {
+      delete urlSource[i];
+      urlSource[i] = nullptr;
+    }
   }
 }
 
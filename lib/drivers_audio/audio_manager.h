@@ -1,13 +1,26 @@
 #pragma once
 #include "LittleFS.h"
-#include "Preferences.h"
 #include "audio_source_dynamic_url_no_auto_next.h"
 #include "common.h"
+#include "core_audio/audio_metrics.h"
+#include "core_audio/output_format_stage.h"
+#include "core_audio/pcm_dsp.h"
+#include "core_audio/time_stretch.h"
+#include "core_audio/ui_sound_mixer.h"
+#include "core_eventing/event_system.h"
 #include "core_eventing/events.h"
+#include "core_settings/settings_store.h"
+#include "keep_alive_client.h"
+#include "psram_allocator.h"
+#include "resumable_url_stream.h"
 #include <WiFi.h>
+#include <atomic>
+#include <deque>
 #define HELIX_LOG_LEVEL LogLevelHelix::Warning
 #include "AudioTools.h"
 #include "AudioTools/AudioCodecs/CodecMP3Helix.h"
+#include "AudioTools/AudioCodecs/CodecOpusOgg.h"
+#include "AudioTools/AudioCodecs/MultiDecoder.h"
 #include "AudioTools/AudioLibs/AudioBoardStream.h"
 #include "AudioTools/CoreAudio/AudioHttp/URLStream.h"
 #include "AudioTools/CoreAudio/AudioPlayer.h"
@@ -26,13 +39,35 @@ public:
   void tick();                                  // Process audio events and state updates
   bool isReady() const { return initialized_; } // Check if audio system is ready for playback
 
+  // Audio task: runs tick() and executes AudioCommandEvents, publishes AudioStateEvents.
+  // While it runs, other tasks use the command bus instead of the methods below.
+  bool startTask();                                             // Start the audio task
+  void stopTask();                                              // Stop the audio task (waits for it to exit)
+  bool isTaskRunning() const { return taskHandle_ != nullptr; } // Check if the audio task is running
+
   // Audio playback methods
   bool play(const char *url); // Play audio from URL
   bool stop();                // Stop current audio playback
 
+  // Playback queue methods
+  bool enqueue(const char *url);                     // Append a clip to the queue, starts playback if idle
+  bool skip();                                       // Jump to the next queued clip (stops if the queue is empty)
+  void clearQueue();                                 // Drop all clips queued after the current one
+  size_t queueSize() const { return queue_.size(); } // Number of clips waiting behind the current one
+
+  // UI feedback sounds, mixed over speech without interrupting it
+  bool playUiSound(UiSound sound); // Start a UI sound; false if not loaded
+
   // Utility/getter methods
-  float getVolume() const { return volume_; } // Get current audio volume
-  void setVolume(float volume);               // Set audio volume (0.0 to 1.0)
+  float getVolume() const { return volume_; }            // Get current audio volume
+  void setVolume(float volume);                          // Set audio volume (0.0 to 1.0)
+  float getSpeed() const { return timeStretch.speed(); } // Get playback speed
+  void setSpeed(float speed);                            // Set playback speed (0.75 to 1.5), pitch is kept
+
+  // Telemetry
+  const AudioMetrics &getMetrics() const { return metrics_; } // Pipeline counters since boot
+  void printMetrics() const { metrics_.print(); }             // Dump pipeline counters to the log
+  void dropConnection();                                      // Close the clip's connection as a network drop would (tests)
 
 private:
   // Private constructor/destructor for singleton
@@ -44,27 +79,76 @@ private:
   // Audio board and output (ES8311)
   AudioBoard board;
   AudioBoardStream out;
-  AudioInfo info;
+  AudioMetrics metrics_;
+  MeteredOutput boardTap;        // Ends the time to first sample when a clip's PCM reaches out
+  UiSoundMixer uiMixer;          // Mixes UI sounds into the link-format PCM
+  OutputFormatStage formatStage; // Follows each stream's native rate
+  TimeStretchStage timeStretch;  // Playback speed, at the stream's own format
+  GainStage gainStage;           // Fade-in ramp at clip start
+  MeteredOutput meteredOut;      // Decoder output; times each decoded frame from the read that fed it
 
   // High-level player and decoder
   AudioPlayer *player;
-  MP3DecoderHelix decoder;
+  MultiDecoder decoder;       // Picks the codec from Content-Type, else from the first bytes
+  MP3DecoderHelix mp3Decoder; // Default clip format
+  OggOpusDecoder opusDecoder; // Low-bitrate speech clips, requested with &format=opus
 
   // Audio sources (created dynamically based on URL/file)
   WiFiClientSecure client;
-  URLStream urlStream;
-  AudioSourceDynamicURLNoAutoNext *urlSource;
+  KeepAliveClient keepAliveClient; // Reuses the TLS session to the audio host across clips
+  ResumableURLStream urlStream[2]; // Current clip and the prefetched next one, alternating; resume with Range after a stall
+  AudioSourceDynamicURLNoAutoNext *urlSource[2];
+  uint8_t current_;                // Index of the stream/source the player reads
+  uint8_t *readAhead_;             // Read-ahead for both streams in PSRAM
+  bool prefetchTried_;             // One prefetch attempt per clip; on failure the switch requests it as usual
 
   // State management
   bool initialized_;
   bool isPlaying;
   float volume_;
-  Preferences preferences;
+
+  int16_t *uiSoundPcm_;  // All built-in UI sounds, back to back in PSRAM
+  int16_t *stretchWork_; // Time-stretch working buffer in PSRAM
+
+  // Playback queue: clips waiting behind the one currently playing
+  std::deque<String, PsramAllocator<String>> queue_;
+  String currentUrl_;
+
+  // Audio task and the state reported from it
+  TaskHandle_t taskHandle_;
+  volatile bool taskStopRequested_;
+  volatile bool taskAttached_; // Set by the task once it consumes AudioCommandEvents
+  EventBusFor<AudioCommandEvent>::ListenerId commandListenerId_;
+  AudioStateEvent::State state_;
+  const char *codec_;
+
+  // Fetch task: runs the blocking connection work (a resume, the next clip's request) while the
+  // audio task keeps playing from the read-ahead. One job at a time; the audio task posts, the fetch task clears.
+  enum FetchJob : uint8_t { FetchNone, FetchResume, FetchPrefetch };
+  TaskHandle_t fetchTaskHandle_;
+  volatile bool fetchStopRequested_;
+  std::atomic<uint8_t> fetchJob_;
+  uint8_t fetchStream_; // urlStream index the job works on
+  String prefetchUrl_;  // FetchPrefetch: the queued clip to request
 
   // Private methods
   bool isUrl(const char *path) const;                                              // Check if path is a URL
-  void createUrlSource(const char *url);                                           // Create URL source for playback
-  void cleanupSources();                                                           // Clean up current sources
+  void createUrlSources(const char *url);                                          // Create both URL sources, the first one playing url
+  bool startNextInQueue();                                                         // Switch the running player to the next queued clip
+  void prefetchNext();                                                             // Request the next queued clip once the current body is in
+  void cancelPrefetch();                                                           // Drop a prefetched response and its connection
+  bool isClipDrained();                                                            // Check if the decoder has every byte of the current clip
+  void resumeIfStalled();                                                          // Reconnect from the current offset after a stall
+  void startFetch(FetchJob job, uint8_t stream);                                   // Post a job to the fetch task (runs it here without one)
+  void runFetchJob(FetchJob job);                                                  // Body of a fetch job, on the fetch task
+  bool isFetchBusy() const { return fetchJob_ != FetchNone; }                      // A fetch job is posted or running
+  void waitForFetch();                                                             // Cut the running job short and wait for it to end
+  static void fetchTask(void *parameter);                                          // Fetch task body
+  void loadUiSounds();                                                             // Synthesize the UI sounds into PSRAM
+  void handleCommand(const AudioCommandEvent &command);                            // Execute one command on the audio task
+  void publishState(AudioStateEvent::State state);                                 // Record and publish the playback state
+  static void audioTask(void *parameter);                                          // Audio task body
+  void cleanupSources();                                                           // Clean up both sources
   static void staticMetadataCallback(MetaDataType type, const char *str, int len); // Static metadata callback
 };
 
@@ -0,0 +1,62 @@
+#pragma once
+#include <WiFiClientSecure.h>
+
+/**
+ * @brief Client adapter that keeps its TLS connection open between HTTP requests
+ *
+ * URLStream stops and reconnects its client for every clip. This adapter turns
+ * connect() to the host it is already connected to into a no-op and ignores
+ * stop(), so successive GETs to the audio host reuse the
+ * same TLS session. Call close() when a response was abandoned mid-body, since
+ * the leftover bytes would otherwise be read as the next response.
+ */
+class KeepAliveClient : public Client {
+public:
+  explicit KeepAliveClient(WiFiClientSecure &client) : client_(client), port_(0), reuseCount_(0) {}
+
+  int connect(IPAddress ip, uint16_t port) override {
+    close();
+    return client_.connect(ip, port);
+  }
+
+  int connect(const char *host, uint16_t port) override {
+    if (client_.connected() && port == port_ && host_.equals(host)) {
+      reuseCount_++;
+      return 1;
+    }
+    close();
+    int result = client_.connect(host, port);
+    if (result) {
+      host_ = host;
+      port_ = port;
+    }
+    return result;
+  }
+
+  void stop() override {} // URLStream's per-clip stop; close() really drops the connection
+
+  // Really drop the connection (abandoned response, host change, shutdown)
+  void close() {
+    client_.stop();
+    host_ = "";
+    port_ = 0;
+  }
+
+  uint32_t getReuseCount() const { return reuseCount_; }
+
+  size_t write(uint8_t b) override { return client_.write(b); }
+  size_t write(const uint8_t *buf, size_t size) override { return client_.write(buf, size); }
+  int available() override { return client_.available(); }
+  int read() override { return client_.read(); }
+  int read(uint8_t *buf, size_t size) override { return client_.read(buf, size); }
+  int peek() override { return client_.peek(); }
+  void flush() override { client_.flush(); }
+  uint8_t connected() override { return client_.connected(); }
+  operator bool() override { return client_.connected(); }
+
+private:
+  WiFiClientSecure &client_;
+  String host_;
+  uint16_t port_;
+  uint32_t reuseCount_;
+};
@@ -0,0 +1,273 @@
+#pragma once
+#include "AudioTools/CoreAudio/AudioHttp/URLStream.h"
+#include "core_audio/audio_metrics.h"
+#include <atomic>
+#include <string.h>
+
+/**
+ * @brief URLStream that can pick up an interrupted download where it left off
+ *
+ * Counts the bytes handed to the decoder and, on resume(), reopens the same URL
+ * with "Range: bytes=<offset>-". A fresh clip goes out without a Range header;
+ * URLStream can't remove a single header, so after a ranged request the
+ * request headers are cleared and rebuilt by the next request. If the server
+ * ignores the range and answers 200, the already played prefix is read and
+ * dropped so the decoder still sees a continuous byte stream.
+ *
+ * isBodyComplete() tells when the whole response body has been read, which is
+ * what decides whether the keep-alive connection can carry the next request.
+ * How that is detected depends on the framing of the first response: Sized
+ * counts bytes against Content-Length. Chunked and UntilClose (neither header)
+ * end only when the server closes the connection, so such a connection is
+ * never reused or prefetched on: URLStream does not expose the chunk reader,
+ * and "no chunk available yet" looks the same as the terminating zero-length
+ * chunk, so a slow chunked body cannot be told from a finished one.
+ *
+ * With a read-ahead buffer the stream pulls whatever the connection has ready
+ * into it on every read, so the body usually leaves the socket well before the
+ * decoder gets to its end. Once it has, prefetch() on a second stream sharing
+ * the keep-alive client can send the next clip's request; a later begin() with
+ * the same URL then picks up that open response instead of requesting again.
+ *
+ * resume() and prefetch() block for a handshake or a request and its reply
+ * headers (resume maybe also a skipped prefix), so they are meant to run on
+ * another task. Between setFetching(true) and setFetching(false) the
+ * connection belongs to that task: reads are served from the read-ahead only
+ * and nothing else touches the connection. A stream whose body is complete
+ * does not touch it either, which lets the other stream prefetch on it.
+ */
+class ResumableURLStream : public URLStream {
+public:
+  enum Framing : uint8_t { Sized, Chunked, UntilClose };
+
+  bool begin(const char *urlStr, const char *acceptMime = nullptr, MethodID action = GET, const char *reqMime = "", const char *reqData = "") override {
+    if (prefetched_ && url_.equals(urlStr)) {
+      prefetched_ = false;
+      lastDataTime_ = millis(); // waiting in the queue is not a stall
+      return true;
+    }
+    prefetched_ = false;
+    url_ = urlStr;
+    mime_ = acceptMime != nullptr ? acceptMime : "";
+    position_ = 0;
+    received_ = 0;
+    aheadHead_ = 0;
+    aheadCount_ = 0;
+    resumeCount_ = 0;
+    bodyComplete_ = false;
+    bool result = open(action, reqMime, reqData);
+    clipLength_ = result ? contentLength() : 0;
+    if (httpRequest().reply().isChunked()) {
+      framing_ = Chunked;
+    } else {
+      framing_ = clipLength_ > 0 ? Sized : UntilClose;
+    }
+    return result;
+  }
+
+  // A prefetched response stays open until it has been begun or cancelled
+  void end() override {
+    if (prefetched_) {
+      return;
+    }
+    URLStream::end(); // the read-ahead is kept, resume() ends and reopens mid-clip
+  }
+
+  size_t readBytes(uint8_t *data, size_t len) override {
+    size_t result = 0;
+    bool fetching = fetching_;
+    if (aheadSize_ == 0) {
+      result = fetching || bodyComplete_ ? 0 : receive(data, len);
+    } else {
+      if (!fetching) {
+        fillReadAhead();
+      }
+      while (result < len && aheadCount_ > 0) {
+        size_t n = aheadSize_ - aheadHead_; // contiguous up to the wrap
+        n = n < aheadCount_ ? n : aheadCount_;
+        n = n < len - result ? n : len - result;
+        memcpy(data + result, aheadBuffer_ + aheadHead_, n);
+        aheadHead_ = (aheadHead_ + n) % aheadSize_;
+        aheadCount_ -= n;
+        result += n;
+      }
+    }
+    position_ += result;
+    if (result > 0 && metrics_ != nullptr) {
+      metrics_->markDecodeStart(); // the player hands these bytes to the decoder next
+    }
+    return result;
+  }
+
+  int read() override {
+    uint8_t b;
+    return readBytes(&b, 1) == 1 ? b : -1;
+  }
+
+  int available() override { return (int)aheadCount_ + (fetching_ || bodyComplete_ ? 0 : URLStream::available()); }
+
+  // Read-ahead storage (PSRAM is fine); without it every read goes straight to the connection
+  void setReadAheadBuffer(uint8_t *buffer, size_t size) {
+    aheadBuffer_ = buffer;
+    aheadSize_ = buffer != nullptr ? size : 0;
+    aheadHead_ = 0;
+    aheadCount_ = 0;
+  }
+
+  // Send the request for url and read the reply headers, leaving the body on the connection. Blocks, see resume().
+  bool prefetch(const char *urlStr, const char *acceptMime = nullptr) {
+    if (!begin(urlStr, acceptMime)) {
+      return false;
+    }
+    prefetched_ = true;
+    return true;
+  }
+
+  // Forget a prefetched response; its body is still on the connection, so the caller must close it
+  void cancelPrefetch() {
+    prefetched_ = false;
+    end();
+  }
+
+  bool isPrefetched() const { return prefetched_; }
+
+  // Hand the connection to another task (resume, prefetch) and back; while it is away reads come from the read-ahead only
+  void setFetching(bool fetching) {
+    abortFetch_ = false;
+    fetching_ = fetching;
+  }
+  bool isFetching() const { return fetching_; }
+  void abortFetch() { abortFetch_ = true; } // Cut a prefix skip short; the clip is being dropped anyway
+
+  // The connection is gone and nothing of the body is left on it
+  bool isConnectionLost() { return !fetching_ && !isBodyComplete() && URLStream::available() == 0 && !httpRequest().connected(); }
+
+  // Reconnect and continue after the last byte received. Blocks: call it between setFetching(true) and
+  // setFetching(false) on a task other than the reader's, and the read-ahead keeps playing meanwhile.
+  bool resume() {
+    if (url_.length() == 0) {
+      return false;
+    }
+    resumeCount_++;
+    URLStream::end();
+    if (!open(GET, "", "")) {
+      return false;
+    }
+    if (received_ > 0 && httpRequest().reply().statusCode() == 200) {
+      return skipBytes(received_);
+    }
+    return true;
+  }
+
+  // True once the whole body has been read off the connection; latched until the next begin()
+  bool isBodyComplete() {
+    if (bodyComplete_ || fetching_) {
+      return bodyComplete_;
+    }
+    switch (framing_) {
+    case Sized:
+      bodyComplete_ = received_ >= (size_t)clipLength_; // a resumed request only reports the remaining range, so count the clip
+      break;
+    case Chunked:
+    case UntilClose:
+      bodyComplete_ = URLStream::available() == 0 && !httpRequest().connected();
+      break;
+    }
+    return bodyComplete_;
+  }
+
+  // The decoder has been handed every byte of the clip
+  bool isDrained() { return aheadCount_ == 0 && isBodyComplete(); }
+
+  // A connection is only fit for the next request once a Content-Length body has been read in full
+  bool isReusable() { return framing_ == Sized && isBodyComplete(); }
+
+  Framing framing() const { return framing_; }
+  int clipLength() const { return clipLength_; }                         // Content-Length of the whole clip (0 if unknown)
+  size_t position() const { return position_; }                          // Bytes consumed since the clip started
+  uint32_t msSinceLastData() const { return fetching_ ? 0 : millis() - lastDataTime_; } // Time the connection has kept us waiting
+  uint8_t resumeCount() const { return resumeCount_; }                  // Resumes done for the current clip
+  void setMetrics(dict::AudioMetrics *metrics) { metrics_ = metrics; } // Decode timing starts when a read returns
+
+private:
+  String url_;
+  String mime_;
+  int clipLength_ = 0;
+  size_t position_ = 0; // handed to the decoder
+  size_t received_ = 0; // read off the connection, position_ plus the read-ahead
+  uint32_t lastDataTime_ = 0;
+  uint8_t resumeCount_ = 0;
+  Framing framing_ = UntilClose;
+  bool bodyComplete_ = false;
+  bool rangeSent_ = false;
+  bool prefetched_ = false;
+  std::atomic<bool> fetching_{false};
+  std::atomic<bool> abortFetch_{false};
+  dict::AudioMetrics *metrics_ = nullptr;
+
+  // Read-ahead ring
+  static const size_t FILL_MAX_BYTES = 8 * 1024; // per read, keeps one copy() call short
+  uint8_t *aheadBuffer_ = nullptr;
+  size_t aheadSize_ = 0;
+  size_t aheadHead_ = 0;
+  size_t aheadCount_ = 0;
+
+  size_t receive(uint8_t *data, size_t len) {
+    size_t result = URLStream::readBytes(data, len);
+    if (result > 0) {
+      received_ += result;
+      lastDataTime_ = millis();
+    }
+    return result;
+  }
+
+  // Move what the connection already has into the ring, without waiting for more
+  void fillReadAhead() {
+    if (aheadCount_ == aheadSize_) {
+      lastDataTime_ = millis(); // a full ring is not waiting for the connection
+    }
+    size_t filled = 0;
+    while (!bodyComplete_ && aheadCount_ < aheadSize_ && filled < FILL_MAX_BYTES) {
+      int ready = URLStream::available();
+      if (ready <= 0) {
+        break;
+      }
+      size_t tail = (aheadHead_ + aheadCount_) % aheadSize_;
+      size_t n = tail >= aheadHead_ ? aheadSize_ - tail : aheadHead_ - tail; // contiguous free space
+      n = n < (size_t)ready ? n : (size_t)ready;
+      n = n < FILL_MAX_BYTES - filled ? n : FILL_MAX_BYTES - filled;
+      n = receive(aheadBuffer_ + tail, n);
+      if (n == 0) {
+        break;
+      }
+      aheadCount_ += n;
+      filled += n;
+      isBodyComplete();
+    }
+  }
+
+  bool open(MethodID action, const char *reqMime, const char *reqData) {
+    if (received_ > 0) {
+      char range[32];
+      snprintf(range, sizeof(range), "bytes=%u-", (unsigned)received_);
+      addRequestHeader("Range", range);
+      rangeSent_ = true;
+    } else if (rangeSent_) {
+      httpRequest().header().clear(); // drops Range; Host, Connection etc. are set again for every request
+      rangeSent_ = false;
+    }
+    lastDataTime_ = millis();
+    return URLStream::begin(url_.c_str(), mime_.length() > 0 ? mime_.c_str() : nullptr, action, reqMime, reqData);
+  }
+
+  bool skipBytes(size_t count) {
+    uint8_t scratch[256];
+    uint32_t start = millis();
+    while (count > 0 && millis() - start < 5000 && !abortFetch_) {
+      size_t n = URLStream::readBytes(scratch, count < sizeof(scratch) ? count : sizeof(scratch));
+      count -= n;
+      delay(1); // can run for seconds on a large prefix, let the other tasks on this core in
+    }
+    return count == 0;
+  }
+};
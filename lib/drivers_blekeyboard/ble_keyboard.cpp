@@ -1,19 +1,33 @@
 #include "ble_keyboard.h"
+#include "core_eventing/connectivity_state.h"
 #include "core_misc/log.h"
+#include "core_settings/settings_store.h"
 
 namespace dict {
 
 static const char *TAG = "BLE";
+static const char *SETTINGS_NS = "ble_config";
 
 class BLEKeyboard::ClientCallbacks : public NimBLEClientCallbacks {
 public:
   BLEKeyboard *keyboard;
   ClientCallbacks(BLEKeyboard *kb) : keyboard(kb) {}
-  void onConnect(NimBLEClient *pClient) override { ESP_LOGI(TAG, "Connected"); }
+  void onConnect(NimBLEClient *pClient) override {
+    ESP_LOGI(TAG, "Connected");
+    keyboard->connectPending_ = false;
+    keyboard->linkUp_ = true; // tick() subscribes to the reports
+  }
+  void onConnectFail(NimBLEClient *pClient, int reason) override {
+    ESP_LOGD(TAG, "Connection attempt ended, reason = %d", reason);
+    keyboard->connectPending_ = false;
+    keyboard->connectFailed_ = true;
+  }
   void onDisconnect(NimBLEClient *pClient, int reason) override {
-    ESP_LOGW(TAG, "%s Disconnected, reason = %d - Starting scan", pClient->getPeerAddress().toString().c_str(), reason);
-    keyboard->advDeviceAddress = "";
-    keyboard->pScan->start(keyboard->scanTimeMs, false, true);
+    ESP_LOGW(TAG, "%s Disconnected, reason = %d - reconnecting", pClient->getPeerAddress().toString().c_str(), reason);
+    keyboard->releaseAllKeys(); // the keyboard cannot send the releases any more
+    keyboard->connectPending_ = false;
+    keyboard->disconnected_ = true;
+    ConnectivityState::instance().set(ConnectivityEvent::Keyboard, false);
   }
 };
 
@@ -21,39 +35,21 @@ class BLEKeyboard::ScanCallbacks : public NimBLEScanCallbacks {
 public:
   BLEKeyboard *keyboard;
   ScanCallbacks(BLEKeyboard *kb) : keyboard(kb) {}
+  // NimBLE host task, once per advertisement: no Strings, no settings access until it is our keyboard
   void onResult(const NimBLEAdvertisedDevice *advertisedDevice) override {
-    String deviceName = advertisedDevice->getName().c_str();
-    String deviceAddr = advertisedDevice->getAddress().toString().c_str();
-    bool hasService = false;
-    try {
-      hasService = advertisedDevice->isAdvertisingService(NimBLEUUID(BLE_SERVICE_UUID));
-    } catch (...) {
-      ESP_LOGW(TAG, "Service check failed for: %s", deviceAddr.c_str());
-      hasService = false;
-    }
-
-    bool found = false;
-    if (deviceName.length() > 0) {
-      ESP_LOGD(TAG, "Found Device: %s (%s)", deviceName.c_str(), deviceAddr.c_str());
-    } else {
-      ESP_LOGD(TAG, "Found Device: %s", deviceAddr.c_str());
-    }
-    if (keyboard->preferences.getString("addr").equals(deviceAddr)) {
-      found = true;
-    }
-    if (hasService) {
-      found = true;
-    }
-    if (found) {
-      ESP_LOGI(TAG, "Found Our Service");
-      keyboard->preferences.putString("addr", deviceAddr);
-      keyboard->pScan->stop();
-      keyboard->advDeviceAddress = deviceAddr;
-      keyboard->doConnect = true;
+    NimBLEAddress address = advertisedDevice->getAddress();
+    const std::vector<uint8_t> &payload = advertisedDevice->getPayload();
+    ScanFilter::Match match = keyboard->scanFilter_.match(address.getVal(), payload.data(), payload.size());
+    if (match == ScanFilter::None || keyboard->doConnect) {
+      return;
     }
+    ESP_LOGI(TAG, "Found keyboard %s by %s", address.toString().c_str(), match == ScanFilter::Address ? "address" : "service");
+    keyboard->pScan->stop();
+    keyboard->foundAddress_ = address;
+    keyboard->doConnect = true; // tick() saves the address and connects
   }
   void onScanEnd(const NimBLEScanResults &results, int reason) override {
-    ESP_LOGI(TAG, "Scan Ended, reason: %d, device count: %d; Restarting scan", reason, results.getCount());
+    ESP_LOGI(TAG, "Scan Ended, reason: %d, device count: %d", reason, results.getCount());
     keyboard->scanning_ = false;
     keyboard->scanEndTime_ = millis();
   }
@@ -76,9 +72,27 @@ BLEKeyboard::BLEKeyboard()
 }
 
 bool BLEKeyboard::initialize() {
+  int32_t layout = SettingsStore::instance().getInt(SETTINGS_NS, "layout", (int32_t)LayoutId::US);
+  layoutId_ = layout >= 0 && layout < (int32_t)LayoutId::COUNT ? (LayoutId)layout : LayoutId::US;
+  ESP_LOGI(TAG, "Keyboard layout: %s", getKeyboardLayout(layoutId_).name);
   begin();
   keyProcessor_->initialize();
-  setKeyCallback([&](char ch, uint8_t keyCode, uint8_t modifiers) { keyProcessor_->sendKeyToLVGL(ch, keyCode, modifiers); });
+  setKeyCallback([&](char ch, uint8_t keyCode, uint8_t modifiers, uint32_t reportUs, bool pressed) {
+    keyProcessor_->sendKeyToLVGL(ch, keyCode, modifiers, reportUs, pressed);
+  });
+  if (!audioStateSubscription_.isActive()) {
+    audioStateSubscription_ = EventSystem::instance().getEventBus<AudioStateEvent>().subscribeScoped([this](const AudioStateEvent &event) {
+      connParams_.setRadioBusy(ConnParamsManager::Audio, event.state == AudioStateEvent::Connecting || event.state == AudioStateEvent::Playing);
+    });
+  }
+  if (!statusSubscription_.isActive()) {
+    statusSubscription_ = EventSystem::instance().getEventBus<FunctionKeyEvent>().subscribeScoped([this](const FunctionKeyEvent &event) {
+      if (event.type == FunctionKeyEvent::PrintMemoryStatus) {
+        connParams_.print();
+        scanFilter_.print();
+      }
+    });
+  }
   initialized_ = true;
   return true;
 }
@@ -88,17 +102,18 @@ void BLEKeyboard::shutdown() {
   if (pScan) {
     pScan->stop();
   }
-  preferences.end();
+  if (client_ != nullptr && connectPending_) {
+    client_->cancelConnect();
+    connectPending_ = false;
+  }
+  audioStateSubscription_.reset();
+  statusSubscription_.reset();
 }
 
 void BLEKeyboard::tick() {
-  if (doConnect) {
-    doConnect = false;
-    if (connectToServer()) {
-      ESP_LOGI(TAG, "Success! we should now be getting notifications, no scanning for more!");
-    } else {
-      ESP_LOGW(TAG, "Failed to connect, no starting scan");
-    }
+  if (initialized_) {
+    serviceConnection();
+    connParams_.tick(client_);
   }
   if (keyProcessor_ && keyProcessor_->isReady()) {
     keyProcessor_->tick();
@@ -108,12 +123,6 @@ void BLEKeyboard::tick() {
 bool BLEKeyboard::isReady() const { return initialized_; }
 
 void BLEKeyboard::begin() {
-  preferences.end();
-  if (!preferences.begin("ble_config", false)) {
-    ESP_LOGE(TAG, "Failed to open preferences");
-  } else {
-    ESP_LOGI(TAG, "Preferences initialized successfully");
-  }
   ESP_LOGI(TAG, "Starting NimBLE Client");
   NimBLEDevice::init("NimBLE-Client");
   NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
@@ -124,179 +133,219 @@ void BLEKeyboard::begin() {
   pScan->setInterval(100);
   pScan->setWindow(100);
   pScan->setActiveScan(true);
-  pScan->start(scanTimeMs);
-  ESP_LOGI(TAG, "Scanning for keyboard. Please press any key on the keyboard to wake it up.");
+
+  advDeviceAddress = SettingsStore::instance().getString(SETTINGS_NS, "addr");
+  advAddressType_ = SettingsStore::instance().getInt(SETTINGS_NS, "addr_type", BLE_ADDR_PUBLIC);
+  disconnectedMs_ = millis();
+  resetBackoff(disconnectedMs_); // the first tick() scans, or connects straight to a saved keyboard
+  if (advDeviceAddress.isEmpty()) {
+    ESP_LOGI(TAG, "Scanning for keyboard. Please press any key on the keyboard to wake it up.");
+  } else {
+    ESP_LOGI(TAG, "Reconnecting to saved keyboard %s. Press any key on the keyboard to wake it up.", advDeviceAddress.c_str());
+  }
 }
 
 void BLEKeyboard::notifyCB(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify) {
-  if (length >= 3) {
+  uint32_t reportUs = micros(); // start of the keystroke-to-display measurement
+  if (length >= 8) {
     ESP_LOGD("keypress", "BLE keyboard report: %d, %d, %d, %d, %d, %d, %d, %d", pData[0], pData[1], pData[2], pData[3], pData[4], pData[5], pData[6],
              pData[7]);
-    uint8_t modifiers = pData[0];
-    uint8_t key1 = pData[2];
-    if (key1 != 0x00) {
-      // Handle CapsLock key (HID 0x39) - toggle state and swallow event
-      if (key1 == 0x39) { // HID: CapsLock
-        keyboardInstance->capsLockOn_ = !keyboardInstance->capsLockOn_;
-        return; // swallow CapsLock key
-      }
+  }
+  if (keyboardInstance) {
+    keyboardInstance->dispatchReport(pData, length, reportUs);
+  }
+}
 
-      if (keyboardInstance && keyboardInstance->keyCallback) {
-        char key1_char = keyboardInstance->convertKeyCodeToChar(key1, modifiers);
-        keyboardInstance->keyCallback(key1_char, key1, modifiers);
+void BLEKeyboard::setRadioBusy(ConnParamsManager::RadioUser user, bool active) {
+  connParams_.setRadioBusy(user, active);
+  if (initialized_) {
+    connParams_.tick(client_); // a lookup blocks the loop, the next tick() would be too late
+  }
+}
+
+void BLEKeyboard::dispatchReport(const uint8_t *report, size_t length, uint32_t reportUs) {
+  HidKeyTransition transitions[HidReportParser::MAX_TRANSITIONS];
+  size_t count = reportParser_.parse(report, length, transitions);
+  if (count > 0) {
+    connParams_.onKeyActivity();
+  }
+  for (size_t i = 0; i < count; i++) {
+    const HidKeyTransition &t = transitions[i];
+    // Handle CapsLock key (HID 0x39) - toggle state on press and swallow both edges
+    if (t.keyCode == 0x39) {
+      if (t.pressed) {
+        capsLockOn_ = !capsLockOn_;
       }
+      continue;
+    }
+    if (keyCallback) {
+      keyCallback(translateKey(getKeyboardLayout(layoutId_), t.keyCode, t.modifiers, capsLockOn_), t.keyCode, t.modifiers, reportUs, t.pressed);
     }
   }
 }
 
-bool BLEKeyboard::connectToServer() {
-  NimBLEClient *pClient = nullptr;
-  if (advDeviceAddress.isEmpty()) {
-    ESP_LOGW(TAG, "No device address to connect to");
-    return false;
+void BLEKeyboard::releaseAllKeys() {
+  static const uint8_t EMPTY_REPORT[2 + HidReportParser::KEY_SLOTS] = {};
+  dispatchReport(EMPTY_REPORT, sizeof(EMPTY_REPORT), micros());
+}
+
+// ================================= RECONNECT =================================
+// Runs on the loop task; the NimBLE callbacks only raise flags. A known
+// keyboard is reconnected by initiating a connection to its address: the
+// controller connects on the keyboard's first advertisement after wake-up,
+// without a scan in between. Failed attempts back off exponentially, and
+// after DIRECT_ATTEMPTS_BEFORE_SCAN of them a scan looks for the keyboard
+// (it may have been re-paired or replaced).
+void BLEKeyboard::serviceConnection() {
+  uint32_t now = millis();
+  if (disconnected_.exchange(false)) {
+    disconnectedMs_ = now;
+    connParams_.onDisconnected();
+    if (subscribed_) {
+      resetBackoff(now); // keyboards drop the link to sleep: be listening when they wake
+    } else {
+      backOff(now); // the link never became usable, do not retry at full speed
+    }
+    subscribed_ = false;
   }
-  NimBLEAddress targetAddress(advDeviceAddress.c_str(), BLE_ADDR_PUBLIC);
-  if (NimBLEDevice::getCreatedClientCount()) {
-    pClient = NimBLEDevice::getClientByPeerAddress(targetAddress);
-    if (pClient) {
-      if (!pClient->connect(targetAddress, false)) {
-        ESP_LOGW(TAG, "Reconnect failed");
-        return false;
+  if (doConnect) {
+    saveKeyboardAddress(foundAddress_);
+    doConnect = false;
+    resetBackoff(now); // the scan found the keyboard, connect while it is still advertising
+  }
+  if (connectFailed_.exchange(false)) {
+    backOff(now);
+  }
+  if (linkUp_.exchange(false)) {
+    subscribed_ = subscribeToKeyboard();
+    if (subscribed_) {
+      resetBackoff(now);
+      // Once bonded, remember the identity address: a private address from the scan rotates away
+      NimBLEConnInfo info = client_->getConnInfo();
+      if (info.isBonded() && info.getIdAddress() != NimBLEAddress(advDeviceAddress.c_str(), advAddressType_)) {
+        saveKeyboardAddress(info.getIdAddress());
       }
-      ESP_LOGI(TAG, "Reconnected client");
-    } else {
-      pClient = NimBLEDevice::getDisconnectedClient();
+      connParams_.onConnected(client_);
+      ConnectivityState::instance().set(ConnectivityEvent::Keyboard, true);
+      lastReconnectMs_ = millis() - disconnectedMs_; // includes the subscription round trips
+      ESP_LOGI(TAG, "Keyboard ready %u ms after the link went down", (unsigned)lastReconnectMs_);
+    } else if (client_ != nullptr) {
+      client_->disconnect(); // onDisconnect starts over, after a backoff
+    }
+    return;
+  }
+
+  if (connectPending_) {
+    if (now - connectStartedMs_ > DIRECT_CONNECT_WINDOW_MS + CONNECT_CANCEL_GRACE_MS && client_ != nullptr) {
+      client_->cancelConnect(); // the stack did not report the timeout: give up on this attempt
+      connectPending_ = false;
+      connectFailed_ = true;
     }
+    return;
+  }
+  if (scanning_ || (int32_t)(now - nextAttemptMs_) < 0 || isConnected()) {
+    return;
+  }
+  if (advDeviceAddress.isEmpty() || directAttempts_ >= DIRECT_ATTEMPTS_BEFORE_SCAN) {
+    directAttempts_ = 0;
+    nextAttemptMs_ = now + scanTimeMs + backoffMs_;
+    startScan();
+    return;
   }
-  if (!pClient) {
+  directAttempts_++;
+  if (!startDirectConnect()) {
+    connectFailed_ = true;
+  }
+}
+
+void BLEKeyboard::backOff(uint32_t now) {
+  nextAttemptMs_ = now + backoffMs_;
+  backoffMs_ = backoffMs_ * 2 < RECONNECT_BACKOFF_MAX_MS ? backoffMs_ * 2 : RECONNECT_BACKOFF_MAX_MS;
+}
+
+void BLEKeyboard::resetBackoff(uint32_t now) {
+  directAttempts_ = 0;
+  backoffMs_ = RECONNECT_BACKOFF_MIN_MS;
+  nextAttemptMs_ = now;
+}
+
+void BLEKeyboard::saveKeyboardAddress(const NimBLEAddress &address) {
+  advDeviceAddress = address.toString().c_str();
+  advAddressType_ = address.getType();
+  SettingsStore::instance().putString(SETTINGS_NS, "addr", advDeviceAddress);
+  SettingsStore::instance().putInt(SETTINGS_NS, "addr_type", advAddressType_);
+  ESP_LOGI(TAG, "Keyboard address saved: %s (type %u)", advDeviceAddress.c_str(), advAddressType_);
+}
+
+bool BLEKeyboard::startDirectConnect() {
+  // The saved address: the bonded identity once paired (the controller resolves its private
+  // addresses), otherwise the address the scan found
+  NimBLEAddress address(advDeviceAddress.c_str(), advAddressType_);
+  if (client_ == nullptr) {
     if (NimBLEDevice::getCreatedClientCount() >= NIMBLE_MAX_CONNECTIONS) {
       ESP_LOGE(TAG, "Max clients reached - no more connections available");
       return false;
     }
-    pClient = NimBLEDevice::createClient();
+    client_ = NimBLEDevice::createClient();
+    client_->setClientCallbacks(clientCallbacks, false);
+    const ConnParamsManager::Params &typing = ConnParamsManager::PROFILES[ConnParamsManager::Typing]; // woken by a key press
+    client_->setConnectionParams(typing.minInterval, typing.maxInterval, typing.latency, typing.timeout);
     ESP_LOGI(TAG, "New client created");
-    pClient->setClientCallbacks(clientCallbacks, false);
-    pClient->setConnectionParams(12, 12, 0, 150);
-    pClient->setConnectTimeout(5 * 1000);
-    if (!pClient->connect(targetAddress)) {
-      NimBLEDevice::deleteClient(pClient);
-      ESP_LOGW(TAG, "Failed to connect, deleted client");
-      return false;
-    }
   }
-  if (!pClient->isConnected()) {
-    if (!pClient->connect(targetAddress)) {
-      ESP_LOGW(TAG, "Failed to connect");
-      return false;
-    }
-  }
-  ESP_LOGI(TAG, "Connected to: %s RSSI: %d", pClient->getPeerAddress().toString().c_str(), pClient->getRssi());
-  NimBLERemoteService *pSvc = nullptr;
-  pSvc = pClient->getService(BLE_SERVICE_UUID);
-  if (pSvc) {
-    std::vector<NimBLERemoteCharacteristic *> pChars = pSvc->getCharacteristics(true);
-    for (const auto &chr : pChars) {
-      if (chr->canNotify()) {
-        ESP_LOGI(TAG, "Subscribing to Characteristic UUID: %s, Handle: %d", chr->getUUID().toString().c_str(), chr->getHandle());
-        chr->subscribe(true, notifyCB);
-      }
-    }
-  } else {
-    ESP_LOGW(TAG, "%s service not found.", BLE_SERVICE_UUID);
+  client_->setConnectTimeout(DIRECT_CONNECT_WINDOW_MS);
+  connectStartedMs_ = millis();
+  connectPending_ = true;
+  // Asynchronous, keeping the attributes discovered last time so the subscription needs no rediscovery
+  if (!client_->connect(address, false, true)) {
+    connectPending_ = false;
+    ESP_LOGW(TAG, "Cannot start connecting to %s", address.toString().c_str());
+    return false;
   }
-  ESP_LOGI(TAG, "Done with this device!");
+  ESP_LOGI(TAG, "Connecting to %s (attempt %u, next wait %u ms)", address.toString().c_str(), (unsigned)directAttempts_, (unsigned)backoffMs_);
   return true;
 }
 
-char BLEKeyboard::convertKeyCodeToChar(uint8_t keyCode, uint8_t modifiers) {
-  const uint8_t kShiftMask = 0x02 | 0x20; // LeftShift | RightShift
-  bool shift = (modifiers & kShiftMask) != 0;
-
-  // Letters A..Z (HID 0x04..0x1D)
-  if (keyCode >= 0x04 && keyCode <= 0x1D) {
-    char base = static_cast<char>('a' + (keyCode - 0x04));
-    bool upper = shift ^ capsLockOn_;
-    return upper ? static_cast<char>(base - ('a' - 'A')) : base;
+bool BLEKeyboard::subscribeToKeyboard() {
+  if (client_ == nullptr || !client_->isConnected()) {
+    return false;
   }
-
-  // existing switch for all other keys remains unchanged
-  switch (keyCode) {
-  case 0x1E:
-    return shift ? '!' : '1';
-  case 0x1F:
-    return shift ? '@' : '2';
-  case 0x20:
-    return shift ? '#' : '3';
-  case 0x21:
-    return shift ? '$' : '4';
-  case 0x22:
-    return shift ? '%' : '5';
-  case 0x23:
-    return shift ? '^' : '6';
-  case 0x24:
-    return shift ? '&' : '7';
-  case 0x25:
-    return shift ? '*' : '8';
-  case 0x26:
-    return shift ? '(' : '9';
-  case 0x27:
-    return shift ? ')' : '0';
-  case 0x28:
-    return '\n';
-  case 0x29:
-    return 0; // ESCAPE, go through to function key handler
-  case 0x2A:
-    return 0x08;
-  case 0x2B:
-    return '\t';
-  case 0x2C:
-    return ' ';
-  case 0x2D:
-    return shift ? '_' : '-';
-  case 0x2E:
-    return shift ? '+' : '=';
-  case 0x2F:
-    return shift ? '{' : '[';
-  case 0x30:
-    return shift ? '}' : ']';
-  case 0x31:
-    return shift ? '|' : '\\';
-  case 0x32:
-    return shift ? '~' : '`';
-  case 0x33:
-    return shift ? ':' : ';';
-  case 0x34:
-    return shift ? '"' : '\'';
-  case 0x35:
-    return shift ? '~' : '`';
-  case 0x36:
-    return shift ? '<' : ',';
-  case 0x37:
-    return shift ? '>' : '.';
-  case 0x38:
-    return shift ? '?' : '/';
-  default:
-    return 0;
+  ESP_LOGI(TAG, "Connected to: %s RSSI: %d", client_->getPeerAddress().toString().c_str(), client_->getRssi());
+  NimBLERemoteService *pSvc = client_->getService(BLE_SERVICE_UUID);
+  if (!pSvc) {
+    ESP_LOGW(TAG, "%s service not found.", BLE_SERVICE_UUID);
+    return false;
   }
-}
-
-bool BLEKeyboard::isConnected() const {
-  if (advDeviceAddress.length() > 0) {
-    NimBLEClient *pClient = NimBLEDevice::getClientByPeerAddress(NimBLEAddress(advDeviceAddress.c_str(), BLE_ADDR_PUBLIC));
-    if (pClient && pClient->isConnected()) {
-      return true;
+  bool subscribed = false;
+  std::vector<NimBLERemoteCharacteristic *> pChars = pSvc->getCharacteristics(true);
+  for (const auto &chr : pChars) {
+    if (chr->canNotify()) {
+      ESP_LOGI(TAG, "Subscribing to Characteristic UUID: %s, Handle: %d", chr->getUUID().toString().c_str(), chr->getHandle());
+      subscribed |= chr->subscribe(true, notifyCB);
     }
   }
-  uint32_t t0 = millis();
-  if (millis() - t0 > 5000) {
-    ESP_LOGD(TAG, "advDevice: %s", advDeviceAddress.c_str());
+  return subscribed;
+}
+
+void BLEKeyboard::setLayout(LayoutId id) {
+  if ((size_t)id >= (size_t)LayoutId::COUNT) {
+    ESP_LOGW(TAG, "Unknown keyboard layout %d", (int)id);
+    return;
   }
-  return false;
+  layoutId_ = id;
+  SettingsStore::instance().putInt(SETTINGS_NS, "layout", (int32_t)id);
+  ESP_LOGI(TAG, "Keyboard layout: %s", getKeyboardLayout(id).name);
 }
 
+bool BLEKeyboard::isConnected() const { return client_ != nullptr && client_->isConnected(); }
+
 void BLEKeyboard::startScan() {
   ESP_LOGI(TAG, "Starting BLE scan...");
   if (pScan) {
+    scanFilter_.clear();
+    if (!advDeviceAddress.isEmpty()) {
+      scanFilter_.addAddress(NimBLEAddress(advDeviceAddress.c_str(), advAddressType_).getVal());
+    }
+    scanFilter_.addService(BLE_SERVICE_UUID16);
     scanning_ = true;
     scanStartTime_ = millis();
     scanEndTime_ = 0;
@@ -1,37 +1,57 @@
 #pragma once
 #include "common.h"
+#include "conn_params_manager.h"
+#include "core_eventing/event_system.h"
+#include "core_keymap/keyboard_layout.h"
+#include "hid_report_parser.h"
 #include "key_processor.h"
 #include "psram_allocator.h"
+#include "scan_filter.h"
 #include <NimBLEDevice.h>
-#include <Preferences.h>
+#include <atomic>
 #include <functional>
 
 #define BLE_SERVICE_UUID "1812"        // Keyboard Service UUID
+#define BLE_SERVICE_UUID16 0x1812      // The same, for the scan filter
 #define BLE_CHARACTERISTIC_UUID "2a4d" // Actually, we subscribe to any characteristic that can notify...
 
 namespace dict {
 
-using KeyCallback = std::function<void(char key, uint8_t keyCode, uint8_t modifiers)>;
+// One call per key transition; reportUs: micros() at the HID report, pressed: false on release
+using KeyCallback = std::function<void(char key, uint8_t keyCode, uint8_t modifiers, uint32_t reportUs, bool pressed)>;
 
 class BLEKeyboard {
 public:
+  // Reconnect schedule (see serviceConnection())
+  static const uint32_t DIRECT_CONNECT_WINDOW_MS = 5000; // one direct connection attempt waits this long for the keyboard to advertise
+  static const uint32_t CONNECT_CANCEL_GRACE_MS = 1000;  // cancel an attempt the stack has not ended this long after its window
+  static const uint32_t RECONNECT_BACKOFF_MIN_MS = 100;  // wait after the first failed attempt, doubled per failure
+  static const uint32_t RECONNECT_BACKOFF_MAX_MS = 3200;
+  static const uint8_t DIRECT_ATTEMPTS_BEFORE_SCAN = 4; // then scan once in case the keyboard changed
+
   // Singleton access
   static BLEKeyboard &instance(); // Get singleton instance
 
   // Core lifecycle methods
   bool initialize();    // Initialize BLE keyboard connection and scanning
   void shutdown();      // Clean shutdown of BLE keyboard
-  void tick();          // Process BLE keyboard events and connection state
+  void tick();          // Process BLE keyboard events and (re)connect
   bool isReady() const; // Check if BLE keyboard is ready for use
 
   // Main functionality methods
-  void begin(); // Start BLE scanning with optional restart interval
+  void begin(); // Start NimBLE; tick() then connects to the saved keyboard or scans for one
   void startScan();                               // Begin scanning for BLE keyboard devices
   bool isScanning() const { return scanning_; }
   uint32_t getScanStartTime() const { return scanStartTime_; }
   uint32_t getScanEndTime() const { return scanEndTime_; }
   bool isConnected() const;                                                    // Check if connected to a BLE keyboard
+  uint32_t getLastReconnectMs() const { return lastReconnectMs_; }             // Link down (or boot) -> reports subscribed, last time
+  void setRadioBusy(ConnParamsManager::RadioUser user, bool active); // Loop task: WiFi needs the radio, request the new profile now
+  const ConnParamsManager &getConnParams() const { return connParams_; }
+  const ScanFilter &getScanFilter() const { return scanFilter_; }
   void setKeyCallback(const KeyCallback &callback) { keyCallback = callback; } // Set callback for key events
+  void setLayout(LayoutId id);                                                 // Select the keyboard layout (saved in settings)
+  LayoutId getLayout() const { return layoutId_; }
 
 private:
   // Private constructor/destructor for singleton
@@ -49,10 +69,11 @@ private:
   uint32_t scanStartTime_;
   uint32_t scanEndTime_;
   String advDeviceAddress;
-  bool doConnect;
+  std::atomic<bool> doConnect; // the scan found the keyboard at foundAddress_
+  NimBLEAddress foundAddress_;
+  ScanFilter scanFilter_;      // saved address + HID service, rebuilt by startScan()
   int powerLevel;
   uint32_t scanTimeMs;
-  Preferences preferences;
   NimBLEScan *pScan;
 
   ClientCallbacks *clientCallbacks;
@@ -60,13 +81,39 @@ private:
 
   KeyCallback keyCallback;
   bool capsLockOn_ = false; // track CapsLock state
+  std::atomic<LayoutId> layoutId_{LayoutId::US};
+  HidReportParser reportParser_; // keys held in the last report (NimBLE host task only)
+
+  // Connection state: the flags are raised by NimBLE callbacks, the rest belongs to the loop task
+  uint8_t advAddressType_ = BLE_ADDR_PUBLIC;
+  NimBLEClient *client_ = nullptr;
+  std::atomic<bool> connectPending_{false}; // asynchronous connect in progress
+  std::atomic<bool> connectFailed_{false};
+  std::atomic<bool> linkUp_{false}; // connected, reports not subscribed yet
+  std::atomic<bool> disconnected_{false};
+  bool subscribed_ = false;
+  uint8_t directAttempts_ = 0;
+  uint32_t backoffMs_ = RECONNECT_BACKOFF_MIN_MS;
+  uint32_t nextAttemptMs_ = 0;
+  uint32_t connectStartedMs_ = 0;
+  uint32_t disconnectedMs_ = 0;
+  uint32_t lastReconnectMs_ = 0;
+  ConnParamsManager connParams_;
+  Subscription<EventBusFor<AudioStateEvent>> audioStateSubscription_;
+  Subscription<EventBusFor<FunctionKeyEvent>> statusSubscription_; // F1 prints the connection parameters
 
   KeyProcessor *keyProcessor_;
 
   // Private methods
   static void notifyCB(NimBLERemoteCharacteristic *pRemoteCharacteristic, uint8_t *pData, size_t length, bool isNotify);
-  bool connectToServer();
-  char convertKeyCodeToChar(uint8_t keyCode, uint8_t modifiers);
+  void dispatchReport(const uint8_t *report, size_t length, uint32_t reportUs); // Parse a report and call keyCallback per transition
+  void releaseAllKeys();                                                         // Release whatever the last report held
+  void serviceConnection();                // Reconnect state machine, called from tick()
+  void backOff(uint32_t now);              // Schedule the next attempt after the current backoff, then double it
+  void resetBackoff(uint32_t now);         // Next attempt now, backoff back to the minimum
+  void saveKeyboardAddress(const NimBLEAddress &address); // Reconnect to this address from now on (also persisted)
+  bool startDirectConnect();               // Start an asynchronous connection to the saved address
+  bool subscribeToKeyboard();              // Subscribe to the HID reports of the connected keyboard
 };
 
 } // namespace dict
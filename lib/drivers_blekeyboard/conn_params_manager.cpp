@@ -0,0 +1,122 @@
+#include "conn_params_manager.h"
+#include "core_misc/log.h"
+
+namespace dict {
+
+static const char *TAG = "BLEConnParams";
+
+// Timeouts stay above (1 + latency) * max interval * 2, as the spec requires
+const ConnParamsManager::Params ConnParamsManager::PROFILES[PROFILE_COUNT] = {
+    {6, 12, 0, 200},  // Typing: 7.5-15 ms
+    {24, 40, 4, 400}, // Idle: 30-50 ms, keyboard may sleep through 4 events
+    {48, 64, 2, 500}, // Streaming: 60-80 ms
+};
+
+const char *ConnParamsManager::profileName(Profile profile) {
+  switch (profile) {
+  case Typing:
+    return "typing";
+  case Idle:
+    return "idle";
+  case Streaming:
+    return "streaming";
+  default:
+    return "?";
+  }
+}
+
+void ConnParamsManager::onKeyActivity() { lastKeyMs_ = millis(); }
+
+void ConnParamsManager::setRadioBusy(RadioUser user, bool active) {
+  if (active) {
+    radioUsers_ |= user;
+  } else {
+    radioUsers_ &= (uint8_t)~user;
+  }
+}
+
+void ConnParamsManager::onConnected(NimBLEClient *client) {
+  uint32_t now = millis();
+  linked_ = true;
+  lastKeyMs_ = now;
+  profile_ = Typing; // what the connection was created with (BLEKeyboard::startDirectConnect)
+  profileSinceMs_ = now;
+  lastRequestMs_ = now;
+  readBack(client);
+}
+
+void ConnParamsManager::onDisconnected() {
+  if (linked_) {
+    timeInProfileMs_[profile_] += millis() - profileSinceMs_;
+  }
+  linked_ = false;
+  readbackPending_ = false;
+}
+
+ConnParamsManager::Profile ConnParamsManager::select(uint32_t now) const {
+  if (radioUsers_ != 0) {
+    return Streaming;
+  }
+  return now - lastKeyMs_ < TYPING_HOLD_MS ? Typing : Idle;
+}
+
+void ConnParamsManager::tick(NimBLEClient *client) {
+  if (!linked_ || client == nullptr || !client->isConnected()) {
+    return;
+  }
+  uint32_t now = millis();
+  if (readbackPending_ && now - lastRequestMs_ >= READBACK_DELAY_MS) {
+    readbackPending_ = false;
+    readBack(client);
+  }
+  Profile wanted = select(now);
+  if (wanted == profile_ || now - lastRequestMs_ < MIN_UPDATE_GAP_MS) {
+    return;
+  }
+  const Params &p = PROFILES[wanted];
+  lastRequestMs_ = now;
+  requests_++;
+  if (!client->updateConnParams(p.minInterval, p.maxInterval, p.latency, p.timeout)) {
+    refused_++;
+    ESP_LOGW(TAG, "Request for %s parameters failed", profileName(wanted));
+    return; // retried after MIN_UPDATE_GAP_MS
+  }
+  enterProfile(wanted, now);
+  readbackPending_ = true;
+}
+
+void ConnParamsManager::enterProfile(Profile profile, uint32_t now) {
+  timeInProfileMs_[profile_] += now - profileSinceMs_;
+  profileSinceMs_ = now;
+  profile_ = profile;
+}
+
+void ConnParamsManager::readBack(NimBLEClient *client) {
+  NimBLEConnInfo info = client->getConnInfo();
+  interval_ = info.getConnInterval();
+  latency_ = info.getConnLatency();
+  timeout_ = info.getConnTimeout();
+  const Params &p = PROFILES[profile_];
+  if (interval_ < p.minInterval || interval_ > p.maxInterval) {
+    ESP_LOGW(TAG, "Keyboard kept %.2f ms for %s (asked %.2f-%.2f ms)", interval_ * 1.25f, profileName(profile_), p.minInterval * 1.25f,
+             p.maxInterval * 1.25f);
+  }
+  // Connection events per second is the share of radio time BLE takes from WiFi
+  ESP_LOGI(TAG, "%s: interval %.2f ms, latency %u, timeout %u ms, %u connection events/s", profileName(profile_), interval_ * 1.25f, latency_,
+           timeout_ * 10, interval_ ? (unsigned)(800 / interval_) : 0);
+}
+
+void ConnParamsManager::print() const {
+  ESP_LOGI(TAG, "=== BLE Connection Parameters ===");
+  ESP_LOGI(TAG, "Profile: %s, interval %.2f ms, latency %u, timeout %u ms", linked_ ? profileName(profile_) : "not connected", interval_ * 1.25f,
+           latency_, timeout_ * 10);
+  uint32_t now = millis();
+  for (int profile = 0; profile < PROFILE_COUNT; profile++) {
+    uint32_t ms = timeInProfileMs_[profile] + (linked_ && profile == profile_ ? now - profileSinceMs_ : 0);
+    ESP_LOGI(TAG, "  %-9s %8u ms", profileName((Profile)profile), (unsigned)ms);
+  }
+  ESP_LOGI(TAG, "Requests: %u (%u failed)", (unsigned)requests_, (unsigned)refused_);
+  ESP_LOGI(TAG, "=================================");
+}
+
+} // namespace dict
@@ -0,0 +1,73 @@
+#pragma once
+#include "common.h"
+#include <NimBLEDevice.h>
+#include <atomic>
+
+namespace dict {
+
+/**
+ * @brief Picks BLE connection parameters for what the device is doing
+ *
+ * The ESP32 shares one radio between BLE and WiFi, and every connection
+ * event takes a slot from WiFi. Three profiles:
+ *   Typing     short interval, no slave latency: a report waits at most one short interval
+ *   Idle       longer interval with slave latency: the keyboard wakes the link when it has a key
+ *   Streaming  longest interval while audio plays or a lookup is on the network
+ * Streaming wins over Typing, Typing holds for TYPING_HOLD_MS after the last
+ * key. Requests are spaced at least MIN_UPDATE_GAP_MS apart (peripherals
+ * refuse rapid updates) and the parameters the keyboard accepted are read
+ * back and logged. print() (F1) shows the time spent in each profile next to
+ * the key latency and audio metrics printed with it.
+ */
+class ConnParamsManager {
+public:
+  enum Profile : uint8_t { Typing, Idle, Streaming, PROFILE_COUNT };
+  enum RadioUser : uint8_t { Audio = 1, Lookup = 2 }; // Bits for setRadioBusy()
+
+  struct Params {
+    uint16_t minInterval; // 1.25 ms units
+    uint16_t maxInterval; // 1.25 ms units
+    uint16_t latency;     // connection events the keyboard may skip
+    uint16_t timeout;     // supervision timeout, 10 ms units
+  };
+  static const Params PROFILES[PROFILE_COUNT];
+
+  static const uint32_t TYPING_HOLD_MS = 3000;
+  static const uint32_t MIN_UPDATE_GAP_MS = 1000;
+  static const uint32_t READBACK_DELAY_MS = 500; // negotiation takes a few connection events
+
+  // Any task
+  void onKeyActivity();                           // A key went down or up
+  void setRadioBusy(RadioUser user, bool active); // WiFi needs the radio (audio stream, lookup)
+
+  // Loop task
+  void onConnected(NimBLEClient *client); // The keyboard connects after a key press: start in Typing
+  void onDisconnected();
+  void tick(NimBLEClient *client); // Request the profile the activity calls for
+
+  Profile getProfile() const { return profile_; }
+  static const char *profileName(Profile profile);
+  void print() const;
+
+private:
+  std::atomic<uint32_t> lastKeyMs_{0};
+  std::atomic<uint8_t> radioUsers_{0};
+
+  bool linked_ = false;
+  Profile profile_ = Typing; // last requested
+  uint32_t lastRequestMs_ = 0;
+  bool readbackPending_ = false;
+  uint32_t profileSinceMs_ = 0;
+  uint32_t timeInProfileMs_[PROFILE_COUNT] = {};
+  uint32_t requests_ = 0;
+  uint32_t refused_ = 0;
+  uint16_t interval_ = 0; // negotiated, 1.25 ms units
+  uint16_t latency_ = 0;
+  uint16_t timeout_ = 0;
+
+  Profile select(uint32_t now) const;
+  void enterProfile(Profile profile, uint32_t now);
+  void readBack(NimBLEClient *client);
+};
+
+} // namespace dict
@@ -0,0 +1,60 @@
+#include "hid_report_parser.h"
+#include <string.h>
+
+namespace dict {
+
+bool HidReportParser::contains(const uint8_t *keys, uint8_t keyCode) {
+  for (size_t i = 0; i < KEY_SLOTS; i++) {
+    if (keys[i] == keyCode) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HidReportParser::isHeld(uint8_t keyCode) const { return keyCode != 0 && contains(keys_, keyCode); }
+
+size_t HidReportParser::parse(const uint8_t *report, size_t length, HidKeyTransition *out) {
+  if (report == nullptr || length < 3) {
+    return 0;
+  }
+
+  // Short reports just have fewer slots; missing slots are empty
+  uint8_t keys[KEY_SLOTS] = {};
+  size_t slots = length - 2 < KEY_SLOTS ? length - 2 : KEY_SLOTS;
+  memcpy(keys, report + 2, slots);
+  if (keys[0] == KEY_ERROR_ROLLOVER) {
+    rolloverErrors_++;
+    return 0; // too many keys down: the report says nothing about which, keep the last known state
+  }
+  uint8_t modifiers = report[0];
+
+  size_t count = 0;
+  uint8_t changed = modifiers ^ modifiers_;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    if (changed & (1 << bit)) {
+      out[count++] = {(uint8_t)(MODIFIER_USAGE_BASE + bit), modifiers, (modifiers & (1 << bit)) != 0};
+    }
+  }
+  for (size_t i = 0; i < KEY_SLOTS; i++) {
+    if (keys_[i] != 0 && !contains(keys, keys_[i])) {
+      out[count++] = {keys_[i], modifiers, false};
+    }
+  }
+  for (size_t i = 0; i < KEY_SLOTS; i++) {
+    if (keys[i] != 0 && !contains(keys_, keys[i])) {
+      out[count++] = {keys[i], modifiers, true};
+    }
+  }
+
+  modifiers_ = modifiers;
+  memcpy(keys_, keys, KEY_SLOTS);
+  return count;
+}
+
+void HidReportParser::reset() {
+  modifiers_ = 0;
+  memset(keys_, 0, sizeof(keys_));
+}
+
+} // namespace dict
@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dict {
+
+// One key or modifier going down or up
+struct HidKeyTransition {
+  uint8_t keyCode;   // HID usage ID; modifiers use their usage IDs 0xE0..0xE7
+  uint8_t modifiers; // Modifier byte of the report the transition came from
+  bool pressed;      // false on release
+};
+
+/**
+ * @brief Turns keyboard input reports into key transitions
+ *
+ * Reports use the boot keyboard layout: modifier byte, reserved byte, then
+ * up to six key slots (6KRO). Each report is diffed against the previous
+ * one, so a key held across reports yields one press and one release no
+ * matter how often the keyboard resends it. Order within a report:
+ * modifier edges, key releases, key presses (so Shift+A in one report
+ * reaches the key with Shift already down). Rollover error reports (all
+ * slots 0x01) are ignored. State lives in fixed arrays; parse() does not
+ * allocate and is safe to call from the BLE notify callback.
+ */
+class HidReportParser {
+public:
+  static const size_t KEY_SLOTS = 6;
+  static const size_t MAX_TRANSITIONS = 8 + 2 * KEY_SLOTS; // every modifier bit, every slot released and refilled
+  static const uint8_t KEY_ERROR_ROLLOVER = 0x01;
+  static const uint8_t MODIFIER_USAGE_BASE = 0xE0; // LeftCtrl; bit n of the modifier byte is usage 0xE0 + n
+
+  // Writes the transitions for one report into out (room for MAX_TRANSITIONS) and returns how many
+  size_t parse(const uint8_t *report, size_t length, HidKeyTransition *out);
+  void reset(); // Forget held keys, e.g. after a disconnect
+
+  uint8_t getModifiers() const { return modifiers_; }
+  bool isHeld(uint8_t keyCode) const;
+  uint32_t getRolloverErrors() const { return rolloverErrors_; }
+
+private:
+  uint8_t modifiers_ = 0;
+  uint8_t keys_[KEY_SLOTS] = {};
+  uint32_t rolloverErrors_ = 0;
+
+  static bool contains(const uint8_t *keys, uint8_t keyCode);
+};
+
+} // namespace dict
@@ -1,13 +1,49 @@
 #include "key_processor.h"
 #include "core_misc/log.h"
+#include "core_settings/settings_store.h"
+#include "core_eventing/input_latency.h"
 #include "core_misc/utils.h"
 #include "lvgl.h"
 
 namespace dict {
 
 static const char *TAG = "KeyProcessor";
+static const char *SETTINGS_NS = "ble_config";
 
-KeyProcessor::KeyProcessor() {
+// HID usage IDs: F1=58 .. F12=69, Escape=41, arrows Right=79, Left=80, Down=81, Up=82
+static constexpr FunctionKeyMap::Binding DEFAULT_FUNCTION_KEY_BINDINGS[] = {
+    {58, FunctionKeyEvent::PrintMemoryStatus},  // F1
+    {59, FunctionKeyEvent::ReadWord},           // F2
+    {60, FunctionKeyEvent::ReadExplanation},    // F3
+    {61, FunctionKeyEvent::ReadSampleSentence}, // F4
+    {62, FunctionKeyEvent::ReadAll},            // F5
+    {63, FunctionKeyEvent::SpeedDown},          // F6
+    {64, FunctionKeyEvent::SpeedUp},            // F7
+    {65, FunctionKeyEvent::ToggleRecording},    // F8
+    {66, FunctionKeyEvent::ToggleReplay},       // F9
+    {67, FunctionKeyEvent::VolumeDown},         // F10
+    {68, FunctionKeyEvent::VolumeUp},           // F11
+    {69, FunctionKeyEvent::WifiSettings},       // F12
+    {79, FunctionKeyEvent::RightArrow},
+    {80, FunctionKeyEvent::LeftArrow},
+    {81, FunctionKeyEvent::DownArrow},
+    {82, FunctionKeyEvent::UpArrow},
+    {41, FunctionKeyEvent::Escape},
+};
+static constexpr FunctionKeyMap::Table DEFAULT_FUNCTION_KEYS = FunctionKeyMap::makeFunctionKeyTable(DEFAULT_FUNCTION_KEY_BINDINGS);
+
+// Auto-repeat timing; setRepeatTiming() changes it at run time
+#ifndef DICT_KEY_REPEAT_DELAY_MS
+#define DICT_KEY_REPEAT_DELAY_MS KeyProcessor::DEFAULT_REPEAT_DELAY_MS
+#endif
+#ifndef DICT_KEY_REPEAT_INTERVAL_MS
+#define DICT_KEY_REPEAT_INTERVAL_MS KeyProcessor::DEFAULT_REPEAT_INTERVAL_MS
+#endif
+
+static const uint32_t REPEAT_ACTIVE = 1u << 24;
+static const uint8_t MODIFIER_USAGE_FIRST = 0xE0; // LeftCtrl..RightGUI are 0xE0..0xE7
+
+KeyProcessor::KeyProcessor() : functionKeys_(DEFAULT_FUNCTION_KEYS) {
   keyEventBus_ = &EventSystem::instance().getEventBus<KeyEvent>();
   functionKeyEventBus_ = &EventSystem::instance().getEventBus<FunctionKeyEvent>();
 }
@@ -16,60 +52,162 @@ KeyProcessor::~KeyProcessor() { shutdown(); }
 
 bool KeyProcessor::initialize() {
   ESP_LOGI(TAG, "Initializing key processor...");
+  setRepeatTiming(DICT_KEY_REPEAT_DELAY_MS, DICT_KEY_REPEAT_INTERVAL_MS);
+  String remapped = SettingsStore::instance().getString(SETTINGS_NS, "fnkeys");
+  if (remapped.length() > 0) {
+    functionKeys_.reset();
+    ESP_LOGI(TAG, "%u function keys remapped", (unsigned)functionKeys_.parse(remapped.c_str()));
+  }
+  if (repeatTimer_ == nullptr) {
+    // Auto-reload: after the first (delay) expiry the callback switches the period to the interval
+    repeatTimer_ = xTimerCreate("keyRepeat", pdMS_TO_TICKS(DEFAULT_REPEAT_DELAY_MS), pdTRUE, this, repeatTimerCallback);
+    if (repeatTimer_ == nullptr) {
+      ESP_LOGE(TAG, "Failed to create key repeat timer, auto-repeat disabled");
+    }
+  }
   return true;
 }
 
-void KeyProcessor::shutdown() { ESP_LOGI(TAG, "Shutting down key processor..."); }
+void KeyProcessor::shutdown() {
+  ESP_LOGI(TAG, "Shutting down key processor...");
+  repeatKey_ = 0;
+  if (repeatTimer_ != nullptr) {
+    xTimerDelete(repeatTimer_, portMAX_DELAY);
+    repeatTimer_ = nullptr;
+  }
+}
 
 void KeyProcessor::tick() {}
 
 bool KeyProcessor::isReady() const { return true; }
 
-void KeyProcessor::sendKeyToLVGL(char key, uint8_t key1, uint8_t modifiers) {
-  if (key != 0) {
-    ESP_LOGD(TAG, "Key: '%c' (0x%02X)", key, (unsigned char)key);
-    KeyEvent event{key, key1, modifiers, true};
-    keyEventBus_->publish(event);
-  } else {
-    ESP_LOGD(TAG, "Functional key: %d, %d", key1, modifiers);
+void KeyProcessor::sendKeyToLVGL(char key, uint8_t key1, uint8_t modifiers, uint32_t reportUs, bool pressed) {
+  // Every transition is a KeyEvent (non-text keys carry key 0); presses of function keys are also FunctionKeyEvents
+  ESP_LOGD(TAG, "Key %s: '%c' (0x%02X), code %d, modifiers %d", pressed ? "down" : "up", key ? key : ' ', (unsigned char)key, key1, modifiers);
+  uint32_t now = micros();
+  if (reportUs == 0) {
+    reportUs = now;
+  }
+  KeyEvent event{key, key1, modifiers, true, reportUs, now, pressed};
+  if (pressed && event.isText()) {
+    InputLatency::instance().record(InputLatency::Publish, now - reportUs);
+  }
+  keyEventBus_->publish(event);
+  if (key == 0 && pressed) {
     FunctionKeyEvent::Type action = convertKeyCodeToFunction(key1);
     if (action != FunctionKeyEvent::None) {
-      FunctionKeyEvent event{action};
-      functionKeyEventBus_->publish(event);
+      functionKeyEventBus_->publish(FunctionKeyEvent{action});
     }
   }
+
+  // The newest key owns the repeat; modifiers neither start nor stop it
+  if (key1 >= MODIFIER_USAGE_FIRST) {
+    return;
+  }
+  if (pressed && isRepeatable(key, key1)) {
+    startRepeat(key, key1, modifiers);
+  } else if (pressed || ((repeatKey_ >> 8) & 0xFF) == key1) {
+    stopRepeat();
+  }
+}
+
+// ================================ AUTO-REPEAT ================================
+void KeyProcessor::setRepeatTiming(uint16_t delayMs, uint16_t intervalMs) {
+  repeatDelayMs_ = delayMs > 0 ? delayMs : 1;
+  repeatIntervalMs_ = intervalMs;
+  if (intervalMs == 0) {
+    stopRepeat();
+  }
 }
 
-FunctionKeyEvent::Type KeyProcessor::convertKeyCodeToFunction(uint8_t keyCode) {
-  switch (keyCode) {
-  // HID usage IDs: F1=58, F2=59, F3=60, F4=61, F5=62, F6=63, F7=64, F8=65, F9=66, F10=67, F11=68, F12=69
-  case 67:
-    return FunctionKeyEvent::VolumeDown; // F10 -> VolumeDown
-  case 68:
-    return FunctionKeyEvent::VolumeUp; // F11 -> VolumeUp
-  case 69:
-    return FunctionKeyEvent::WifiSettings; // F12 -> WifiSettings
-  case 58:
-    return FunctionKeyEvent::PrintMemoryStatus; // F1  -> PrintMemoryStatus
-  case 59:
-    return FunctionKeyEvent::ReadWord; // F2  -> ReadWord
-  case 60:
-    return FunctionKeyEvent::ReadExplanation; // F3  -> ReadExplanation
-  case 61:
-    return FunctionKeyEvent::ReadSampleSentence; // F4  -> ReadSampleSentence
-  case 81:
-    return FunctionKeyEvent::DownArrow; // Down Arrow -> DownArrow
-  case 82:
-    return FunctionKeyEvent::UpArrow; // Up Arrow -> UpArrow
-  case 80:
-    return FunctionKeyEvent::LeftArrow; // Left Arrow -> LeftArrow
-  case 79:
-    return FunctionKeyEvent::RightArrow; // Right Arrow -> RightArrow
-  case 41:
-    return FunctionKeyEvent::Escape; // ESC
-  default:
-    return FunctionKeyEvent::None;
+bool KeyProcessor::isRepeatable(char key, uint8_t keyCode) {
+  // Not Enter and Tab: they submit or move focus, once is enough
+  if (key == 0x08 || (key >= 32 && key <= 126)) {
+    return true;
+  }
+  if (key != 0) {
+    return false;
+  }
+  FunctionKeyEvent::Type action = convertKeyCodeToFunction(keyCode);
+  return action == FunctionKeyEvent::UpArrow || action == FunctionKeyEvent::DownArrow || action == FunctionKeyEvent::LeftArrow ||
+         action == FunctionKeyEvent::RightArrow;
+}
+
+void KeyProcessor::startRepeat(char key, uint8_t keyCode, uint8_t modifiers) {
+  if (repeatTimer_ == nullptr || repeatIntervalMs_ == 0) {
+    return;
+  }
+  repeatKey_ = (uint8_t)key | (keyCode << 8) | (modifiers << 16) | REPEAT_ACTIVE;
+  // Also (re)starts the timer; never block the BLE host task on the timer queue
+  TickType_t delayTicks = pdMS_TO_TICKS(repeatDelayMs_);
+  if (xTimerChangePeriod(repeatTimer_, delayTicks > 0 ? delayTicks : 1, 0) != pdPASS) {
+    repeatKey_ = 0;
+    ESP_LOGW(TAG, "Key repeat timer queue full, not repeating 0x%02X", keyCode);
+  }
+}
+
+void KeyProcessor::stopRepeat() {
+  if (repeatKey_.exchange(0) != 0 && repeatTimer_ != nullptr) {
+    xTimerStop(repeatTimer_, 0); // if the queue is full the callback sees no key and stops itself
+  }
+}
+
+void KeyProcessor::repeatTimerCallback(TimerHandle_t timer) { static_cast<KeyProcessor *>(pvTimerGetTimerID(timer))->onRepeatTimer(); }
+
+void KeyProcessor::onRepeatTimer() {
+  uint32_t held = repeatKey_;
+  if (held == 0) {
+    xTimerStop(repeatTimer_, 0);
+    return;
+  }
+  TickType_t intervalTicks = pdMS_TO_TICKS(repeatIntervalMs_);
+  if (xTimerGetPeriod(repeatTimer_) != intervalTicks) {
+    xTimerChangePeriod(repeatTimer_, intervalTicks > 0 ? intervalTicks : 1, 0); // first expiry was the delay
+  }
+
+  char key = (char)(held & 0xFF);
+  uint8_t keyCode = (held >> 8) & 0xFF;
+  uint8_t modifiers = (held >> 16) & 0xFF;
+  if (key != 0) {
+    if (keyEventBus_->pending() >= REPEAT_MAX_PENDING) {
+      skippedRepeats_++;
+      return;
+    }
+    uint32_t now = micros();
+    keyEventBus_->publish(KeyEvent{key, keyCode, modifiers, true, now, now, true, true});
+  } else {
+    if (functionKeyEventBus_->pending() >= REPEAT_MAX_PENDING) {
+      skippedRepeats_++;
+      return;
+    }
+    functionKeyEventBus_->publish(FunctionKeyEvent{convertKeyCodeToFunction(keyCode)});
+  }
+  repeats_++;
+}
+
+FunctionKeyEvent::Type KeyProcessor::convertKeyCodeToFunction(uint8_t keyCode) { return (FunctionKeyEvent::Type)functionKeys_.lookup(keyCode); }
+
+void KeyProcessor::remapFunctionKey(uint8_t keyCode, FunctionKeyEvent::Type action) {
+  functionKeys_.remap(keyCode, (uint8_t)action);
+  saveFunctionKeys();
+}
+
+void KeyProcessor::resetFunctionKeys() {
+  functionKeys_.reset();
+  saveFunctionKeys();
+}
+
+void KeyProcessor::saveFunctionKeys() {
+  if (!functionKeys_.isRemapped()) {
+    SettingsStore::instance().remove(SETTINGS_NS, "fnkeys");
+    return;
+  }
+  char text[FUNCTION_KEYS_TEXT_SIZE];
+  if (functionKeys_.format(text, sizeof(text)) == 0) {
+    ESP_LOGW(TAG, "Too many remapped function keys to save");
+    return;
   }
+  SettingsStore::instance().putString(SETTINGS_NS, "fnkeys", text);
 }
 
 } // namespace dict
@@ -2,12 +2,30 @@
 #include "common.h"
 #include "core_eventing/event_system.h"
 #include "core_eventing/events.h"
+#include "core_keymap/function_key_map.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include <atomic>
 #include <functional>
 
 namespace dict {
 
+/**
+ * @brief Turns key transitions into KeyEvents and FunctionKeyEvents
+ *
+ * Also repeats a held key in software: a FreeRTOS timer fires after the
+ * repeat delay and then every interval until the key is released or another
+ * key is pressed. Repeats of text keys (printable, Backspace) are KeyEvents,
+ * repeats of the arrows FunctionKeyEvents. The timer keeps its own pace on
+ * the timer service task, so loop() timing does not stretch the interval;
+ * a repeat is skipped instead of queued while the UI loop is behind.
+ */
 class KeyProcessor {
 public:
+  static const uint16_t DEFAULT_REPEAT_DELAY_MS = 500;  // held this long before the first repeat
+  static const uint16_t DEFAULT_REPEAT_INTERVAL_MS = 33; // then one repeat per interval (~30/s)
+  static const size_t REPEAT_MAX_PENDING = 2;            // skip a repeat while this many events of its kind are queued
+
   // Constructor/Destructor
   KeyProcessor();
   ~KeyProcessor();
@@ -19,15 +37,40 @@ public:
   bool isReady() const; // Check if key processor is ready
 
   // Main functionality methods
-  void sendKeyToLVGL(char key, uint8_t key1, uint8_t modifiers); // Send key event to LVGL and event system
+  void sendKeyToLVGL(char key, uint8_t key1, uint8_t modifiers, uint32_t reportUs = 0,
+                     bool pressed = true); // Send key event to LVGL and event system (reportUs 0: now)
+  void setRepeatTiming(uint16_t delayMs, uint16_t intervalMs); // intervalMs 0 disables auto-repeat
+  uint32_t getRepeatCount() const { return repeats_; }          // Repeats published
+  uint32_t getSkippedRepeats() const { return skippedRepeats_; } // Repeats dropped while the UI loop was behind
+
+  // Function keys (defaults: F1..F12, arrows, Escape); remaps are saved in settings and loaded by initialize()
+  void remapFunctionKey(uint8_t keyCode, FunctionKeyEvent::Type action); // FunctionKeyEvent::None unbinds the key
+  void resetFunctionKeys();                                              // Back to the default bindings
 
 private:
   // Private member variables
-  EventBus<KeyEvent> *keyEventBus_;
-  EventBus<FunctionKeyEvent> *functionKeyEventBus_;
+  // Lock-free ring buses: published from the NimBLE host task
+  EventBusFor<KeyEvent> *keyEventBus_;
+  EventBusFor<FunctionKeyEvent> *functionKeyEventBus_;
+  FunctionKeyMap functionKeys_;
+  static const size_t FUNCTION_KEYS_TEXT_SIZE = 128;
+
+  // Auto-repeat: written on the NimBLE host task, read on the timer service task
+  TimerHandle_t repeatTimer_ = nullptr;
+  std::atomic<uint32_t> repeatKey_{0}; // held key packed as key | keyCode << 8 | modifiers << 16 | REPEAT_ACTIVE, 0 when none
+  std::atomic<uint16_t> repeatDelayMs_{DEFAULT_REPEAT_DELAY_MS};
+  std::atomic<uint16_t> repeatIntervalMs_{DEFAULT_REPEAT_INTERVAL_MS};
+  std::atomic<uint32_t> repeats_{0};
+  std::atomic<uint32_t> skippedRepeats_{0};
 
   // Private methods
-  FunctionKeyEvent::Type convertKeyCodeToFunction(uint8_t keyCode);
+  FunctionKeyEvent::Type convertKeyCodeToFunction(uint8_t keyCode); // One table lookup
+  void saveFunctionKeys();
+  bool isRepeatable(char key, uint8_t keyCode);
+  void startRepeat(char key, uint8_t keyCode, uint8_t modifiers);
+  void stopRepeat();
+  void onRepeatTimer();
+  static void repeatTimerCallback(TimerHandle_t timer);
 };
 
 } // namespace dict
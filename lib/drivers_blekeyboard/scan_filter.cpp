@@ -0,0 +1,109 @@
+#include "scan_filter.h"
+#include "core_misc/log.h"
+#include <string.h>
+
+namespace dict {
+
+static const char *TAG = "BLEScanFilter";
+
+// AD types carrying 16-bit service UUIDs (Core Specification Supplement, 1.1)
+static const uint8_t AD_UUID16_INCOMPLETE = 0x02;
+static const uint8_t AD_UUID16_COMPLETE = 0x03;
+
+void ScanFilter::clear() {
+  addressCount_ = 0;
+  serviceCount_ = 0;
+}
+
+bool ScanFilter::addAddress(const uint8_t *address) {
+  if (address == nullptr || addressCount_ >= MAX_ADDRESSES) {
+    return false;
+  }
+  memcpy(addresses_[addressCount_++], address, ADDRESS_LEN);
+  return true;
+}
+
+bool ScanFilter::addService(uint16_t uuid16) {
+  if (serviceCount_ >= MAX_SERVICES) {
+    return false;
+  }
+  services_[serviceCount_++] = uuid16;
+  return true;
+}
+
+ScanFilter::Match ScanFilter::match(const uint8_t *address, const uint8_t *payload, size_t length) {
+  seen_++;
+  if (address != nullptr && matchesAddress(address)) {
+    matched_++;
+    return Address;
+  }
+  bool malformed = false;
+  if (advertisesService(payload, length, malformed)) {
+    matched_++;
+    return Service;
+  }
+  if (malformed) {
+    malformed_++;
+  }
+  dropped_++;
+  return None;
+}
+
+bool ScanFilter::matchesAddress(const uint8_t *address) const {
+  for (uint8_t i = 0; i < addressCount_; i++) {
+    if (memcmp(addresses_[i], address, ADDRESS_LEN) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The payload is a sequence of AD structures: length (type + data), type, data
+bool ScanFilter::advertisesService(const uint8_t *payload, size_t length, bool &malformed) const {
+  if (payload == nullptr || serviceCount_ == 0) {
+    return false;
+  }
+  size_t pos = 0;
+  while (pos < length) {
+    uint8_t fieldLength = payload[pos];
+    if (fieldLength == 0) {
+      break; // zero padding to the end of the PDU
+    }
+    if (pos + 1 + fieldLength > length) {
+      malformed = true;
+      return false;
+    }
+    uint8_t type = payload[pos + 1];
+    if (type == AD_UUID16_INCOMPLETE || type == AD_UUID16_COMPLETE) {
+      const uint8_t *data = payload + pos + 2;
+      size_t dataLength = fieldLength - 1;
+      for (size_t i = 0; i + 2 <= dataLength; i += 2) {
+        uint16_t uuid = data[i] | (data[i + 1] << 8);
+        for (uint8_t s = 0; s < serviceCount_; s++) {
+          if (services_[s] == uuid) {
+            return true;
+          }
+        }
+      }
+    }
+    pos += 1 + fieldLength;
+  }
+  return false;
+}
+
+void ScanFilter::resetCounters() {
+  seen_ = 0;
+  matched_ = 0;
+  dropped_ = 0;
+  malformed_ = 0;
+}
+
+void ScanFilter::print() const {
+  ESP_LOGI(TAG, "=== BLE Scan Filter ===");
+  ESP_LOGI(TAG, "Filter: %u address(es), %u service(s)", addressCount_, serviceCount_);
+  ESP_LOGI(TAG, "Advertisements: %u seen, %u matched, %u dropped (%u malformed)", (unsigned)seen_, (unsigned)matched_, (unsigned)dropped_,
+           (unsigned)malformed_);
+  ESP_LOGI(TAG, "=======================");
+}
+
+} // namespace dict
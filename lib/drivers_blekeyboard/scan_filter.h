@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dict {
+
+/**
+ * @brief Decides per advertisement whether it is our keyboard
+ *
+ * The filter set (device addresses and 16-bit service UUIDs) is built on
+ * the loop task before a scan starts; match() then only compares raw
+ * bytes: the 6-byte address, and the UUID16 lists in the advertising
+ * payload. It does not allocate, log or touch the settings store, so the
+ * scan callback stays cheap when a crowded room advertises hundreds of
+ * packets a second. Addresses are compared as NimBLE stores them
+ * (little endian); the address type is ignored, as before.
+ */
+class ScanFilter {
+public:
+  static const size_t ADDRESS_LEN = 6;
+  static const size_t MAX_ADDRESSES = 2;
+  static const size_t MAX_SERVICES = 2;
+
+  enum Match : uint8_t { None, Address, Service };
+
+  // Loop task, while not scanning
+  void clear();
+  bool addAddress(const uint8_t *address); // ADDRESS_LEN bytes; false when full
+  bool addService(uint16_t uuid16);        // false when full
+
+  // Scan callback
+  Match match(const uint8_t *address, const uint8_t *payload, size_t length);
+
+  uint32_t getSeen() const { return seen_; }
+  uint32_t getMatched() const { return matched_; }
+  uint32_t getDropped() const { return dropped_; }
+  uint32_t getMalformed() const { return malformed_; } // payloads with a bad AD structure (also counted as dropped)
+  void resetCounters();
+  void print() const;
+
+private:
+  uint8_t addresses_[MAX_ADDRESSES][ADDRESS_LEN] = {};
+  uint16_t services_[MAX_SERVICES] = {};
+  uint8_t addressCount_ = 0;
+  uint8_t serviceCount_ = 0;
+
+  std::atomic<uint32_t> seen_{0};
+  std::atomic<uint32_t> matched_{0};
+  std::atomic<uint32_t> dropped_{0};
+  std::atomic<uint32_t> malformed_{0};
+
+  bool matchesAddress(const uint8_t *address) const;
+  bool advertisesService(const uint8_t *payload, size_t length, bool &malformed) const;
+};
+
+} // namespace dict
@@ -1,4 +1,5 @@
 #include "display_manager.h"
+#include "core_eventing/input_latency.h"
 #include "core_misc/log.h"
 #include "lvgl_helper.h"
 
@@ -230,6 +231,9 @@ void DisplayManager::dispFlushCallback(lv_display_t *disp, const lv_area_t *area
   tft->setAddrWindow(area->x1, area->y1, w, h);
   tft->pushPixels((uint16_t *)px_map, w * h);
   tft->endWrite();
+  if (lv_display_flush_is_last(disp)) {
+    InputLatency::instance().onFlush(); // the whole frame is in the panel's memory now
+  }
 
   lv_display_flush_ready(disp);
 }
@@ -1,7 +1,9 @@
 #include "lvgl_helper.h"
 #include "audio_manager.h" // can't use -I lib, should sort out later
+#include "core_eventing/event_recorder.h"
 #include "core_eventing/event_system.h"
 #include "core_eventing/events.h"
+#include "core_eventing/input_latency.h"
 #include "core_misc/log.h"
 #include "core_misc/utils.h"
 
@@ -9,6 +11,11 @@ namespace dict {
 
 static const char *TAG = "LVGLHelper";
 
+// Replay pace for F9: 1.0 is as typed, 0 as fast as the UI loop runs
+#ifndef DICT_REPLAY_SPEED
+#define DICT_REPLAY_SPEED 1.0f
+#endif
+
 lv_group_t *getDefaultGroup() {
   lv_group_t *default_group = lv_group_get_default();
   if (default_group == nullptr) {
@@ -36,14 +43,19 @@ void loadScreen(lv_obj_t *screen) {
 // --- Key handling from KeyEvent bus ---
 static SubmitCallback s_onSubmit = nullptr;
 static KeyInCallback s_onKeyIn = nullptr;
-static EventBus<KeyEvent>::ListenerId s_keyListenerId = 0;
+static EventBusFor<KeyEvent>::ListenerId s_keyListenerId = 0;
 static FunctionKeyCallback s_onFunctionKeyIn = nullptr;
-static EventBus<FunctionKeyEvent>::ListenerId s_functionKeyListenerId = 0;
+static EventBusFor<FunctionKeyEvent>::ListenerId s_functionKeyListenerId = 0;
 
 static void handleKeyEvent(const KeyEvent &ev) {
-  if (!ev.valid)
+  if (!ev.valid || !ev.pressed)
     return;
+  uint32_t dispatchUs = micros();
+  if (!ev.synthetic && ev.isText()) {
+    InputLatency::instance().record(InputLatency::Dispatch, dispatchUs - ev.publishedUs); // Publish's keys plus replayed ones
+  }
   char key = ev.key;
+  bool textChanged = false;
   lv_group_t *group = lv_group_get_default();
   lv_obj_t *focused = lv_group_get_focused(group);
   if (focused && lv_obj_has_class(focused, &lv_textarea_class)) {
@@ -51,6 +63,7 @@ static void handleKeyEvent(const KeyEvent &ev) {
       const char *text = lv_textarea_get_text(focused);
       if (text && strlen(text) > 0) {
         lv_textarea_delete_char(focused);
+        textChanged = true;
       }
     } else if (key == '\n') {
       lv_textarea_t *ta = (lv_textarea_t *)focused;
@@ -59,12 +72,18 @@ static void handleKeyEvent(const KeyEvent &ev) {
           s_onSubmit();
       } else {
         lv_textarea_add_char(focused, '\n');
+        textChanged = true;
       }
     } else if (key >= 32 && key <= 126) {
       lv_textarea_add_char(focused, key);
+      textChanged = true;
     }
   }
+  if (textChanged && !ev.synthetic) {
+    InputLatency::instance().onTextChanged(ev.reportUs, dispatchUs); // the next flush paints it
+  }
   if (key == 0x08 || (key >= 32 && key <= 126)) {
+    publishAudioCommand(AudioCommandEvent::uiSound((uint8_t)UiSound::KeyClick));
     if (s_onKeyIn)
       s_onKeyIn(key);
   }
@@ -76,23 +95,46 @@ static void handleFunctionKeyEvent(const FunctionKeyEvent &ev) {
     ESP_LOGI(TAG, "F1 pressed - printing memory status");
     printMemoryStatus(); // You'd need to implement this
     printAllStatus();
+    AudioManager::instance().printMetrics();
+    InputLatency::instance().print();
     break;
   case FunctionKeyEvent::VolumeDown:
     ESP_LOGI(TAG, "F10 pressed - volume down");
-    if (AudioManager::instance().isReady()) {
-      AudioManager::instance().setVolume(AudioManager::instance().getVolume() - 0.05);
-    }
+    publishAudioCommand(AudioCommandEvent::volumeStep(-0.05f));
     break;
   case FunctionKeyEvent::VolumeUp:
     ESP_LOGI(TAG, "F11 pressed - volume up");
-    if (AudioManager::instance().isReady()) {
-      AudioManager::instance().setVolume(AudioManager::instance().getVolume() + 0.05);
+    publishAudioCommand(AudioCommandEvent::volumeStep(0.05f));
+    break;
+  case FunctionKeyEvent::SpeedDown:
+    ESP_LOGI(TAG, "F6 pressed - speed down");
+    publishAudioCommand(AudioCommandEvent::speedStep(-0.125f));
+    break;
+  case FunctionKeyEvent::SpeedUp:
+    ESP_LOGI(TAG, "F7 pressed - speed up");
+    publishAudioCommand(AudioCommandEvent::speedStep(0.125f));
+    break;
+  case FunctionKeyEvent::ToggleRecording:
+    ESP_LOGI(TAG, "F8 pressed - toggle recording");
+    if (EventRecorder::instance().isRecording()) {
+      EventRecorder::instance().stopRecording();
+    } else {
+      EventRecorder::instance().startRecording();
+    }
+    break;
+  case FunctionKeyEvent::ToggleReplay:
+    ESP_LOGI(TAG, "F9 pressed - toggle replay");
+    if (EventRecorder::instance().isReplaying()) {
+      EventRecorder::instance().stopReplay();
+    } else {
+      EventRecorder::instance().startReplay(EventRecorder::DEFAULT_PATH, DICT_REPLAY_SPEED);
     }
     break;
   case FunctionKeyEvent::WifiSettings:
   case FunctionKeyEvent::ReadWord:
   case FunctionKeyEvent::ReadExplanation:
   case FunctionKeyEvent::ReadSampleSentence:
+  case FunctionKeyEvent::ReadAll:
   case FunctionKeyEvent::DownArrow:
   case FunctionKeyEvent::UpArrow:
   case FunctionKeyEvent::LeftArrow:
@@ -100,7 +142,7 @@ static void handleFunctionKeyEvent(const FunctionKeyEvent &ev) {
   case FunctionKeyEvent::Escape:
     ESP_LOGI(TAG, "Function key passed to callback");
     if (s_onFunctionKeyIn)
-      s_onFunctionKeyIn(ev.type);
+      s_onFunctionKeyIn(ev); // the whole event: coalesced arrows carry their repeat count
     break;
   default:
     break;
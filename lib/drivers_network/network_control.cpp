@@ -1,4 +1,7 @@
 #include "network_control.h"
+#include "core_eventing/connectivity_state.h"
+#include "core_settings/settings_store.h"
+#include "esp_sntp.h"
 #include "esp_system.h" // for esp_random
 #include "esp_wifi.h"
 #include "log.h"
@@ -10,6 +13,15 @@
 namespace dict {
 
 static const char *TAG = "WiFi";
+static const char *SETTINGS_NS = "wifi_config";
+static const time_t CLOCK_SET_AFTER = 1700000000; // earlier than this the clock was never set: HTTPS cannot verify certificates
+
+// SNTP task: the first sync after GOT_IP is what makes the link usable
+static void onTimeSynced(struct timeval *tv) {
+  if (ConnectivityState::instance().isAssociated()) {
+    ConnectivityState::instance().set(ConnectivityEvent::WiFi, true);
+  }
+}
 
 // point to the file specified in platformio.ini
 // certs/x509_crt_bundle
@@ -41,9 +53,6 @@ void NetworkControl::shutdown() {
   delay(50);
   WiFi.mode(WIFI_OFF);
 
-  // Close preferences namespace if open
-  preferences.end();
-
   // Reset internal state
   initialized_ = false;
   connecting_ = false;
@@ -51,6 +60,8 @@ void NetworkControl::shutdown() {
   connectEndTime_ = 0;
   wifiConnected = false;
   wasConnected = false;
+  ConnectivityState::instance().setAssociated(false);
+  ConnectivityState::instance().set(ConnectivityEvent::WiFi, false);
   pendingSsid_ = "";
   pendingPassword_ = "";
   currentSsid_ = "";
@@ -113,12 +124,7 @@ bool NetworkControl::begin() {
   }
   client.setCACertBundle(certs_x509_crt_bundle_start, certs_x509_crt_bundle_end - certs_x509_crt_bundle_start);
   WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) { this->onWiFiEvent(event, info); });
-  // Initialize preferences for NVS storage (close first if already open)
-  preferences.end();
-  if (!preferences.begin("wifi_config", false)) {
-    ESP_LOGE(TAG, "Failed to open preferences");
-    return false;
-  }
+  sntp_set_time_sync_notification_cb(onTimeSynced);
 
   initialized_ = true;
   return true;
@@ -221,28 +227,16 @@ bool NetworkControl::connectToNetwork(const String &ssid, const String &password
 }
 
 void NetworkControl::saveCredentials(const String &ssid, const String &password) {
-  preferences.end();
-  if (!preferences.begin("wifi_config", false)) {
-    ESP_LOGE(TAG, "Failed to open preferences for writing");
-    return;
-  }
-  preferences.putString("ssid", ssid);
-  preferences.putString("pwd", password);
-  preferences.end();
+  SettingsStore &settings = SettingsStore::instance();
+  settings.putString(SETTINGS_NS, "ssid", ssid);
+  settings.putString(SETTINGS_NS, "pwd", password);
+  settings.flush(); // rare, and needed after the next reboot: don't wait for the debounce
   ESP_LOGI(TAG, "Credentials saved for SSID: %s", ssid.c_str());
 }
 
 bool NetworkControl::loadCredentials(String &ssid, String &password) {
-  preferences.end();
-  if (!preferences.begin("wifi_config", true)) {
-    ESP_LOGE(TAG, "Failed to open preferences for reading");
-    ssid = "";
-    password = "";
-    return false;
-  }
-  ssid = preferences.getString("ssid", "");
-  password = preferences.getString("pwd", "");
-  preferences.end();
+  ssid = SettingsStore::instance().getString(SETTINGS_NS, "ssid");
+  password = SettingsStore::instance().getString(SETTINGS_NS, "pwd");
 
   if (ssid.length() > 0) {
     ESP_LOGI(TAG, "Loaded credentials for SSID: %s", ssid.c_str());
@@ -253,27 +247,14 @@ bool NetworkControl::loadCredentials(String &ssid, String &password) {
 }
 
 void NetworkControl::clearCredentials() {
-  preferences.end();
-  if (!preferences.begin("wifi_config", false)) {
-    ESP_LOGE(TAG, "Failed to open preferences for clearing");
-    return;
-  }
-  preferences.remove("ssid");
-  preferences.remove("pwd");
-  preferences.end();
+  SettingsStore &settings = SettingsStore::instance();
+  settings.remove(SETTINGS_NS, "ssid");
+  settings.remove(SETTINGS_NS, "pwd");
+  settings.flush();
   ESP_LOGI(TAG, "Credentials cleared");
 }
 
-bool NetworkControl::hasSavedCredentials() const {
-  // Open preferences in read-only mode without altering state
-  const_cast<Preferences &>(preferences).end();
-  if (!const_cast<Preferences &>(preferences).begin("wifi_config", true)) {
-    return false;
-  }
-  String ssid = const_cast<Preferences &>(preferences).getString("ssid", "");
-  const_cast<Preferences &>(preferences).end();
-  return ssid.length() > 0;
-}
+bool NetworkControl::hasSavedCredentials() const { return SettingsStore::instance().getString(SETTINGS_NS, "ssid").length() > 0; }
 
 bool NetworkControl::isConnected() { return WiFi.status() == WL_CONNECTED; }
 
@@ -307,17 +288,6 @@ void NetworkControl::tick() {
       wifiConnected = true;
       lastDisconnectionTime = 0;
 
-      // Set DNS for faster DNS resolution
-      WiFi.setDNS(IPAddress(8, 8, 8, 8), IPAddress(114, 114, 114, 114));
-
-      // Set time, HTTPS needs it
-      configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-      time_t now = 0;
-      while (now < 1700000000) { // wait until time is set
-        delay(200);
-        time(&now);
-      }
-
       // Persist pending credentials if present
       if (pendingSsid_.length() > 0) {
         saveCredentials(pendingSsid_, pendingPassword_);
@@ -340,6 +310,8 @@ void NetworkControl::onWiFiEvent(arduino_event_id_t event, arduino_event_info_t
   switch (event) {
   case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
     ESP_LOGW(TAG, "WiFi disconnected");
+    ConnectivityState::instance().setAssociated(false);
+    ConnectivityState::instance().set(ConnectivityEvent::WiFi, false);
     if (connecting_) {
       connecting_ = false;
       connectEndTime_ = millis();
@@ -360,6 +332,15 @@ void NetworkControl::onWiFiEvent(arduino_event_id_t event, arduino_event_info_t
     ESP_LOGI(TAG, "WiFi got IP address");
     connecting_ = false;
     connectEndTime_ = millis();
+    ConnectivityState::instance().setAssociated(true);
+    // Set DNS for faster DNS resolution
+    WiFi.setDNS(IPAddress(8, 8, 8, 8), IPAddress(114, 114, 114, 114));
+    // HTTPS needs the clock: the link is up once it is set. SNTP runs in the background and
+    // onTimeSynced() reports the first sync; after a reconnect the clock is still set.
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+    if (time(nullptr) >= CLOCK_SET_AFTER) {
+      ConnectivityState::instance().set(ConnectivityEvent::WiFi, true);
+    }
     break;
 
   default:
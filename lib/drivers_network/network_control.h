@@ -1,7 +1,6 @@
 #pragma once
 #include "common.h"
 #include <HTTPClient.h>
-#include <Preferences.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 
@@ -37,10 +36,10 @@ public:
   void setCACertBundle(WiFiClientSecure &client);
 
   // Credential management methods
-  void saveCredentials(const String &ssid, const String &password); // Save WiFi credentials to NVS
-  bool loadCredentials(String &ssid, String &password);             // Load saved credentials from NVS
-  void clearCredentials();                                          // Clear saved credentials from NVS
-  bool hasSavedCredentials() const;                                 // Check if valid credentials exist in NVS
+  void saveCredentials(const String &ssid, const String &password); // Save WiFi credentials (committed to NVS at once)
+  bool loadCredentials(String &ssid, String &password);             // Load saved credentials (cached after the first read)
+  void clearCredentials();                                          // Clear saved credentials (committed to NVS at once)
+  bool hasSavedCredentials() const;                                 // Check if valid credentials exist (no NVS access once cached)
   String getCurrentSsid() const { return currentSsid_; }
   String getCurrentPassword() const { return currentPassword_; }
 
@@ -69,7 +68,6 @@ private:
   NetworkControl(const NetworkControl &) = delete;
   NetworkControl &operator=(const NetworkControl &) = delete;
   
-  Preferences preferences;
   bool initialized_;
   bool connecting_;
   uint32_t connectStartTime_;
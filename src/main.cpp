@@ -1,12 +1,15 @@
 #include "audio_manager.h"
 #include "ble_keyboard.h"
+#include "connectivity_state.h"
 #include "dictionary_api.h"
 #include "display_manager.h"
+#include "event_recorder.h"
 #include "key_processor.h"
 #include "lvgl_helper.h"
 #include "lvgl_memory.h"
 #include "network_control.h"
 #include "screens/main_screen.h"
+#include "settings_store.h"
 #include "test_wifi_credentials.h"
 #include "ui.h"
 #include "ui_status.h"
@@ -16,14 +19,64 @@
 
 using namespace dict;
 
-// Test state tracking
-bool g_bleConnected = false;
-bool g_wifiConnected = false;
-bool g_audioReady = false;
+// Audio state arrives from the audio task through the event system
+static void onAudioState(const AudioStateEvent &event) {
+  if (!StatusOverlay::instance().isReady()) {
+    return;
+  }
+  if (event.state == AudioStateEvent::Connecting || event.state == AudioStateEvent::Playing) {
+    StatusOverlay::instance().updateAudioStatus(AudioState::Working, event.codec);
+  } else {
+    StatusOverlay::instance().updateAudioStatus(AudioState::Ready);
+  }
+}
 
 // #define BOOT_MEMORY_ANALYSIS(msg) ESP_LOGI("MemoryTest", msg); printMemoryStatus();
 #define BOOT_MEMORY_ANALYSIS(msg) ;
 
+// Link transitions, published by the drivers from their connection callbacks
+static void onConnectivity(const ConnectivityEvent &event) {
+  if (!StatusOverlay::instance().isReady()) {
+    return;
+  }
+  switch (event.link) {
+  case ConnectivityEvent::Keyboard:
+    if (event.up) {
+      StatusOverlay::instance().updateBLEStatus(true, "BLE Keyboard");
+      ESP_LOGI("INTEGRATED_TEST", "BLE keyboard connected!");
+      BOOT_MEMORY_ANALYSIS("After ble keyboard connected...");
+    } else {
+      StatusOverlay::instance().updateBLEStatus(false);
+      ESP_LOGI("INTEGRATED_TEST", "BLE keyboard disconnected");
+    }
+    break;
+  case ConnectivityEvent::WiFi:
+    if (event.up) {
+      String ssid = WiFi.SSID();
+      StatusOverlay::instance().updateWiFiStatus(WiFiState::Ready, ssid);
+      ESP_LOGI("INTEGRATED_TEST", "WiFi connected to: %s", ssid.c_str());
+      MainScreen::instance().onConnectionReady();
+      BOOT_MEMORY_ANALYSIS("After wifi connected...");
+    } else {
+      StatusOverlay::instance().updateWiFiStatus(WiFiState::None);
+      ESP_LOGI("INTEGRATED_TEST", "WiFi disconnected");
+    }
+    break;
+  case ConnectivityEvent::Audio:
+    if (event.up) {
+      StatusOverlay::instance().updateAudioStatus(AudioState::Ready);
+      ESP_LOGI("INTEGRATED_TEST", "Audio system ready");
+      BOOT_MEMORY_ANALYSIS("After audio system ready...");
+    } else {
+      StatusOverlay::instance().updateAudioStatus(AudioState::None);
+      ESP_LOGI("INTEGRATED_TEST", "Audio system not ready");
+    }
+    break;
+  default:
+    break;
+  }
+}
+
 void setup() {
   Serial.begin(115200);
   delay(2000); // Give time for serial to initialize
@@ -32,6 +85,9 @@ void setup() {
 
   ESP_LOGI("INTEGRATED_TEST", "Starting integrated test setup...");
 
+  // Settings first: the drivers below read their saved state from it
+  TEST_ASSERT_TRUE_MESSAGE(SettingsStore::instance().initialize(), "Settings store initialize failed");
+
   // Initialize display manager
   TEST_ASSERT_TRUE_MESSAGE(DisplayManager::instance().initialize(), "Display manager initialize failed");
   TEST_ASSERT_TRUE(DisplayManager::instance().isReady());
@@ -68,6 +124,7 @@ void setup() {
   StatusOverlay::instance().updateBLEStatus(false);
   StatusOverlay::instance().updateAudioStatus(AudioState::None);
   ESP_LOGI("INTEGRATED_TEST", "Status icons hidden initially");
+  EventSystem::instance().getEventBus<ConnectivityEvent>().subscribe(onConnectivity); // shows them as the links come up
 
   // Initialize BLE keyboard
   TEST_ASSERT_TRUE_MESSAGE(BLEKeyboard::instance().initialize(), "BLE keyboard initialize failed");
@@ -83,7 +140,9 @@ void setup() {
 
   // Initialize audio manager
   TEST_ASSERT_TRUE_MESSAGE(AudioManager::instance().initialize(), "Audio manager initialize failed");
-  ESP_LOGI("INTEGRATED_TEST", "Audio manager initialized");
+  EventSystem::instance().getEventBus<AudioStateEvent>().subscribe(onAudioState);
+  TEST_ASSERT_TRUE_MESSAGE(AudioManager::instance().startTask(), "Audio task start failed");
+  ESP_LOGI("INTEGRATED_TEST", "Audio manager initialized, audio task running");
   BOOT_MEMORY_ANALYSIS("After audio manager...");
 
   ESP_LOGI("INTEGRATED_TEST", "Setup completed successfully!");
@@ -98,52 +157,18 @@ void loop() {
   // Process BLE keyboard
   if (BLEKeyboard::instance().isReady()) {
     BLEKeyboard::instance().tick();
-
-    // Check BLE connection status and update UI
-    bool bleConnected = BLEKeyboard::instance().isConnected();
-    if (bleConnected != g_bleConnected) {
-      g_bleConnected = bleConnected;
-      if (StatusOverlay::instance().isReady()) {
-        if (bleConnected) {
-          StatusOverlay::instance().updateBLEStatus(true, "BLE Keyboard");
-          ESP_LOGI("INTEGRATED_TEST", "BLE keyboard connected!");
-          BOOT_MEMORY_ANALYSIS("After ble keyboard connected...");
-        } else {
-          StatusOverlay::instance().updateBLEStatus(false);
-          ESP_LOGI("INTEGRATED_TEST", "BLE keyboard disconnected");
-        }
-      }
-    }
-    if (!bleConnected && !BLEKeyboard::instance().isScanning() && millis() - BLEKeyboard::instance().getScanEndTime() > 1000) {
-      ESP_LOGI("INTEGRATED_TEST", "When not connected and scan ended more than 1 second ago, start scan again");
-      BLEKeyboard::instance().startScan();
-    }
   }
 
-  // Process all events in the event system
+  // Publish replayed input that is due (F9), then process all events in the event system
+  EventRecorder::instance().tick();
   EventSystem::instance().processAllEvents();
 
   // Process network control
   if (NetworkControl::instance().isReady()) {
     NetworkControl::instance().tick();
 
-    // Check WiFi connection status and update UI
-    bool wifiConnected = NetworkControl::instance().isConnected();
-    if (wifiConnected != g_wifiConnected) {
-      g_wifiConnected = wifiConnected;
-      if (StatusOverlay::instance().isReady()) {
-        if (wifiConnected) {
-          String ssid = WiFi.SSID();
-          StatusOverlay::instance().updateWiFiStatus(WiFiState::Ready, ssid);
-          ESP_LOGI("INTEGRATED_TEST", "WiFi connected to: %s", ssid.c_str());
-          MainScreen::instance().onConnectionReady();
-          BOOT_MEMORY_ANALYSIS("After wifi connected...");
-        } else {
-          StatusOverlay::instance().updateWiFiStatus(WiFiState::None);
-          ESP_LOGI("INTEGRATED_TEST", "WiFi disconnected");
-        }
-      }
-    }
+    // From the WiFi event callbacks, not polled; associated but not up yet is a clock sync in progress, not a reason to reconnect
+    bool wifiConnected = ConnectivityState::instance().isUp(ConnectivityEvent::WiFi) || ConnectivityState::instance().isAssociated();
     if (!wifiConnected && !NetworkControl::instance().isConnecting() && millis() - NetworkControl::instance().getConnectEndTime() > 10000) {
       if (!NetworkControl::instance().isOnSettingScreen()) {
         ESP_LOGI("INTEGRATED_TEST", "When not connected and connect ended more than 10 seconds ago, start connect again");
@@ -160,31 +185,15 @@ void loop() {
     }
   }
 
-  // Process audio manager
-  if (AudioManager::instance().isReady()) {
-    AudioManager::instance().tick();
-
-    // Check audio readiness and update UI
-    bool audioReady = AudioManager::instance().isReady();
-    if (audioReady != g_audioReady) {
-      g_audioReady = audioReady;
-      if (StatusOverlay::instance().isReady()) {
-        if (audioReady) {
-          StatusOverlay::instance().updateAudioStatus(AudioState::Ready);
-          ESP_LOGI("INTEGRATED_TEST", "Audio system ready");
-          BOOT_MEMORY_ANALYSIS("After audio system ready...");
-        } else {
-          StatusOverlay::instance().updateAudioStatus(AudioState::None);
-          ESP_LOGI("INTEGRATED_TEST", "Audio system not ready");
-        }
-      }
-    }
-  }
+  // Audio is ticked by its own task; link status arrives as ConnectivityEvents
 
   // Process main screen
   if (MainScreen::instance().isReady()) {
     MainScreen::instance().tick();
   }
 
+  // Commit settings that have stopped changing
+  SettingsStore::instance().tick();
+
   delay(10); // Small delay to prevent overwhelming the system
 }
@@ -1,7 +1,8 @@
 #include "main_screen.h"
+#include "ble_keyboard.h"
+#include "core_eventing/connectivity_state.h"
 #include "drivers_audio/audio_manager.h"
 #include "drivers_display/lvgl_helper.h"
-#include "network_control.h"
 #include "ui_status/ui_status.h"
 
 namespace dict {
@@ -42,12 +43,7 @@ void MainScreen::shutdown() {
 }
 
 void MainScreen::tick() {
-  if (!initialized_) {
-    return;
-  }
-  if (isWifiSettings_) {
-    WiFiSettingsScreen::instance().tick();
-  }
+  // Nothing to poll: WiFi scan progress arrives as WifiScanEvents through EventSystem
 }
 
 bool MainScreen::isReady() const { return initialized_; }
@@ -125,6 +121,7 @@ void MainScreen::onSubmit() {
   if (currentWord_.isEmpty() || currentWord_.length() == 0) {
     lv_label_set_text(ui_TxtExplanation, "Please enter a word to start.");
     lv_obj_add_flag(ui_Line, LV_OBJ_FLAG_HIDDEN);
+    publishAudioCommand(AudioCommandEvent::uiSound((uint8_t)UiSound::Error));
     return;
   }
 
@@ -134,11 +131,15 @@ void MainScreen::onSubmit() {
   lv_obj_add_flag(ui_InputWord, LV_OBJ_FLAG_HIDDEN);
   lv_obj_remove_flag(ui_TxtWord, LV_OBJ_FLAG_HIDDEN);
   StatusOverlay::instance().updateWiFiStatus(WiFiState::Working);
+  BLEKeyboard::instance().setRadioBusy(ConnParamsManager::Lookup, true); // lengthen the BLE interval while WiFi fetches
   currentResult_ = dictionaryApi_.lookupWord(currentWord_);
-  StatusOverlay::instance().updateWiFiStatus(NetworkControl::instance().isConnected() ? WiFiState::Ready : WiFiState::None);
+  BLEKeyboard::instance().setRadioBusy(ConnParamsManager::Lookup, false);
+  bool wifiUp = ConnectivityState::instance().isUp(ConnectivityEvent::WiFi);
+  StatusOverlay::instance().updateWiFiStatus(wifiUp ? WiFiState::Ready : WiFiState::None);
   onJumpToTop();
   if (currentResult_.success) {
-    AudioManager::instance().stop();
+    publishAudioCommand(AudioCommandEvent(AudioCommandEvent::Stop));
+    publishAudioCommand(AudioCommandEvent::uiSound((uint8_t)UiSound::LookupDone));
     currentWord_ = currentResult_.word;
     lv_obj_remove_flag(ui_Line, LV_OBJ_FLAG_HIDDEN);
     lv_label_set_text(ui_TxtWord, currentResult_.word.c_str());
@@ -146,6 +147,7 @@ void MainScreen::onSubmit() {
     lv_label_set_text(ui_TxtSampleSentence, currentResult_.sampleSentence.c_str());
   } else {
     lv_label_set_text(ui_TxtExplanation, "Request failed. Please try again.");
+    publishAudioCommand(AudioCommandEvent::uiSound((uint8_t)UiSound::Error));
     lv_obj_add_flag(ui_Line, LV_OBJ_FLAG_HIDDEN);
     lv_obj_remove_flag(ui_InputWord, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(ui_TxtWord, LV_OBJ_FLAG_HIDDEN);
@@ -181,14 +183,17 @@ void MainScreen::onFunctionKeyEvent(const FunctionKeyEvent &event) {
   case FunctionKeyEvent::ReadSampleSentence:
     onPlayAudio("sample");
     break;
+  case FunctionKeyEvent::ReadAll:
+    onReadAll();
+    break;
   case FunctionKeyEvent::WifiSettings:
     onWifiSettings();
     break;
   case FunctionKeyEvent::DownArrow:
-    onDownArrow();
+    onDownArrow(event.repeat);
     break;
   case FunctionKeyEvent::UpArrow:
-    onUpArrow();
+    onUpArrow(event.repeat);
     break;
   case FunctionKeyEvent::Escape:
     onEscape();
@@ -207,9 +212,28 @@ void MainScreen::onPlayAudio(const String &audioType) {
   }
   AudioUrl audioUrl = dictionaryApi_.getAudioUrl(currentWord_, audioType);
   ESP_LOGI(TAG, "Playing audio: %s", audioUrl.url.c_str());
-  if (AudioManager::instance().isReady()) {
-    AudioManager::instance().play(audioUrl.url.c_str());
+  publishAudioCommand(AudioCommandEvent::play(audioUrl.url));
+}
+
+void MainScreen::onReadAll() {
+  if (!isScreenActive_) {
+    return;
+  }
+  if (currentWord_.length() == 0 || !AudioManager::instance().isReady()) {
+    return;
+  }
+  // Queue word -> explanation -> sample so they play back to back
+  static const char *kAudioTypes[] = {"word", "explanation", "sample"};
+  publishAudioCommand(AudioCommandEvent(AudioCommandEvent::Stop));
+  int queued = 0;
+  for (const char *audioType : kAudioTypes) {
+    AudioUrl audioUrl = dictionaryApi_.getAudioUrl(currentWord_, audioType);
+    if (audioUrl.valid) {
+      publishAudioCommand(AudioCommandEvent::enqueue(audioUrl.url));
+      queued++;
+    }
   }
+  ESP_LOGI(TAG, "Reading all: %d clips sent to the audio task", queued);
 }
 
 void MainScreen::onConnectionReady() {
@@ -241,16 +265,16 @@ void MainScreen::onBackFromWifiSettings() {
   }
 }
 
-void MainScreen::onDownArrow() {
+void MainScreen::onDownArrow(uint8_t steps) {
   if (ui_Result == nullptr)
     return;
 
   // Check if there's content below to scroll to
   int32_t scroll_bottom = lv_obj_get_scroll_bottom(ui_Result);
   if (scroll_bottom > 0) {
-    // Scroll down by a fixed amount (e.g., 50 pixels)
+    // Scroll down by a fixed amount (e.g., 50 pixels) per step
     int32_t current_y = lv_obj_get_scroll_y(ui_Result);
-    int32_t new_y = current_y + 50;
+    int32_t new_y = current_y + 50 * steps;
 
     // Don't scroll beyond the bottom
     int32_t max_scroll = lv_obj_get_scroll_top(ui_Result) + lv_obj_get_scroll_bottom(ui_Result);
@@ -264,16 +288,16 @@ void MainScreen::onDownArrow() {
   }
 }
 
-void MainScreen::onUpArrow() {
+void MainScreen::onUpArrow(uint8_t steps) {
   if (ui_Result == nullptr)
     return;
 
   // Check if there's content above to scroll to
   int32_t scroll_top = lv_obj_get_scroll_top(ui_Result);
   if (scroll_top > 0) {
-    // Scroll up by a fixed amount (e.g., 50 pixels)
+    // Scroll up by a fixed amount (e.g., 50 pixels) per step
     int32_t current_y = lv_obj_get_scroll_y(ui_Result);
-    int32_t new_y = current_y - 50;
+    int32_t new_y = current_y - 50 * steps;
 
     // Don't scroll beyond the top
     if (new_y < 0)
@@ -29,8 +29,9 @@ public:
   void onWifiSettings();
   void onBackFromWifiSettings();
   void onPlayAudio(const String &audioType);
-  void onDownArrow();
-  void onUpArrow();
+  void onReadAll();
+  void onDownArrow(uint8_t steps = 1); // steps: key repeats merged into one event
+  void onUpArrow(uint8_t steps = 1);
   void onEscape();
   void onJumpToTop();
 
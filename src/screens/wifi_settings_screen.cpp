@@ -12,19 +12,15 @@ WiFiSettingsScreen &WiFiSettingsScreen::instance() {
   return instance;
 }
 
-WiFiSettingsScreen::WiFiSettingsScreen() : initialized_(false), parent_(nullptr) {}
+WiFiSettingsScreen::WiFiSettingsScreen() : initialized_(false), parent_(nullptr), scanning_(false), scanTaskRunning_(false), scanStopRequested_(false) {}
 
 void WiFiSettingsScreen::initialize(MainScreen *parent) {
   parent_ = parent;
   NetworkControl::instance().setIsOnSettingScreen(true);
   scanning_ = false;
-  scanTaskHandle_ = nullptr;
-  setOptions_ = false;
-  options_ = "";
-  setTxtStatus_ = false;
-  txtStatus_ = "";
-  setOptions_ = false;
-  options_ = "";
+  auto &scanEvents = EventSystem::instance().getEventBus<WifiScanEvent>();
+  EventSystem::instance().registerEventBus<WifiScanEvent>();
+  scanSubscription_ = scanEvents.subscribeScoped([this](const WifiScanEvent &event) { onScanEvent(event); });
   ui_WIFI_Settings_screen_init();
   lv_disp_load_scr(uiObject());
   lv_group_focus_obj(ui_InputPassword);
@@ -37,14 +33,11 @@ void WiFiSettingsScreen::initialize(MainScreen *parent) {
 
 void WiFiSettingsScreen::shutdown() {
   parent_ = nullptr;
-  if (scanning_) {
-    scanning_ = false;
-    if (scanTaskHandle_ != nullptr) {
-      vTaskDelete(scanTaskHandle_);
-      NetworkControl::instance().setScanning(false); // when force shutdown, set scanning flag to false
-      scanTaskHandle_ = nullptr;
-    }
-  }
+  // Never delete the scan task from here: it may be holding the scan bus mutex or be inside
+  // WiFi.scanNetworks(). Ask it to stop and don't wait; it finishes the scan on its own and exits.
+  scanStopRequested_ = true;
+  scanning_ = false;
+  scanSubscription_.reset();
   ui_WIFI_Settings_screen_destroy();
   NetworkControl::instance().setIsOnSettingScreen(false);
   initialized_ = false;
@@ -52,18 +45,29 @@ void WiFiSettingsScreen::shutdown() {
 
 void WiFiSettingsScreen::scanTask(void *parameter) {
   WiFiSettingsScreen *screen = static_cast<WiFiSettingsScreen *>(parameter);
+  auto &scanEvents = EventSystem::instance().getEventBus<WifiScanEvent>();
 
   ESP_LOGI(TAG, "Scan task started");
-  screen->txtStatus_ = "Preparing to scan...";
-  screen->setTxtStatus_ = true;
-  while (NetworkControl::instance().isConnecting() || NetworkControl::instance().isScanning()) { // wait until connecting or scanning is finished
+  scanEvents.publish(WifiScanEvent{WifiScanEvent::Status, "Preparing to scan..."});
+  while (!screen->scanStopRequested_ &&
+         (NetworkControl::instance().isConnecting() || NetworkControl::instance().isScanning())) { // wait until connecting or scanning is finished
     ESP_LOGI(TAG, "Waiting for connecting or scanning to finish. connecting: %d, scanning: %d", NetworkControl::instance().isConnecting(), NetworkControl::instance().isScanning());
     delay(500);
   }
-  screen->txtStatus_ = "Scanning WiFi for 5 seconds...";
-  screen->setTxtStatus_ = true;
+  if (screen->scanStopRequested_) {
+    screen->scanTaskRunning_ = false;
+    vTaskDelete(nullptr);
+    return;
+  }
+  scanEvents.publish(WifiScanEvent{WifiScanEvent::Status, "Scanning WiFi for 5 seconds..."});
   // Perform the actual scan
   auto ssids = NetworkControl::instance().scanNetworks();
+  if (screen->scanStopRequested_) {
+    ESP_LOGI(TAG, "Scan task stopped, screen closed");
+    screen->scanTaskRunning_ = false;
+    vTaskDelete(nullptr);
+    return;
+  }
 
   ESP_LOGI(TAG, "Scan task completed, found %d networks", ssids.size());
 
@@ -76,14 +80,12 @@ void WiFiSettingsScreen::scanTask(void *parameter) {
     options += ssid + "\n";
   }
   options.trim();
-  screen->txtStatus_ = "";
-  screen->setTxtStatus_ = true;
-  screen->options_ = options;
-  screen->setOptions_ = true;
+  scanEvents.publish(WifiScanEvent{WifiScanEvent::Status, ""});
+  scanEvents.publish(WifiScanEvent{WifiScanEvent::Results, options});
 
   // Clean up
   screen->scanning_ = false;
-  screen->scanTaskHandle_ = nullptr;
+  screen->scanTaskRunning_ = false;
 
   ESP_LOGI(TAG, "Scan task finished");
   vTaskDelete(nullptr); // Delete self
@@ -98,7 +100,14 @@ void WiFiSettingsScreen::scan() {
     ESP_LOGW(TAG, "WiFi settings UI not initialized, cannot scan");
     return;
   }
+  if (scanTaskRunning_) {
+    // A scan from before the screen was last closed is still finishing
+    ESP_LOGW(TAG, "Previous scan still finishing, try again shortly");
+    lv_label_set_text(ui_TxtStatus, "Scanning, try again shortly");
+    return;
+  }
   scanning_ = true;
+  scanStopRequested_ = false;
   if (NetworkControl::instance().isConnected()) {
     lv_label_set_text(ui_TxtStatus, "Scanning WiFi for 5 seconds...");
     String options = NetworkControl::instance().getCurrentSsid();
@@ -114,18 +123,20 @@ void WiFiSettingsScreen::scan() {
     lv_label_set_text(ui_TxtStatus, "Scanning WiFi for 5 seconds...");
   }
 
-  // Create task for scanning
-  BaseType_t result = xTaskCreate(scanTask,        // Task function
-                                  "wifi_scan",     // Task name
-                                  4096,            // Stack size
-                                  this,            // Parameter
-                                  1,               // Priority
-                                  &scanTaskHandle_ // Task handle
+  // Create task for scanning; marked running first, it may be done before xTaskCreate returns
+  scanTaskRunning_ = true;
+  BaseType_t result = xTaskCreate(scanTask,    // Task function
+                                  "wifi_scan", // Task name
+                                  4096,        // Stack size
+                                  this,        // Parameter
+                                  1,           // Priority
+                                  nullptr      // Task handle
   );
 
   if (result != pdPASS) {
     ESP_LOGE(TAG, "Failed to create scan task");
     scanning_ = false;
+    scanTaskRunning_ = false;
     lv_dropdown_set_options(ui_InputSSIDs, "Scan Failed");
   }
 }
@@ -145,15 +156,15 @@ void WiFiSettingsScreen::onSubmit() {
   parent_->onBackFromWifiSettings();
 }
 
-void WiFiSettingsScreen::tick() {
-  if (setTxtStatus_) {
-    lv_label_set_text(ui_TxtStatus, txtStatus_.c_str());
-    setTxtStatus_ = false;
-  }
-  if (setOptions_) {
-    lv_dropdown_set_options(ui_InputSSIDs, options_.c_str());
+void WiFiSettingsScreen::onScanEvent(const WifiScanEvent &event) {
+  switch (event.type) {
+  case WifiScanEvent::Status:
+    lv_label_set_text(ui_TxtStatus, event.text.c_str());
+    break;
+  case WifiScanEvent::Results:
+    lv_dropdown_set_options(ui_InputSSIDs, event.text.c_str());
     lv_obj_set_style_bg_color(ui_InputSSIDs, lv_color_hex(0xFFFFFF), LV_PART_MAIN | LV_STATE_DEFAULT);
-    setOptions_ = false;
+    break;
   }
 }
 
@@ -2,6 +2,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <Arduino.h>
+#include "event_system.h"
 #include "ui.h"
 
 namespace dict {
@@ -15,7 +16,6 @@ public:
   // Core lifecycle methods
   void initialize(MainScreen *parent);
   void shutdown();
-  void tick();
   bool isReady() const { return initialized_; }
 
   void scan();
@@ -33,12 +33,11 @@ private:
   bool initialized_;
   MainScreen *parent_;
   static void scanTask(void *parameter);
+  void onScanEvent(const WifiScanEvent &event); // Apply scan progress on the UI loop
   bool scanning_;
-  TaskHandle_t scanTaskHandle_;
-  bool setTxtStatus_;
-  String txtStatus_;
-  bool setOptions_;
-  String options_;
+  volatile bool scanTaskRunning_;   // Set before the scan task is created, cleared by the task as it exits
+  volatile bool scanStopRequested_; // Set by shutdown(); the scan task publishes nothing more and exits
+  Subscription<EventBusFor<WifiScanEvent>> scanSubscription_;
 };
 
 } // namespace dict
\ No newline at end of file
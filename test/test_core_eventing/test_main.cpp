@@ -3,7 +3,14 @@
 // Use the core_eventing library headers (with namespace dict)
 #include "event_system.h"
 #include "events.h"
+#include "input_latency.h"
+#include "connectivity_state.h"
 #include "event_publisher.h"
+#include "listener_registry.h"
+#include "ring_event_bus.h"
+#include "task_event_bus.h"
+#include <functional>
+#include <vector>
 
 using namespace dict;
 
@@ -22,6 +29,37 @@ void test_eventsystem_singleton_and_bus_instance(void);
 void test_eventsystem_process_all_events_multiple_types(void);
 // Publisher routing: generic publish<T>() and registerEventBus<T>() deliver custom event.
 void test_eventpublisher_routing(void);
+// Ring bus overflow: DropOldest keeps the newest Capacity events, DropNewest the first ones; both count drops.
+void test_ringbus_overflow_policies(void);
+// Ring bus producers: two tasks publishing with Block lose nothing and keep per-producer order.
+void test_ringbus_multi_producer_block(void);
+// Ring bus drain bound: events published by a listener are delivered on the next processEvents().
+void test_ringbus_queue_isolation(void);
+// Listener handles: first handle is 0, a stale handle never removes the listener that reused its slot.
+void test_listener_generation_handles(void);
+// Scoped subscription: the listener is removed when the Subscription goes out of scope; a rejected one is never active.
+void test_listener_scoped_subscription(void);
+// Self-removal: a listener unsubscribing itself during dispatch is not called again.
+void test_listener_remove_during_dispatch(void);
+// Microbenchmark vs std::function listeners (the previous EventBus): no heap use on subscribe;
+// dispatch time for the same listeners, fresh and after subscribe/unsubscribe churn, is logged only.
+void test_listener_registry_benchmark(void);
+// LatestWins: a burst of AudioStateEvents is delivered as the newest one only.
+void test_coalescing_latest_wins(void);
+// Merge: runs of the same arrow key become one event with a repeat count; other keys are not merged.
+void test_coalescing_merge_arrows(void);
+// Priority lanes: registered buses are drained High, Normal, Low regardless of registration order.
+void test_eventsystem_priority_order(void);
+// Budget: processEventsUntil() stops at the deadline, leaves the rest queued in order.
+void test_eventbus_deadline_budget(void);
+// Task consumers: listeners run on the attached task, which sleeps until notified and wakes promptly.
+void test_taskbus_delivers_on_consumer_task(void);
+// Task consumers: each consumer (one per core) gets its own copy; a task that is not attached gets nothing.
+void test_taskbus_per_consumer_queues(void);
+// Input latency: samples land in the right buckets; a flush is attributed to the oldest unpainted key, once.
+void test_input_latency_histogram_and_flush(void);
+// Connectivity: set() publishes once per real transition, per link; isUp() reflects the latest state.
+void test_connectivity_state_transitions(void);
 
 
 using namespace dict;
@@ -137,6 +175,410 @@ void test_eventpublisher_routing(void) {
     TEST_ASSERT_EQUAL(123, received);
 }
 
+struct RingEvent {
+    int producer;
+    int seq;
+};
+
+void test_ringbus_overflow_policies(void) {
+    RingEventBus<RingEvent, 8, OverflowPolicy::DropOldest> oldest;
+    RingEventBus<RingEvent, 8, OverflowPolicy::DropNewest> newest;
+    for (int i = 0; i < 12; i++) {
+        oldest.publish(RingEvent{0, i});
+        newest.publish(RingEvent{0, i});
+    }
+    TEST_ASSERT_EQUAL(8, oldest.size());
+    TEST_ASSERT_EQUAL_UINT32(4, oldest.dropped());
+    TEST_ASSERT_EQUAL_UINT32(4, newest.dropped());
+
+    int seen[8];
+    int count = 0;
+    oldest.subscribe([&](const RingEvent &e){ seen[count++] = e.seq; });
+    oldest.processEvents();
+    TEST_ASSERT_EQUAL(8, count);
+    TEST_ASSERT_EQUAL(4, seen[0]);
+    TEST_ASSERT_EQUAL(11, seen[7]);
+
+    count = 0;
+    newest.subscribe([&](const RingEvent &e){ seen[count++] = e.seq; });
+    newest.processEvents();
+    TEST_ASSERT_EQUAL(8, count);
+    TEST_ASSERT_EQUAL(0, seen[0]);
+    TEST_ASSERT_EQUAL(7, seen[7]);
+}
+
+static RingEventBus<RingEvent, 16, OverflowPolicy::Block> s_blockingBus;
+static const int PRODUCER_EVENTS = 2000;
+
+static void ringProducerTask(void *param) {
+    int producer = (int)(intptr_t)param;
+    for (int i = 0; i < PRODUCER_EVENTS; i++) {
+        s_blockingBus.publish(RingEvent{producer, i});
+    }
+    vTaskDelete(nullptr);
+}
+
+void test_ringbus_multi_producer_block(void) {
+    int last[2] = {-1, -1};
+    int total = 0;
+    bool ordered = true;
+    s_blockingBus.clear();
+    // Scoped: the listener captures this frame and must not outlive the test on the static bus
+    auto subscription = s_blockingBus.subscribeScoped([&](const RingEvent &e){
+        ordered = ordered && e.seq == last[e.producer] + 1;
+        last[e.producer] = e.seq;
+        total++;
+    });
+    xTaskCreatePinnedToCore(ringProducerTask, "ring_p0", 2048, (void *)0, 1, nullptr, 0);
+    xTaskCreatePinnedToCore(ringProducerTask, "ring_p1", 2048, (void *)1, 1, nullptr, 1);
+    uint32_t start = millis();
+    while (total < 2 * PRODUCER_EVENTS && millis() - start < 5000) {
+        s_blockingBus.processEvents();
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL(2 * PRODUCER_EVENTS, total);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(0, s_blockingBus.dropped());
+}
+
+void test_ringbus_queue_isolation(void) {
+    RingEventBus<RingEvent, 8> bus;
+    int count = 0;
+    bus.subscribe([&](const RingEvent &e){
+        count++;
+        if (e.seq == 1) {
+            bus.publish(RingEvent{0, 2});
+        }
+    });
+    bus.publish(RingEvent{0, 1});
+    bus.processEvents();
+    TEST_ASSERT_EQUAL(1, count);
+    bus.processEvents();
+    TEST_ASSERT_EQUAL(2, count);
+}
+
+void test_listener_generation_handles(void) {
+    EventBus<int> bus;
+    int first = 0, second = 0;
+    auto id = bus.subscribe([&](const int &v){ first += v; });
+    TEST_ASSERT_EQUAL(0, id);
+    bus.unsubscribe(id);
+    auto reused = bus.subscribe([&](const int &v){ second += v; });
+    TEST_ASSERT_NOT_EQUAL(id, reused);
+    bus.unsubscribe(id); // stale: must not remove the new listener
+    bus.publish(3);
+    bus.processEvents();
+    TEST_ASSERT_EQUAL(0, first);
+    TEST_ASSERT_EQUAL(3, second);
+}
+
+void test_listener_scoped_subscription(void) {
+    EventBus<int> bus;
+    int count = 0;
+    {
+        auto subscription = bus.subscribeScoped([&](const int &){ count++; });
+        TEST_ASSERT_TRUE(subscription.isActive());
+        bus.publish(1);
+        bus.processEvents();
+    }
+    bus.publish(1);
+    bus.processEvents();
+    TEST_ASSERT_EQUAL(1, count);
+
+    // Full bus: subscribe returns INVALID_ID and the Subscription stays inactive
+    EventBus<int, 1> small;
+    auto first = small.subscribeScoped([&](const int &){ count++; });
+    auto rejected = small.subscribeScoped([&](const int &){ count++; });
+    TEST_ASSERT_TRUE(first.isActive());
+    TEST_ASSERT_FALSE(rejected.isActive());
+    TEST_ASSERT_FALSE(Subscription<EventBus<int>>().isActive());
+}
+
+void test_listener_remove_during_dispatch(void) {
+    EventBus<int> bus;
+    EventBus<int>::ListenerId self = 0;
+    int selfCount = 0, otherCount = 0;
+    self = bus.subscribe([&](const int &){
+        selfCount++;
+        bus.unsubscribe(self);
+    });
+    bus.subscribe([&](const int &){ otherCount++; });
+    bus.publish(1);
+    bus.publish(2);
+    bus.processEvents();
+    TEST_ASSERT_EQUAL(1, selfCount);
+    TEST_ASSERT_EQUAL(2, otherCount);
+}
+
+void test_listener_registry_benchmark(void) {
+    const int rounds = 20000;
+    volatile int sink = 0;
+    auto listener = [&](const int &v){ sink = sink + v; };
+
+    // Previous EventBus listener storage: growable vector of std::function, unsubscribe nulls the slot
+    std::vector<std::function<void(const int &)>> legacy;
+    ListenerRegistry<int> registry;
+
+    size_t heapBefore = esp_get_free_heap_size();
+    for (int i = 0; i < 4; i++) {
+        registry.add(listener);
+    }
+    TEST_ASSERT_EQUAL_UINT32(heapBefore, esp_get_free_heap_size());
+    for (int i = 0; i < 4; i++) {
+        legacy.push_back(listener);
+    }
+
+    // Both sides get the same listeners and the same operations; timings are reported, not asserted
+    auto timeBoth = [&](const char *label) {
+        uint32_t start = micros();
+        for (int n = 0; n < rounds; n++) {
+            for (const auto &l : legacy) {
+                if (l) {
+                    l(n);
+                }
+            }
+        }
+        uint32_t legacyUs = micros() - start;
+        start = micros();
+        for (int n = 0; n < rounds; n++) {
+            registry.dispatch(n);
+        }
+        uint32_t registryUs = micros() - start;
+        ESP_LOGI("test_core_eventing", "%s, 4 listeners x %d events: std::function %u us (%u slots), registry %u us (%u slots)", label, rounds,
+                 legacyUs, (unsigned)legacy.size(), registryUs, (unsigned)registry.size());
+    };
+    timeBoth("fresh");
+
+    // A screen that subscribes and unsubscribes 100 times
+    for (int i = 0; i < 100; i++) {
+        legacy.push_back(listener);
+        legacy.back() = nullptr;
+        registry.remove(registry.add(listener));
+    }
+    timeBoth("after 100 subscribe/unsubscribe");
+    TEST_ASSERT_EQUAL(4, registry.size());
+}
+
+void test_coalescing_latest_wins(void) {
+    EventBus<AudioStateEvent> bus;
+    int count = 0;
+    float volume = 0.0f;
+    bus.subscribe([&](const AudioStateEvent &e){
+        count++;
+        volume = e.volume;
+    });
+    for (int i = 1; i <= 5; i++) {
+        bus.publish(AudioStateEvent{AudioStateEvent::Playing, "mp3", 0, i / 10.0f, 1.0f});
+    }
+    TEST_ASSERT_EQUAL(1, bus.processEvents());
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, volume);
+}
+
+void test_coalescing_merge_arrows(void) {
+    RingEventBus<FunctionKeyEvent, 16> bus;
+    FunctionKeyEvent seen[8];
+    int count = 0;
+    bus.subscribe([&](const FunctionKeyEvent &e){ seen[count++] = e; });
+    const FunctionKeyEvent::Type keys[] = {FunctionKeyEvent::DownArrow, FunctionKeyEvent::DownArrow, FunctionKeyEvent::DownArrow,
+                                           FunctionKeyEvent::UpArrow,   FunctionKeyEvent::UpArrow,   FunctionKeyEvent::ReadWord,
+                                           FunctionKeyEvent::ReadWord};
+    for (FunctionKeyEvent::Type key : keys) {
+        bus.publish(FunctionKeyEvent(key));
+    }
+    TEST_ASSERT_EQUAL(4, bus.processEvents());
+    TEST_ASSERT_EQUAL(FunctionKeyEvent::DownArrow, seen[0].type);
+    TEST_ASSERT_EQUAL_UINT8(3, seen[0].repeat);
+    TEST_ASSERT_EQUAL(FunctionKeyEvent::UpArrow, seen[1].type);
+    TEST_ASSERT_EQUAL_UINT8(2, seen[1].repeat);
+    TEST_ASSERT_EQUAL(FunctionKeyEvent::ReadWord, seen[2].type);
+    TEST_ASSERT_EQUAL_UINT8(1, seen[2].repeat);
+    TEST_ASSERT_EQUAL(FunctionKeyEvent::ReadWord, seen[3].type);
+}
+
+struct LowLaneEvent { int value; };
+struct NormalLaneEvent { int value; };
+struct HighLaneEvent { int value; };
+
+void test_eventsystem_priority_order(void) {
+    auto &sys = EventSystem::instance();
+    char order[4] = {};
+    int n = 0;
+    sys.getEventBus<LowLaneEvent>().subscribe([&](const LowLaneEvent &){ order[n++] = 'L'; });
+    sys.getEventBus<NormalLaneEvent>().subscribe([&](const NormalLaneEvent &){ order[n++] = 'N'; });
+    sys.getEventBus<HighLaneEvent>().subscribe([&](const HighLaneEvent &){ order[n++] = 'H'; });
+    sys.registerEventBus<LowLaneEvent>(EventPriority::Low);
+    sys.registerEventBus<NormalLaneEvent>();
+    sys.registerEventBus<HighLaneEvent>(EventPriority::High);
+    sys.getEventBus<LowLaneEvent>().publish(LowLaneEvent{1});
+    sys.getEventBus<NormalLaneEvent>().publish(NormalLaneEvent{2});
+    sys.getEventBus<HighLaneEvent>().publish(HighLaneEvent{3});
+    sys.processAllEvents();
+    TEST_ASSERT_EQUAL_STRING("HNL", order);
+    sys.getEventBus<LowLaneEvent>().clear();
+    sys.getEventBus<NormalLaneEvent>().clear();
+    sys.getEventBus<HighLaneEvent>().clear();
+}
+
+void test_eventbus_deadline_budget(void) {
+    EventBus<int> bus;
+    int seen[10];
+    int count = 0;
+    bus.subscribe([&](const int &v){
+        seen[count++] = v;
+        delayMicroseconds(1000);
+    });
+    for (int i = 0; i < 10; i++) {
+        bus.publish(i);
+    }
+    size_t delivered = bus.processEventsUntil(micros() + 3500);
+    TEST_ASSERT_TRUE(delivered >= 3 && delivered < 10);
+    TEST_ASSERT_EQUAL(10 - delivered, bus.pending());
+
+    // The rest come next time, still in order
+    bus.processEvents();
+    TEST_ASSERT_EQUAL(10, count);
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(i, seen[i]);
+    }
+}
+
+struct TaskEvent {
+    uint32_t publishedUs;
+};
+
+struct TaskConsumer {
+    TaskEventBus<TaskEvent> *bus;
+    volatile int received;
+    volatile uint32_t latencyUs;
+    volatile TaskHandle_t ranOn;
+    volatile bool stop;
+};
+
+static void taskConsumerBody(void *param) {
+    TaskConsumer *consumer = static_cast<TaskConsumer *>(param);
+    auto id = consumer->bus->attach([consumer](const TaskEvent &e){
+        consumer->latencyUs = micros() - e.publishedUs;
+        consumer->ranOn = xTaskGetCurrentTaskHandle();
+        consumer->received++;
+    });
+    while (!consumer->stop) {
+        consumer->bus->waitAndProcess(pdMS_TO_TICKS(1000));
+    }
+    consumer->bus->detach(id);
+    consumer->stop = false;
+    vTaskDelete(nullptr);
+}
+
+static void stopTaskConsumer(TaskConsumer &consumer) {
+    consumer.stop = true;
+    while (consumer.stop) {
+        delay(10);
+    }
+}
+
+void test_taskbus_delivers_on_consumer_task(void) {
+    TaskEventBus<TaskEvent> bus;
+    TaskConsumer consumer{&bus, 0, 0, nullptr, false};
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(taskConsumerBody, "bus_consumer", 4096, &consumer, 2, &handle, 0);
+    delay(50); // let it attach and go to sleep
+
+    bus.publish(TaskEvent{micros()});
+    uint32_t start = millis();
+    while (consumer.received == 0 && millis() - start < 500) {
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL(1, consumer.received);
+    TEST_ASSERT_EQUAL_PTR(handle, consumer.ranOn);
+    ESP_LOGI("test", "Publish to consumer wake-up: %u us", (unsigned)consumer.latencyUs);
+    TEST_ASSERT_LESS_THAN_UINT32(5000, consumer.latencyUs);
+    stopTaskConsumer(consumer);
+}
+
+void test_taskbus_per_consumer_queues(void) {
+    TaskEventBus<TaskEvent> bus;
+    TaskConsumer core0{&bus, 0, 0, nullptr, false};
+    TaskConsumer core1{&bus, 0, 0, nullptr, false};
+    xTaskCreatePinnedToCore(taskConsumerBody, "bus_core0", 4096, &core0, 2, nullptr, 0);
+    xTaskCreatePinnedToCore(taskConsumerBody, "bus_core1", 4096, &core1, 2, nullptr, 1);
+    delay(50);
+
+    for (int i = 0; i < 5; i++) {
+        bus.publish(TaskEvent{micros()});
+    }
+    TEST_ASSERT_EQUAL(0, bus.processEvents()); // this task is not a consumer
+    uint32_t start = millis();
+    while ((core0.received < 5 || core1.received < 5) && millis() - start < 500) {
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL(5, core0.received);
+    TEST_ASSERT_EQUAL(5, core1.received);
+    TEST_ASSERT_EQUAL_UINT32(0, bus.dropped());
+    stopTaskConsumer(core0);
+    stopTaskConsumer(core1);
+}
+
+void test_input_latency_histogram_and_flush(void) {
+    InputLatency &latency = InputLatency::instance();
+    latency.reset();
+    latency.record(InputLatency::Dispatch, 100);   // < 250
+    latency.record(InputLatency::Dispatch, 3000);  // < 4000
+    latency.record(InputLatency::Dispatch, 90000); // open bucket
+    TEST_ASSERT_EQUAL_UINT32(1, latency.getHistogram(InputLatency::Dispatch, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, latency.getHistogram(InputLatency::Dispatch, 4));
+    TEST_ASSERT_EQUAL_UINT32(1, latency.getHistogram(InputLatency::Dispatch, InputLatency::BUCKETS - 1));
+    TEST_ASSERT_EQUAL_UINT32(4000, latency.percentileUs(InputLatency::Dispatch, 50));
+    TEST_ASSERT_EQUAL_UINT32(90000, latency.percentileUs(InputLatency::Dispatch, 95));
+
+    // Two keys before one flush: one Total sample, measured from the first report
+    uint32_t first = micros();
+    latency.onTextChanged(first, micros());
+    delayMicroseconds(2000);
+    latency.onTextChanged(micros(), micros());
+    latency.onFlush();
+    latency.onFlush(); // nothing armed any more
+    TEST_ASSERT_EQUAL_UINT32(2, latency.getCount(InputLatency::Apply));
+    TEST_ASSERT_EQUAL_UINT32(1, latency.getCount(InputLatency::Total));
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2000, latency.getMaxUs(InputLatency::Total));
+    latency.reset();
+}
+
+void test_connectivity_state_transitions(void) {
+    ConnectivityState &state = ConnectivityState::instance();
+    auto &bus = EventSystem::instance().getEventBus<ConnectivityEvent>();
+    state.set(ConnectivityEvent::Keyboard, false);
+    state.set(ConnectivityEvent::WiFi, false);
+    bus.processEvents();
+
+    ConnectivityEvent seen[8];
+    int count = 0;
+    auto id = bus.subscribe([&](const ConnectivityEvent &e){ seen[count++] = e; });
+    uint32_t transitions = state.getTransitions();
+
+    state.set(ConnectivityEvent::Keyboard, true);
+    state.set(ConnectivityEvent::Keyboard, true); // no change, no event
+    state.set(ConnectivityEvent::WiFi, false);    // already down
+    state.set(ConnectivityEvent::WiFi, true);
+    state.set(ConnectivityEvent::Keyboard, false);
+    TEST_ASSERT_TRUE(state.isUp(ConnectivityEvent::WiFi));
+    TEST_ASSERT_FALSE(state.isUp(ConnectivityEvent::Keyboard));
+    TEST_ASSERT_EQUAL_UINT32(transitions + 3, state.getTransitions());
+
+    TEST_ASSERT_EQUAL(3, bus.processEvents());
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL(ConnectivityEvent::Keyboard, seen[0].link);
+    TEST_ASSERT_TRUE(seen[0].up);
+    TEST_ASSERT_EQUAL(ConnectivityEvent::WiFi, seen[1].link);
+    TEST_ASSERT_TRUE(seen[1].up);
+    TEST_ASSERT_EQUAL(ConnectivityEvent::Keyboard, seen[2].link);
+    TEST_ASSERT_FALSE(seen[2].up);
+
+    bus.unsubscribe(id);
+    state.set(ConnectivityEvent::WiFi, false);
+    bus.processEvents();
+}
+
 void setUp(void) {
     // set stuff up here
 }
@@ -157,6 +599,21 @@ void setup() {
     RUN_TEST(test_eventsystem_singleton_and_bus_instance);
     RUN_TEST(test_eventsystem_process_all_events_multiple_types);
     RUN_TEST(test_eventpublisher_routing);
+    RUN_TEST(test_ringbus_overflow_policies);
+    RUN_TEST(test_ringbus_multi_producer_block);
+    RUN_TEST(test_ringbus_queue_isolation);
+    RUN_TEST(test_listener_generation_handles);
+    RUN_TEST(test_listener_scoped_subscription);
+    RUN_TEST(test_listener_remove_during_dispatch);
+    RUN_TEST(test_listener_registry_benchmark);
+    RUN_TEST(test_coalescing_latest_wins);
+    RUN_TEST(test_coalescing_merge_arrows);
+    RUN_TEST(test_eventsystem_priority_order);
+    RUN_TEST(test_eventbus_deadline_budget);
+    RUN_TEST(test_taskbus_delivers_on_consumer_task);
+    RUN_TEST(test_taskbus_per_consumer_queues);
+    RUN_TEST(test_input_latency_histogram_and_flush);
+    RUN_TEST(test_connectivity_state_transitions);
     UNITY_END();
 }
 
@@ -0,0 +1,133 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <unity.h>
+#include "core_settings/settings_store.h"
+
+using namespace dict;
+
+// What are tested here:
+// Cache: a put is visible to get at once, before anything reaches NVS.
+void test_settings_read_your_writes(void);
+// Debounce: nothing is committed while changes keep coming; one commit after COMMIT_DELAY_MS idle.
+void test_settings_debounced_commit(void);
+// Coalescing: many changes to several keys of one namespace become one NVS transaction.
+void test_settings_coalesced_commit(void);
+// Unchanged values: writing the current value does not dirty the store.
+void test_settings_unchanged_value_not_dirty(void);
+// Remove: a removed setting reads as default and is deleted from NVS on flush.
+void test_settings_remove(void);
+
+static const char *NS = "test_settings";
+
+static String nvsString(const char *key) {
+    Preferences preferences;
+    if (!preferences.begin(NS, true)) {
+        return "";
+    }
+    String value = preferences.getString(key, "");
+    preferences.end();
+    return value;
+}
+
+static int32_t nvsInt(const char *key) {
+    Preferences preferences;
+    if (!preferences.begin(NS, true)) {
+        return -1;
+    }
+    int32_t value = preferences.getInt(key, -1);
+    preferences.end();
+    return value;
+}
+
+// =================================== TESTS ===================================
+void test_settings_read_your_writes(void) {
+    SettingsStore &store = SettingsStore::instance();
+    store.putString(NS, "name", "cached");
+    store.putFloat(NS, "gain", 0.25f);
+    TEST_ASSERT_EQUAL_STRING("cached", store.getString(NS, "name").c_str());
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, store.getFloat(NS, "gain", 0.0f));
+    TEST_ASSERT_TRUE(store.hasPendingWrites());
+    store.flush();
+    TEST_ASSERT_FALSE(store.hasPendingWrites());
+    TEST_ASSERT_EQUAL_STRING("cached", nvsString("name").c_str());
+}
+
+void test_settings_debounced_commit(void) {
+    SettingsStore &store = SettingsStore::instance();
+    store.flush();
+    uint32_t commits = store.getCommitCount();
+    store.putInt(NS, "count", 1);
+
+    // Keep changing for longer than the commit delay; nothing may be written
+    uint32_t start = millis();
+    int32_t value = 1;
+    while (millis() - start < SettingsStore::COMMIT_DELAY_MS + 500) {
+        store.putInt(NS, "count", ++value);
+        store.tick();
+        delay(100);
+    }
+    TEST_ASSERT_EQUAL_UINT32(commits, store.getCommitCount());
+    TEST_ASSERT_NOT_EQUAL(value, nvsInt("count"));
+
+    // Once idle for the delay, exactly one commit
+    start = millis();
+    while (store.hasPendingWrites() && millis() - start < SettingsStore::COMMIT_DELAY_MS + 1000) {
+        store.tick();
+        delay(50);
+    }
+    TEST_ASSERT_EQUAL_UINT32(commits + 1, store.getCommitCount());
+    TEST_ASSERT_EQUAL_INT32(value, nvsInt("count"));
+}
+
+void test_settings_coalesced_commit(void) {
+    SettingsStore &store = SettingsStore::instance();
+    store.flush();
+    uint32_t commits = store.getCommitCount();
+    for (int i = 0; i < 20; i++) {
+        store.putFloat(NS, "gain", i / 20.0f);
+        store.putInt(NS, "count", i);
+        store.putString(NS, "name", String("n") + i);
+    }
+    store.flush();
+    TEST_ASSERT_EQUAL_UINT32(commits + 1, store.getCommitCount());
+    TEST_ASSERT_EQUAL_INT32(19, nvsInt("count"));
+    TEST_ASSERT_EQUAL_STRING("n19", nvsString("name").c_str());
+}
+
+void test_settings_unchanged_value_not_dirty(void) {
+    SettingsStore &store = SettingsStore::instance();
+    store.putString(NS, "name", "same");
+    store.flush();
+    store.putString(NS, "name", "same");
+    TEST_ASSERT_FALSE(store.hasPendingWrites());
+}
+
+void test_settings_remove(void) {
+    SettingsStore &store = SettingsStore::instance();
+    store.putString(NS, "name", "gone soon");
+    store.flush();
+    store.remove(NS, "name");
+    TEST_ASSERT_FALSE(store.has(NS, "name"));
+    TEST_ASSERT_EQUAL_STRING("default", store.getString(NS, "name", "default").c_str());
+    store.flush();
+    TEST_ASSERT_EQUAL_STRING("", nvsString("name").c_str());
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    SettingsStore::instance().initialize();
+    UNITY_BEGIN();
+    RUN_TEST(test_settings_read_your_writes);
+    RUN_TEST(test_settings_debounced_commit);
+    RUN_TEST(test_settings_coalesced_commit);
+    RUN_TEST(test_settings_unchanged_value_not_dirty);
+    RUN_TEST(test_settings_remove);
+    UNITY_END();
+}
+
+void loop() {}
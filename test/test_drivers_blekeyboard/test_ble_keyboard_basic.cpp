@@ -22,8 +22,8 @@ void test_ble_keyboard_init_and_shutdown(void) {
 
     TEST_ASSERT_TRUE_MESSAGE(kb.isConnected(), "BLE keyboard should be connected");
 
-    kb.setKeyCallback([&](char ch, uint8_t keyCode, uint8_t modifiers){
-        kp.sendKeyToLVGL(ch, keyCode, modifiers);
+    kb.setKeyCallback([&](char ch, uint8_t keyCode, uint8_t modifiers, uint32_t reportUs, bool pressed){
+        kp.sendKeyToLVGL(ch, keyCode, modifiers, reportUs, pressed);
     });
 
     // let's process all the queued keys and events
@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "hid_report_parser.h"
+
+using namespace dict;
+
+void test_hid_parser_six_key_rollover(void) {
+    HidReportParser parser;
+    HidKeyTransition out[HidReportParser::MAX_TRANSITIONS];
+
+    const uint8_t sixKeys[8] = {0, 0, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+    TEST_ASSERT_EQUAL_UINT32(6, parser.parse(sixKeys, sizeof(sixKeys), out));
+    for (int i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL_UINT8(0x04 + i, out[i].keyCode);
+        TEST_ASSERT_TRUE(out[i].pressed);
+    }
+
+    // A resent report (typematic or a second characteristic) is not a new press
+    TEST_ASSERT_EQUAL_UINT32(0, parser.parse(sixKeys, sizeof(sixKeys), out));
+
+    // Slots shift when a key is released; only the released keys are reported
+    const uint8_t twoUp[8] = {0, 0, 0x04, 0x06, 0x08, 0x09, 0, 0};
+    TEST_ASSERT_EQUAL_UINT32(2, parser.parse(twoUp, sizeof(twoUp), out));
+    TEST_ASSERT_EQUAL_UINT8(0x05, out[0].keyCode);
+    TEST_ASSERT_FALSE(out[0].pressed);
+    TEST_ASSERT_EQUAL_UINT8(0x07, out[1].keyCode);
+    TEST_ASSERT_FALSE(out[1].pressed);
+    TEST_ASSERT_TRUE(parser.isHeld(0x09));
+    TEST_ASSERT_FALSE(parser.isHeld(0x05));
+
+    // Release and press in the same report: release first
+    const uint8_t swap[8] = {0, 0, 0x04, 0x06, 0x08, 0x0A, 0, 0};
+    TEST_ASSERT_EQUAL_UINT32(2, parser.parse(swap, sizeof(swap), out));
+    TEST_ASSERT_EQUAL_UINT8(0x09, out[0].keyCode);
+    TEST_ASSERT_FALSE(out[0].pressed);
+    TEST_ASSERT_EQUAL_UINT8(0x0A, out[1].keyCode);
+    TEST_ASSERT_TRUE(out[1].pressed);
+}
+
+void test_hid_parser_modifier_edges(void) {
+    HidReportParser parser;
+    HidKeyTransition out[HidReportParser::MAX_TRANSITIONS];
+
+    // LeftShift and A in one report: the modifier edge comes first
+    const uint8_t shiftA[8] = {0x02, 0, 0x04, 0, 0, 0, 0, 0};
+    TEST_ASSERT_EQUAL_UINT32(2, parser.parse(shiftA, sizeof(shiftA), out));
+    TEST_ASSERT_EQUAL_UINT8(0xE1, out[0].keyCode);
+    TEST_ASSERT_TRUE(out[0].pressed);
+    TEST_ASSERT_EQUAL_UINT8(0x04, out[1].keyCode);
+    TEST_ASSERT_EQUAL_UINT8(0x02, out[1].modifiers);
+
+    // Swap LeftShift for RightCtrl while A stays down
+    const uint8_t ctrlA[8] = {0x10, 0, 0x04, 0, 0, 0, 0, 0};
+    TEST_ASSERT_EQUAL_UINT32(2, parser.parse(ctrlA, sizeof(ctrlA), out));
+    TEST_ASSERT_EQUAL_UINT8(0xE1, out[0].keyCode);
+    TEST_ASSERT_FALSE(out[0].pressed);
+    TEST_ASSERT_EQUAL_UINT8(0xE4, out[1].keyCode);
+    TEST_ASSERT_TRUE(out[1].pressed);
+    TEST_ASSERT_EQUAL_UINT8(0x10, parser.getModifiers());
+}
+
+void test_hid_parser_rollover_error_and_reset(void) {
+    HidReportParser parser;
+    HidKeyTransition out[HidReportParser::MAX_TRANSITIONS];
+
+    const uint8_t held[8] = {0, 0, 0x04, 0x05, 0, 0, 0, 0};
+    TEST_ASSERT_EQUAL_UINT32(2, parser.parse(held, sizeof(held), out));
+
+    // Phantom state: no transitions, held keys kept
+    const uint8_t error[8] = {0, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01};
+    TEST_ASSERT_EQUAL_UINT32(0, parser.parse(error, sizeof(error), out));
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getRolloverErrors());
+    TEST_ASSERT_TRUE(parser.isHeld(0x05));
+
+    // Back to the same keys: nothing new
+    TEST_ASSERT_EQUAL_UINT32(0, parser.parse(held, sizeof(held), out));
+
+    // Short report (one slot) and a truncated one
+    const uint8_t shortReport[3] = {0, 0, 0x05};
+    TEST_ASSERT_EQUAL_UINT32(1, parser.parse(shortReport, sizeof(shortReport), out));
+    TEST_ASSERT_EQUAL_UINT8(0x04, out[0].keyCode);
+    TEST_ASSERT_FALSE(out[0].pressed);
+    TEST_ASSERT_EQUAL_UINT32(0, parser.parse(shortReport, 2, out));
+
+    parser.reset();
+    TEST_ASSERT_FALSE(parser.isHeld(0x05));
+    TEST_ASSERT_EQUAL_UINT32(1, parser.parse(shortReport, sizeof(shortReport), out));
+    TEST_ASSERT_TRUE(out[0].pressed);
+}
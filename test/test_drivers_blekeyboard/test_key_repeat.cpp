@@ -0,0 +1,52 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "key_processor.h"
+#include "event_system.h"
+
+using namespace dict;
+
+static int countKeys(EventBusFor<KeyEvent> &bus, uint32_t forMs, char key) {
+    int count = 0;
+    auto id = bus.subscribe([&](const KeyEvent &event) {
+        if (event.pressed && event.key == key) {
+            count++;
+        }
+    });
+    uint32_t start = millis();
+    while (millis() - start < forMs) {
+        EventSystem::instance().processAllEvents();
+        delay(2);
+    }
+    bus.unsubscribe(id);
+    return count;
+}
+
+void test_key_repeat_held_key(void) {
+    auto &bus = EventSystem::instance().getEventBus<KeyEvent>();
+    KeyProcessor kp;
+    TEST_ASSERT_TRUE(kp.initialize());
+    kp.setRepeatTiming(100, 20);
+
+    // Press 'a' and hold for 300 ms: the press, then ~10 repeats after the 100 ms delay
+    kp.sendKeyToLVGL('a', 0x04, 0, 0, true);
+    int typed = countKeys(bus, 300, 'a');
+    TEST_ASSERT_GREATER_OR_EQUAL_INT(1 + 8, typed);
+    TEST_ASSERT_LESS_OR_EQUAL_INT(1 + 11, typed);
+
+    // Release stops it
+    kp.sendKeyToLVGL('a', 0x04, 0, 0, false);
+    countKeys(bus, 30, 'a');
+    uint32_t repeats = kp.getRepeatCount();
+    TEST_ASSERT_EQUAL_INT(0, countKeys(bus, 200, 'a'));
+    TEST_ASSERT_EQUAL_UINT32(repeats, kp.getRepeatCount());
+
+    // Enter does not repeat; pressing another key takes the repeat over
+    kp.sendKeyToLVGL('b', 0x05, 0, 0, true);
+    kp.sendKeyToLVGL('\n', 0x28, 0, 0, true);
+    TEST_ASSERT_EQUAL_INT(1, countKeys(bus, 250, 'b')); // the press only
+    kp.sendKeyToLVGL('\n', 0x28, 0, 0, false);
+    kp.sendKeyToLVGL('b', 0x05, 0, 0, false);
+    TEST_ASSERT_EQUAL_UINT32(repeats, kp.getRepeatCount());
+
+    kp.shutdown();
+}
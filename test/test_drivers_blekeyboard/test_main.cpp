@@ -5,6 +5,18 @@
 using namespace dict;
 
 void test_ble_keyboard_init_and_shutdown(void);
+// HID reports: six slots diffed into one press/release per key, resent reports add nothing.
+void test_hid_parser_six_key_rollover(void);
+// Modifier byte: one transition per changed bit, ahead of the key transitions of the same report.
+void test_hid_parser_modifier_edges(void);
+// Rollover error reports are ignored; short reports and reset() behave.
+void test_hid_parser_rollover_error_and_reset(void);
+// Auto-repeat: a held key repeats after the delay at the interval, stops on release and on another key.
+void test_key_repeat_held_key(void);
+// Scan filter: saved address or HID service UUID16 in the payload match, counters add up.
+void test_scan_filter_address_and_service(void);
+// Scan filter: truncated AD structures, padding, odd-length UUID lists and empty payloads.
+void test_scan_filter_malformed_payload(void);
 
 #define TAG "BLEKeyboardTest"
 
@@ -21,6 +33,12 @@ void setup() {
     delay(1000);
     printTestSuiteMemorySummary("BLEKeyboard", true);
     UNITY_BEGIN();
+    RUN_TEST_EX(TAG, test_hid_parser_six_key_rollover);
+    RUN_TEST_EX(TAG, test_hid_parser_modifier_edges);
+    RUN_TEST_EX(TAG, test_hid_parser_rollover_error_and_reset);
+    RUN_TEST_EX(TAG, test_key_repeat_held_key);
+    RUN_TEST_EX(TAG, test_scan_filter_address_and_service);
+    RUN_TEST_EX(TAG, test_scan_filter_malformed_payload);
     RUN_TEST_EX(TAG, test_ble_keyboard_init_and_shutdown);
     UNITY_END();
     printTestSuiteMemorySummary("BLEKeyboard", false);
@@ -0,0 +1,53 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "scan_filter.h"
+
+using namespace dict;
+
+void test_scan_filter_address_and_service(void) {
+    ScanFilter filter;
+    const uint8_t saved[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    const uint8_t other[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x67};
+    TEST_ASSERT_TRUE(filter.addAddress(saved));
+    TEST_ASSERT_TRUE(filter.addService(0x1812));
+
+    // Flags, then a complete UUID16 list with Battery and HID, then the appearance
+    const uint8_t keyboardAdv[] = {0x02, 0x01, 0x06, 0x05, 0x03, 0x0F, 0x18, 0x12, 0x18, 0x03, 0x19, 0xC1, 0x03};
+    // Flags and manufacturer data that happens to contain 12 18
+    const uint8_t beaconAdv[] = {0x02, 0x01, 0x06, 0x05, 0xFF, 0x4C, 0x00, 0x12, 0x18};
+
+    TEST_ASSERT_EQUAL(ScanFilter::Address, filter.match(saved, beaconAdv, sizeof(beaconAdv)));
+    TEST_ASSERT_EQUAL(ScanFilter::Service, filter.match(other, keyboardAdv, sizeof(keyboardAdv)));
+    TEST_ASSERT_EQUAL(ScanFilter::None, filter.match(other, beaconAdv, sizeof(beaconAdv)));
+    TEST_ASSERT_EQUAL_UINT32(3, filter.getSeen());
+    TEST_ASSERT_EQUAL_UINT32(2, filter.getMatched());
+    TEST_ASSERT_EQUAL_UINT32(1, filter.getDropped());
+
+    // After clear() nothing matches
+    filter.clear();
+    TEST_ASSERT_EQUAL(ScanFilter::None, filter.match(saved, keyboardAdv, sizeof(keyboardAdv)));
+}
+
+void test_scan_filter_malformed_payload(void) {
+    ScanFilter filter;
+    filter.addService(0x1812);
+    const uint8_t other[6] = {1, 2, 3, 4, 5, 6};
+
+    // The UUID list claims more bytes than the packet has
+    const uint8_t truncated[] = {0x02, 0x01, 0x06, 0x09, 0x03, 0x12, 0x18};
+    TEST_ASSERT_EQUAL(ScanFilter::None, filter.match(other, truncated, sizeof(truncated)));
+    TEST_ASSERT_EQUAL_UINT32(1, filter.getMalformed());
+
+    // Zero padding after the last structure ends the payload
+    const uint8_t padded[] = {0x03, 0x02, 0x12, 0x18, 0x00, 0x00, 0x00};
+    TEST_ASSERT_EQUAL(ScanFilter::Service, filter.match(other, padded, sizeof(padded)));
+
+    // An odd byte at the end of a UUID16 list is not half a UUID
+    const uint8_t odd[] = {0x04, 0x03, 0x0F, 0x18, 0x12};
+    TEST_ASSERT_EQUAL(ScanFilter::None, filter.match(other, odd, sizeof(odd)));
+    TEST_ASSERT_EQUAL(ScanFilter::None, filter.match(other, nullptr, 0));
+
+    filter.resetCounters();
+    TEST_ASSERT_EQUAL_UINT32(0, filter.getSeen());
+    TEST_ASSERT_EQUAL_UINT32(0, filter.getMalformed());
+}
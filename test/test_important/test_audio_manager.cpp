@@ -1,11 +1,26 @@
 #include <Arduino.h>
 #include <unity.h>
 #include "../../lib/drivers_audio/audio_manager.h"
+#include "../../lib/api_dictionary/dictionary_api.h"
 #include "../../lib/core_misc/memory_test_helper.h"
 #include "LittleFS.h"
 
 using namespace dict;
 
+// Ticks the manager here until it reports Idle (or Error); returns the last state
+static AudioStateEvent::State tickUntilIdle(AudioManager& manager, uint32_t timeoutMs) {
+    auto& states = EventSystem::instance().getEventBus<AudioStateEvent>();
+    AudioStateEvent::State last = AudioStateEvent::Playing;
+    auto subscription = states.subscribeScoped([&](const AudioStateEvent& event) { last = event.state; });
+    uint32_t start = millis();
+    while (last != AudioStateEvent::Idle && last != AudioStateEvent::Error && millis() - start < timeoutMs) {
+        manager.tick();
+        states.processEvents();
+        delay(1);
+    }
+    return last;
+}
+
 // =================================== TESTS ===================================
 
 void test_audio_manager_initialize_and_ready(void) {
@@ -91,3 +106,142 @@ void test_audio_manager_volume_control(void) {
     
     manager.shutdown();
 }
+
+void test_audio_manager_queue(void) {
+    AudioManager& manager = AudioManager::instance();
+    TEST_ASSERT_TRUE_MESSAGE(manager.initialize(), "AudioManager initialize() failed");
+    TEST_ASSERT_TRUE(manager.isReady());
+
+    // Invalid URLs are rejected and never queued
+    TEST_ASSERT_FALSE_MESSAGE(manager.enqueue(nullptr), "Enqueue with null URL should fail");
+    TEST_ASSERT_FALSE_MESSAGE(manager.enqueue("not-a-url"), "Enqueue with non-URL should fail");
+    TEST_ASSERT_EQUAL(0, manager.queueSize());
+
+    // Skip with nothing playing is a no-op
+    TEST_ASSERT_FALSE_MESSAGE(manager.skip(), "Skip should fail when nothing is playing");
+
+    // clearQueue and stop leave the queue empty
+    manager.clearQueue();
+    TEST_ASSERT_TRUE(manager.stop());
+    TEST_ASSERT_EQUAL(0, manager.queueSize());
+
+    manager.shutdown();
+}
+
+void test_audio_manager_gapless_queue(void) {
+    // Needs WiFi. The second clip is requested on the warm connection while the
+    // first one plays, and the running player moves over to it: no stop/start
+    static const uint32_t QUEUED_TTFS_BUDGET_MS = 200;
+    DictionaryApi api;
+    TEST_ASSERT_TRUE_MESSAGE(api.initialize(), "DictionaryApi initialize() failed");
+    AudioUrl first = api.getAudioUrl("test", "word");
+    AudioUrl second = api.getAudioUrl("test", "sample");
+    TEST_ASSERT_TRUE(first.valid && second.valid);
+
+    AudioManager& manager = AudioManager::instance();
+    TEST_ASSERT_TRUE_MESSAGE(manager.initialize(), "AudioManager initialize() failed");
+    int connecting = 0;
+    int idle = 0;
+    auto subscription = EventSystem::instance().getEventBus<AudioStateEvent>().subscribeScoped([&](const AudioStateEvent& event) {
+        connecting += event.state == AudioStateEvent::Connecting;
+        idle += event.state == AudioStateEvent::Idle;
+    });
+    uint32_t clips = manager.getMetrics().getClips();
+
+    TEST_ASSERT_TRUE(manager.enqueue(first.url.c_str()));
+    TEST_ASSERT_TRUE(manager.enqueue(second.url.c_str()));
+    TEST_ASSERT_EQUAL(1, manager.queueSize());
+    TEST_ASSERT_EQUAL_MESSAGE(AudioStateEvent::Idle, tickUntilIdle(manager, 60000), "Both clips should play to their end");
+
+    TEST_ASSERT_EQUAL_UINT32(clips + 2, manager.getMetrics().getClips());
+    TEST_ASSERT_EQUAL_MESSAGE(1, connecting, "Only the first clip should start the player");
+    TEST_ASSERT_EQUAL_MESSAGE(1, idle, "Playback should not stop between the clips");
+    TEST_ASSERT_LESS_THAN_UINT32_MESSAGE(QUEUED_TTFS_BUDGET_MS, manager.getMetrics().getTimeToFirstSampleMs(),
+                                         "The prefetched clip should start without a request round trip");
+
+    subscription.reset();
+    manager.shutdown();
+    api.shutdown();
+}
+
+void test_audio_manager_resume_after_drop(void) {
+    // Needs WiFi. The explanation clip is longer than the read-ahead, so after a
+    // second of playback part of its body is still on the connection
+    DictionaryApi api;
+    TEST_ASSERT_TRUE_MESSAGE(api.initialize(), "DictionaryApi initialize() failed");
+    AudioUrl clip = api.getAudioUrl("test", "explanation");
+    TEST_ASSERT_TRUE(clip.valid);
+
+    AudioManager& manager = AudioManager::instance();
+    TEST_ASSERT_TRUE_MESSAGE(manager.initialize(), "AudioManager initialize() failed");
+    uint32_t underruns = manager.getMetrics().getUnderruns();
+    uint32_t stalls = manager.getMetrics().getStalls();
+    TEST_ASSERT_TRUE(manager.play(clip.url.c_str()));
+    uint32_t start = millis();
+    while (millis() - start < 1000) {
+        manager.tick();
+        delay(1);
+    }
+
+    // The resume runs on the fetch task while the read-ahead keeps the output fed
+    manager.dropConnection();
+    TEST_ASSERT_EQUAL_MESSAGE(AudioStateEvent::Idle, tickUntilIdle(manager, 120000), "Clip should play to its end");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(stalls + 1, manager.getMetrics().getStalls(), "The drop should be resumed once");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(underruns, manager.getMetrics().getUnderruns(), "Output should not run dry while resuming");
+
+    manager.shutdown();
+    api.shutdown();
+}
+
+void test_audio_manager_ui_sound(void) {
+    AudioManager& manager = AudioManager::instance();
+    TEST_ASSERT_TRUE_MESSAGE(manager.initialize(), "AudioManager initialize() failed");
+
+    // All built-in sounds are loaded and play with nothing else running
+    TEST_ASSERT_TRUE(manager.playUiSound(UiSound::KeyClick));
+    TEST_ASSERT_TRUE(manager.playUiSound(UiSound::LookupDone));
+    TEST_ASSERT_TRUE(manager.playUiSound(UiSound::Error));
+    for (int i = 0; i < 50; i++) {
+        manager.tick();
+        delay(10);
+    }
+    TEST_ASSERT_TRUE(manager.isReady());
+
+    manager.shutdown();
+    TEST_ASSERT_FALSE_MESSAGE(manager.playUiSound(UiSound::KeyClick), "UI sound should fail after shutdown");
+}
+
+void test_audio_manager_commands(void) {
+    AudioManager& manager = AudioManager::instance();
+    TEST_ASSERT_TRUE_MESSAGE(manager.initialize(), "AudioManager initialize() failed");
+    TEST_ASSERT_TRUE_MESSAGE(manager.startTask(), "AudioManager startTask() failed");
+    TEST_ASSERT_TRUE(manager.isTaskRunning());
+
+    auto& states = EventSystem::instance().getEventBus<AudioStateEvent>();
+    int stateCount = 0;
+    float lastVolume = -1.0f;
+    auto listenerId = states.subscribe([&](const AudioStateEvent& event) {
+        stateCount++;
+        lastVolume = event.volume;
+    });
+
+    // Commands are executed on the audio task, not here
+    auto& commands = EventSystem::instance().getEventBus<AudioCommandEvent>();
+    AudioCommandEvent setVolume(AudioCommandEvent::Volume);
+    setVolume.value = 0.5f;
+    commands.publish(setVolume);
+    commands.publish(AudioCommandEvent::volumeStep(0.1f));
+    commands.publish(AudioCommandEvent::uiSound((uint8_t)UiSound::KeyClick));
+    delay(200);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.6f, manager.getVolume());
+
+    // State changes come back through the state bus
+    states.processEvents();
+    TEST_ASSERT_GREATER_THAN(0, stateCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.6f, lastVolume);
+    states.unsubscribe(listenerId);
+
+    manager.stopTask();
+    TEST_ASSERT_FALSE(manager.isTaskRunning());
+    manager.shutdown();
+}
@@ -88,7 +88,7 @@ void test_ble_keyboard_connection_state(void) {
     TEST_ASSERT_TRUE(keyboard.isReady());
     
     // Test key callback setting (should not crash)
-    keyboard.setKeyCallback([](char key, uint8_t keyCode, uint8_t modifiers) {
+    keyboard.setKeyCallback([](char key, uint8_t keyCode, uint8_t modifiers, uint32_t reportUs, bool pressed) {
         // Empty callback for testing
     });
     
@@ -61,6 +61,13 @@ void test_dictionary_api_get_audio_url(void) {
     AudioUrl sampleUrl = api->getAudioUrl("test", "sample");
     TEST_ASSERT_TRUE_MESSAGE(sampleUrl.valid, "Sample audio URL should be valid");
     TEST_ASSERT_EQUAL_STRING_MESSAGE("sample", sampleUrl.audioType.c_str(), "Sample audio type should match");
+
+    // Requested codec goes into the URL; empty leaves the server default
+    api->setAudioFormat("opus");
+    AudioUrl opusUrl = api->getAudioUrl("test", "word");
+    TEST_ASSERT_TRUE_MESSAGE(opusUrl.url.endsWith("&format=opus"), "Opus audio URL should request the format");
+    api->setAudioFormat("");
+    TEST_ASSERT_TRUE_MESSAGE(api->getAudioUrl("test", "word").url.indexOf("format=") < 0, "Default audio URL should not request a format");
     
     api->shutdown();
     delete api;
@@ -2,7 +2,10 @@
 #include <unity.h>
 #include "../../lib/drivers_display/lvgl_helper.h"
 #include "../../lib/drivers_display/display_manager.h"
+#include "../../lib/core_eventing/event_system.h"
 #include "../../lib/core_eventing/events.h"
+#include "../../lib/core_eventing/input_latency.h"
+#include "../../lib/drivers_blekeyboard/key_processor.h"
 #include "../../lib/core_misc/memory_test_helper.h"
 #include "lvgl.h"
 
@@ -58,3 +61,82 @@ void test_lvgl_helper_function_key_callbacks(void) {
     // Should not crash
     TEST_ASSERT_TRUE(true);
 }
+
+void test_lvgl_helper_function_key_forwarding(void) {
+    // A coalesced arrow run published on the bus reaches the screen callback intact
+    int calls = 0;
+    FunctionKeyEvent receivedEvent;
+    lvglSetFunctionKeyCallbacks([&](const FunctionKeyEvent &event) {
+        calls++;
+        receivedEvent = event;
+    });
+    lvglEnableKeyEventHandler();
+
+    FunctionKeyEvent held(FunctionKeyEvent::DownArrow);
+    held.repeat = 3;
+    EventSystem::instance().getEventBus<FunctionKeyEvent>().publish(held);
+    EventSystem::instance().processAllEvents();
+
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL(FunctionKeyEvent::DownArrow, receivedEvent.type);
+    TEST_ASSERT_EQUAL_UINT8(3, receivedEvent.repeat);
+
+    lvglRemoveKeyEventHandler();
+    lvglRemoveFunctionKeyEventHandler();
+    lvglSetFunctionKeyCallbacks(nullptr);
+}
+
+void test_lvgl_helper_key_latency(void) {
+    // Keys published as the BLE driver does (press and release, a Shift tap in
+    // between) and typed into a focused text area; each must be painted by a
+    // display flush well within a frame budget
+    static const int KEYS = 20;
+    static const uint8_t LEFT_SHIFT = 0xE1;
+    static const uint32_t TOTAL_P95_BUDGET_US = 50000;
+    lv_obj_t *textarea = lv_textarea_create(lv_screen_active());
+    addObjectToDefaultGroup(textarea);
+    lv_group_focus_obj(textarea);
+    lvglEnableKeyEventHandler();
+
+    InputLatency &latency = InputLatency::instance();
+    latency.reset();
+    KeyProcessor keyProcessor;
+    for (int i = 0; i < KEYS; i++) {
+        char key = 'a' + (i % 26);
+        uint8_t keyCode = 0x04 + (i % 26);
+        keyProcessor.sendKeyToLVGL(key, keyCode, 0, micros(), true);
+        keyProcessor.sendKeyToLVGL(key, keyCode, 0, micros(), false);
+        keyProcessor.sendKeyToLVGL(0, LEFT_SHIFT, 0x02, micros(), true);
+        keyProcessor.sendKeyToLVGL(0, LEFT_SHIFT, 0, micros(), false);
+        uint32_t start = millis();
+        while (latency.getCount(InputLatency::Total) < (uint32_t)(i + 1) && millis() - start < 200) {
+            EventSystem::instance().processAllEvents();
+            DisplayManager::instance().tick();
+            delay(1);
+        }
+    }
+    // A replayed key is sampled from Dispatch on, without a Publish sample
+    uint32_t now = micros();
+    EventSystem::instance().getEventBus<KeyEvent>().publish(KeyEvent{'y', 0x1C, 0, true, now, now, true, false, true});
+    uint32_t start = millis();
+    while (latency.getCount(InputLatency::Total) < (uint32_t)(KEYS + 1) && millis() - start < 200) {
+        EventSystem::instance().processAllEvents();
+        DisplayManager::instance().tick();
+        delay(1);
+    }
+    // An auto-repeat is typed too, but sampled at no stage
+    now = micros();
+    EventSystem::instance().getEventBus<KeyEvent>().publish(KeyEvent{'z', 0x1D, 0, true, now, now, true, true});
+    EventSystem::instance().processAllEvents();
+    latency.print();
+
+    TEST_ASSERT_EQUAL_UINT32(KEYS, latency.getCount(InputLatency::Publish));
+    TEST_ASSERT_EQUAL_UINT32(KEYS + 1, latency.getCount(InputLatency::Dispatch));
+    TEST_ASSERT_EQUAL_UINT32(KEYS + 1, latency.getCount(InputLatency::Apply));
+    TEST_ASSERT_EQUAL_UINT32(KEYS + 1, latency.getCount(InputLatency::Total));
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(TOTAL_P95_BUDGET_US, latency.percentileUs(InputLatency::Total, 95));
+
+    lvglRemoveKeyEventHandler();
+    lv_obj_delete(textarea);
+    latency.reset();
+}
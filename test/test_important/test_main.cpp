@@ -30,6 +30,11 @@ void test_audio_manager_initialize_and_ready(void);
 void test_audio_manager_tick_safety(void);
 void test_audio_manager_play_stop(void);
 void test_audio_manager_volume_control(void);
+void test_audio_manager_queue(void);
+void test_audio_manager_gapless_queue(void);
+void test_audio_manager_resume_after_drop(void);
+void test_audio_manager_ui_sound(void);
+void test_audio_manager_commands(void);
 
 // test_ble_keyboard.cpp
 // BLEKeyboard core functionality used in src
@@ -63,6 +68,8 @@ void test_event_system_event_bus_management(void);
 // LVGL helper functions used in src
 void test_lvgl_helper_key_callbacks(void);
 void test_lvgl_helper_function_key_callbacks(void);
+void test_lvgl_helper_function_key_forwarding(void);
+void test_lvgl_helper_key_latency(void);
 
 #define TAG "InterfacesUsedBySrcTest"
 
@@ -131,6 +138,13 @@ void setup() {
     RUN_TEST_EX(TAG, test_audio_manager_tick_safety);
     RUN_TEST_EX(TAG, test_audio_manager_play_stop);
     RUN_TEST_EX(TAG, test_audio_manager_volume_control);
+    RUN_TEST_EX(TAG, test_audio_manager_queue);
+    setup_test_wifi();
+    RUN_TEST_EX(TAG, test_audio_manager_gapless_queue);
+    RUN_TEST_EX(TAG, test_audio_manager_resume_after_drop);
+    teardown_test_wifi();
+    RUN_TEST_EX(TAG, test_audio_manager_ui_sound);
+    RUN_TEST_EX(TAG, test_audio_manager_commands);
     
     // BLE Keyboard Tests
     RUN_TEST_EX(TAG, test_ble_keyboard_initialize_and_ready);
@@ -161,6 +175,10 @@ void setup() {
     // LVGL Helper Tests
     RUN_TEST_EX(TAG, test_lvgl_helper_key_callbacks);
     RUN_TEST_EX(TAG, test_lvgl_helper_function_key_callbacks);
+    RUN_TEST_EX(TAG, test_lvgl_helper_function_key_forwarding);
+    setup_test_display();
+    RUN_TEST_EX(TAG, test_lvgl_helper_key_latency);
+    teardown_test_display();
 
     UNITY_END();
     
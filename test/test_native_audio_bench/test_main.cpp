@@ -0,0 +1,377 @@
+// Host-side benchmark of the decode path: MP3DecoderHelix / OggOpusDecoder -> MeteredOutput -> sink,
+// the same chain AudioManager runs on the device minus the network and the ES8311,
+// and of the time-stretch stage on synthetic speech-like PCM.
+//
+//   pio test -e native -f test_native_audio_bench -v
+//
+// Environment:
+//   BENCH_DATA_DIR  directory with *.mp3 and *.opus fixtures (default: data); without any *.opus a
+//                   synthetic speech clip is encoded at test time
+//   BENCH_WAV_OUT   if set, the decoded PCM of each fixture is written to <name>.wav there
+//   BENCH_MAX_RTF   fail when the real-time factor of any fixture exceeds this (unset: report only;
+//                   0.25 is the budget on the device)
+//   BENCH_MAX_STRETCH_RTF  same for the time-stretch stage at any speed and rate (device budget: 0.05)
+//
+// Allocations are counted by interposing glibc's malloc, calloc and realloc, so C allocations in the
+// codecs count as well as operator new; like mallinfo2() this ties the bench to a glibc host.
+#include "AudioTools.h"
+#include "AudioTools/AudioCodecs/CodecMP3Helix.h"
+#include "AudioTools/AudioCodecs/CodecOpusOgg.h"
+#include "core_audio/audio_metrics.h"
+#include "core_audio/time_stretch.h"
+#include <dirent.h>
+#include <malloc.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+using namespace dict;
+
+// What are tested here:
+// Decode of every MP3 fixture: produces PCM, reports frames/s, real-time factor, bitrate, peak heap growth and allocation count.
+void test_bench_decode_fixtures(void);
+// Same for Ogg/Opus fixtures (or a clip encoded here), to compare bytes per clip and decode cost with MP3.
+void test_bench_decode_opus_fixtures(void);
+// Time-stretch at every speed step: reports real-time factor, no allocations while streaming.
+void test_bench_time_stretch(void);
+
+// =============================== ALLOCATION COUNTING ===============================
+static size_t g_allocCount = 0;
+static size_t g_peakHeap = 0;
+
+// The executable's definitions take precedence over libc's for every caller, operator new included
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) {
+  g_allocCount++;
+  return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+  g_allocCount++;
+  return __libc_calloc(count, size);
+}
+void *realloc(void *p, size_t size) {
+  g_allocCount++;
+  return __libc_realloc(p, size);
+}
+}
+
+static size_t heapInUse() { return mallinfo2().uordblks; }
+
+static void samplePeakHeap() {
+  size_t inUse = heapInUse();
+  if (inUse > g_peakHeap) {
+    g_peakHeap = inUse;
+  }
+}
+
+// =================================== SINKS ===================================
+// Discards PCM (or writes it to a WAV file) and tracks peak heap per frame
+class BenchSink : public AudioStream {
+public:
+  bool open(const char *wavPath) {
+    bytes_ = 0;
+    frames_ = 0;
+    wav_ = wavPath ? fopen(wavPath, "wb") : nullptr;
+    if (wav_) {
+      uint8_t header[44] = {};
+      fwrite(header, 1, sizeof(header), wav_); // patched in close()
+    }
+    return wavPath == nullptr || wav_ != nullptr;
+  }
+
+  void close() {
+    if (!wav_) {
+      return;
+    }
+    AudioInfo fmt = audioInfo();
+    uint32_t byteRate = fmt.sample_rate * fmt.channels * (fmt.bits_per_sample / 8);
+    uint16_t blockAlign = fmt.channels * (fmt.bits_per_sample / 8);
+    uint32_t dataSize = bytes_;
+    uint32_t riffSize = dataSize + 36;
+    uint32_t fmtSize = 16;
+    uint16_t pcm = 1;
+    uint16_t channels = fmt.channels;
+    uint32_t rate = fmt.sample_rate;
+    uint16_t bits = fmt.bits_per_sample;
+    fseek(wav_, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, wav_);
+    fwrite(&riffSize, 4, 1, wav_);
+    fwrite("WAVEfmt ", 1, 8, wav_);
+    fwrite(&fmtSize, 4, 1, wav_);
+    fwrite(&pcm, 2, 1, wav_);
+    fwrite(&channels, 2, 1, wav_);
+    fwrite(&rate, 4, 1, wav_);
+    fwrite(&byteRate, 4, 1, wav_);
+    fwrite(&blockAlign, 2, 1, wav_);
+    fwrite(&bits, 2, 1, wav_);
+    fwrite("data", 1, 4, wav_);
+    fwrite(&dataSize, 4, 1, wav_);
+    fclose(wav_);
+    wav_ = nullptr;
+  }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    bytes_ += len;
+    frames_++;
+    if (wav_) {
+      fwrite(data, 1, len, wav_);
+    }
+    samplePeakHeap();
+    return len;
+  }
+  int availableForWrite() override { return 4096; }
+
+  size_t bytes() const { return bytes_; }
+  size_t frames() const { return frames_; }
+
+private:
+  FILE *wav_ = nullptr;
+  size_t bytes_ = 0;
+  size_t frames_ = 0;
+};
+
+// =================================== BENCH ===================================
+struct BenchResult {
+  std::string name;
+  size_t frames;
+  size_t inputBytes;
+  double decodeSeconds;
+  double audioSeconds;
+  size_t peakHeap; // growth over the heap in use before the decoder was created
+  size_t allocs;
+  uint32_t maxFrameUs;
+};
+
+static std::vector<std::string> listFixtures(const char *dir, const char *ext) {
+  std::vector<std::string> files;
+  DIR *d = opendir(dir);
+  if (!d) {
+    return files;
+  }
+  while (dirent *entry = readdir(d)) {
+    std::string name = entry->d_name;
+    size_t extLen = strlen(ext);
+    if (name.size() > extLen && name.compare(name.size() - extLen, extLen, ext) == 0) {
+      files.push_back(std::string(dir) + "/" + name);
+    }
+  }
+  closedir(d);
+  return files;
+}
+
+template <typename Decoder> static bool decodeFile(const std::string &path, const char *wavDir, BenchResult &result) {
+  FILE *in = fopen(path.c_str(), "rb");
+  if (!in) {
+    return false;
+  }
+  std::vector<uint8_t> encoded;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    encoded.insert(encoded.end(), chunk, chunk + n);
+  }
+  fclose(in);
+
+  std::string base = path.substr(path.find_last_of('/') + 1);
+  std::string wavPath = wavDir ? std::string(wavDir) + "/" + base.substr(0, base.find_last_of('.')) + ".wav" : "";
+
+  BenchSink sink;
+  if (!sink.open(wavDir ? wavPath.c_str() : nullptr)) {
+    return false;
+  }
+  AudioMetrics metrics;
+  MeteredOutput metered(sink, metrics);
+
+  size_t heapBaseline = heapInUse();
+  g_peakHeap = heapBaseline;
+  size_t allocsBefore = g_allocCount;
+
+  Decoder decoder;
+  decoder.setOutput(metered);
+  decoder.addNotifyAudioChange(sink);
+  decoder.begin();
+  metrics.onClipStart();
+
+  // Feed in the same 1 KB pieces the player's copier uses on the device
+  uint32_t start = audioMicros();
+  for (size_t pos = 0; pos < encoded.size(); pos += 1024) {
+    size_t len = encoded.size() - pos < 1024 ? encoded.size() - pos : 1024;
+    metrics.markDecodeStart(); // as ResumableURLStream does when a read returns
+    decoder.write(encoded.data() + pos, len);
+  }
+  samplePeakHeap();
+  decoder.end();
+  uint32_t elapsedUs = audioMicros() - start;
+  sink.close();
+
+  AudioInfo fmt = sink.audioInfo();
+  size_t bytesPerSecond = (size_t)fmt.sample_rate * fmt.channels * (fmt.bits_per_sample / 8);
+
+  result.name = base;
+  result.frames = sink.frames();
+  result.inputBytes = encoded.size();
+  result.decodeSeconds = elapsedUs / 1e6;
+  result.audioSeconds = bytesPerSecond > 0 ? (double)sink.bytes() / bytesPerSecond : 0;
+  result.peakHeap = g_peakHeap - heapBaseline;
+  result.allocs = g_allocCount - allocsBefore;
+  result.maxFrameUs = metrics.getMaxDecodeUs();
+  return true;
+}
+
+// Voiced speech stand-in: harmonics of a gliding 100-220 Hz fundamental with syllable-rate gating
+static std::vector<int16_t> speechLikePcm(size_t frames, uint8_t channels, uint32_t rate) {
+  std::vector<int16_t> pcm(frames * channels);
+  float phase = 0;
+  for (size_t i = 0; i < frames; i++) {
+    float t = (float)i / rate;
+    float f0 = 160.0f + 60.0f * sinf(2.0f * (float)M_PI * 0.7f * t);
+    phase += 2.0f * (float)M_PI * f0 / rate;
+    float gate = 0.5f + 0.5f * sinf(2.0f * (float)M_PI * 4.0f * t);
+    float v = 0;
+    for (int h = 1; h <= 8; h++) {
+      v += sinf(h * phase) / h;
+    }
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      pcm[i * channels + ch] = (int16_t)(6000.0f * gate * v);
+    }
+  }
+  return pcm;
+}
+
+// Writes an encoder's output to a file
+class FilePrint : public Print {
+public:
+  explicit FilePrint(FILE *file) : file_(file) {}
+  size_t write(uint8_t b) override { return fwrite(&b, 1, 1, file_); }
+  size_t write(const uint8_t *data, size_t len) override { return fwrite(data, 1, len, file_); }
+
+private:
+  FILE *file_;
+};
+
+// Five seconds of speech-like mono at 16 kHz through OpusOggEncoder, like the clips requested with &format=opus
+static bool encodeOpusFixture(const std::string &path) {
+  FILE *out = fopen(path.c_str(), "wb");
+  if (!out) {
+    return false;
+  }
+  FilePrint file(out);
+  std::vector<int16_t> pcm = speechLikePcm(16000 * 5, 1, 16000);
+  OpusOggEncoder encoder;
+  encoder.setOutput(file);
+  encoder.setAudioInfo(AudioInfo(16000, 1, 16));
+  bool ok = encoder.begin();
+  if (ok) {
+    encoder.write(reinterpret_cast<const uint8_t *>(pcm.data()), pcm.size() * sizeof(int16_t));
+    encoder.end();
+  }
+  fclose(out);
+  return ok;
+}
+
+// =================================== TESTS ===================================
+// Decodes every fixture with the given extension and prints one row per file
+template <typename Decoder> static void benchFixtures(const std::vector<std::string> &fixtures) {
+  const char *wavDir = getenv("BENCH_WAV_OUT");
+  double maxRtf = getenv("BENCH_MAX_RTF") ? atof(getenv("BENCH_MAX_RTF")) : 0; // 0: report only
+
+  printf("%-24s %8s %10s %10s %8s %8s %10s %8s %10s\n", "fixture", "frames", "frames/s", "audio s", "RTF", "kbps", "heap +", "allocs",
+         "max frame");
+  for (const std::string &path : fixtures) {
+    BenchResult r;
+    TEST_ASSERT_TRUE_MESSAGE(decodeFile<Decoder>(path, wavDir, r), path.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(r.frames > 0, "Decoder produced no PCM");
+    TEST_ASSERT_TRUE_MESSAGE(r.audioSeconds > 0, "Decoder reported no audio format, real-time factor unknown");
+
+    double rtf = r.decodeSeconds / r.audioSeconds;
+    double kbps = r.inputBytes * 8 / r.audioSeconds / 1000;
+    printf("%-24s %8zu %10.0f %10.2f %8.4f %8.1f %10zu %8zu %8uus\n", r.name.c_str(), r.frames, r.frames / r.decodeSeconds, r.audioSeconds, rtf,
+           kbps, r.peakHeap, r.allocs, r.maxFrameUs);
+    if (maxRtf > 0) {
+      TEST_ASSERT_TRUE_MESSAGE(rtf <= maxRtf, "Real-time factor above BENCH_MAX_RTF");
+    }
+  }
+}
+
+void test_bench_decode_fixtures(void) {
+  const char *dataDir = getenv("BENCH_DATA_DIR") ? getenv("BENCH_DATA_DIR") : "data";
+  std::vector<std::string> fixtures = listFixtures(dataDir, ".mp3");
+  TEST_ASSERT_TRUE_MESSAGE(!fixtures.empty(), "No *.mp3 fixtures found, set BENCH_DATA_DIR");
+  benchFixtures<MP3DecoderHelix>(fixtures);
+}
+
+void test_bench_decode_opus_fixtures(void) {
+  const char *dataDir = getenv("BENCH_DATA_DIR") ? getenv("BENCH_DATA_DIR") : "data";
+  std::vector<std::string> fixtures = listFixtures(dataDir, ".opus");
+  if (fixtures.empty()) {
+    std::string path = std::string(P_tmpdir) + "/bench_speech_16k.opus";
+    TEST_ASSERT_TRUE_MESSAGE(encodeOpusFixture(path), "Could not encode a synthetic Opus clip");
+    fixtures.push_back(path);
+  }
+  benchFixtures<OggOpusDecoder>(fixtures);
+}
+
+void test_bench_time_stretch(void) {
+  double maxRtf = getenv("BENCH_MAX_STRETCH_RTF") ? atof(getenv("BENCH_MAX_STRETCH_RTF")) : 0; // 0: report only
+  const float speeds[] = {0.75f, 0.875f, 1.125f, 1.25f, 1.5f};
+  const uint32_t rates[] = {16000, 24000, 44100, 48000};
+  std::vector<int16_t> work(TimeStretchStage::WORK_SAMPLES);
+
+  printf("%-24s %8s %10s %10s %8s %8s\n", "stretch", "speed", "in s", "out s", "RTF", "allocs");
+  for (uint8_t channels = 1; channels <= 2; channels++) {
+    for (uint32_t rate : rates) {
+      const size_t frames = rate * 10;
+      std::vector<int16_t> pcm = speechLikePcm(frames, channels, rate);
+      for (float speed : speeds) {
+        BenchSink sink;
+        sink.open(nullptr);
+        TimeStretchStage stage(sink);
+        stage.setWorkBuffer(work.data(), work.size());
+        stage.setSpeed(speed);
+        stage.setAudioInfo(AudioInfo(rate, channels, 16));
+        sink.setAudioInfo(AudioInfo(rate, channels, 16));
+
+        size_t allocsBefore = g_allocCount;
+        uint32_t start = audioMicros();
+        const size_t piece = 1152 * channels;
+        for (size_t pos = 0; pos < pcm.size(); pos += piece) {
+          size_t n = pcm.size() - pos < piece ? pcm.size() - pos : piece;
+          stage.write(reinterpret_cast<const uint8_t *>(&pcm[pos]), n * sizeof(int16_t));
+        }
+        stage.flush();
+        uint32_t elapsedUs = audioMicros() - start;
+        size_t allocs = g_allocCount - allocsBefore;
+
+        double outSeconds = (double)sink.bytes() / (rate * channels * sizeof(int16_t));
+        double rtf = elapsedUs / 1e6 / outSeconds;
+        char name[32];
+        snprintf(name, sizeof(name), "%u Hz x%u", (unsigned)rate, (unsigned)channels);
+        printf("%-24s %8.3f %10.2f %10.2f %8.4f %8zu\n", name, speed, (double)frames / rate, outSeconds, rtf, allocs);
+        TEST_ASSERT_EQUAL_MESSAGE(0, allocs, "Time-stretch allocated while streaming");
+        if (maxRtf > 0) {
+          TEST_ASSERT_TRUE_MESSAGE(rtf <= maxRtf, "Time-stretch real-time factor above BENCH_MAX_STRETCH_RTF");
+        }
+      }
+    }
+  }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_decode_fixtures);
+  RUN_TEST(test_bench_decode_opus_fixtures);
+  RUN_TEST(test_bench_time_stretch);
+  return UNITY_END();
+}
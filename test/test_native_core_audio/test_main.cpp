@@ -0,0 +1,446 @@
+// Host tests for the portable audio stages in lib/core_audio.
+//
+//   pio test -e native -f test_native_core_audio
+#include "core_audio/audio_metrics.h"
+#include "core_audio/output_format_stage.h"
+#include "core_audio/pcm_convert.h"
+#include "core_audio/pcm_dsp.h"
+#include "core_audio/time_stretch.h"
+#include "core_audio/ui_sound_mixer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+using namespace dict;
+
+// What are tested here:
+// Upmix: optimized mono->stereo matches the scalar reference bit for bit, also in place.
+void test_upmix_matches_reference(void);
+// Resampler: streaming in random block sizes matches the whole-buffer reference bit for bit.
+void test_resampler_matches_reference(void);
+// Codec rates: native rates are kept, others go to the next supported rate up.
+void test_codec_rate_selection(void);
+// Output stage: reconfigures the next stage to the native rate and only converts when needed.
+void test_output_stage_formats(void);
+// Gain and mix kernels: dispatching versions match the scalar references bit for bit, any alignment.
+void test_dsp_kernels_match_reference(void);
+// Soft clip: identity below the knee, monotonic, never beyond full scale.
+void test_soft_clip_curve(void);
+// Gain ramp: moves monotonically and lands exactly on the target, then stays constant.
+void test_gain_ramp(void);
+// UI mixer: no voices is a pass-through; a voice is soft-clip mixed into speech and ends on its own.
+void test_ui_mixer_over_speech(void);
+// UI mixer: pump() plays voices over silence when nothing else writes, bounded per call; voices are stolen when full.
+void test_ui_mixer_pump_and_voice_limit(void);
+// UI mixer between the decoder and board taps (as in AudioManager): pumped UI sounds are neither decoded frames nor the
+// clip's first sample; decode time starts at the read that fed the decoder, time to first sample ends at the board.
+void test_ui_mixer_not_metered(void);
+// Time-stretch: 1.0x and no working buffer pass through bit for bit.
+void test_time_stretch_passthrough(void);
+// Time-stretch: output length scales with 1/speed while the pitch (zero-crossing rate) is kept.
+void test_time_stretch_length_and_pitch(void);
+
+static std::vector<int16_t> randomPcm(size_t samples, unsigned seed) {
+  std::vector<int16_t> pcm(samples);
+  srand(seed);
+  for (auto &s : pcm) {
+    s = (int16_t)(rand() & 0xFFFF);
+  }
+  return pcm;
+}
+
+// Records what reaches the "board"
+class CaptureSink : public AudioStream {
+public:
+  std::vector<int16_t> samples;
+  int configureCount = 0;
+  void setAudioInfo(AudioInfo newInfo) override {
+    AudioStream::setAudioInfo(newInfo);
+    configureCount++;
+  }
+  size_t write(const uint8_t *data, size_t len) override {
+    const int16_t *s = reinterpret_cast<const int16_t *>(data);
+    samples.insert(samples.end(), s, s + len / 2);
+    return len;
+  }
+  int availableForWrite() override { return 4096; }
+};
+
+// =================================== TESTS ===================================
+void test_upmix_matches_reference(void) {
+  for (size_t frames = 0; frames < 67; frames++) {
+    std::vector<int16_t> in = randomPcm(frames, frames + 1);
+    std::vector<int16_t> expected(frames * 2 + 1), actual(frames * 2 + 1);
+    upmixMonoToStereoReference(in.data(), expected.data(), frames);
+    upmixMonoToStereo(in.data(), actual.data(), frames);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), actual.data(), frames * 2);
+
+    // In place: mono samples at the start of the output buffer
+    std::vector<int16_t> inplace(frames * 2 + 1);
+    std::copy(in.begin(), in.end(), inplace.begin());
+    upmixMonoToStereo(inplace.data(), inplace.data(), frames);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), inplace.data(), frames * 2);
+  }
+}
+
+void test_resampler_matches_reference(void) {
+  const uint32_t rates[][2] = {{12000, 16000}, {8000, 48000}, {44100, 48000}, {22050, 32000}, {16000, 16000}};
+  for (uint8_t channels = 1; channels <= 2; channels++) {
+    for (const auto &rate : rates) {
+      const size_t inFrames = 4000;
+      std::vector<int16_t> in = randomPcm(inFrames * channels, rate[0] + channels);
+      size_t capacity = inFrames * rate[1] / rate[0] + 4;
+      std::vector<int16_t> expected(capacity * channels);
+      size_t expectedFrames = LinearResampler::processReference(in.data(), inFrames, expected.data(), capacity, rate[0], rate[1], channels);
+
+      LinearResampler resampler;
+      resampler.begin(rate[0], rate[1], channels);
+      std::vector<int16_t> actual;
+      int16_t out[64 * 2];
+      size_t pos = 0;
+      srand(rate[1]);
+      while (pos < inFrames) {
+        size_t block = 1 + rand() % 97;
+        if (block > inFrames - pos) {
+          block = inFrames - pos;
+        }
+        // Small, odd output capacity so the "output full" path is exercised too
+        size_t consumedTotal = 0;
+        while (consumedTotal < block) {
+          size_t consumed = 0;
+          size_t produced = resampler.process(&in[(pos + consumedTotal) * channels], block - consumedTotal, out, 1 + rand() % 63, consumed);
+          actual.insert(actual.end(), out, out + produced * channels);
+          consumedTotal += consumed;
+          if (produced == 0 && consumed == 0) {
+            break;
+          }
+        }
+        pos += block;
+      }
+
+      TEST_ASSERT_EQUAL(expectedFrames * channels, actual.size());
+      TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), actual.data(), actual.size());
+    }
+  }
+}
+
+void test_codec_rate_selection(void) {
+  TEST_ASSERT_EQUAL(16000, OutputFormatStage::codecRateFor(16000));
+  TEST_ASSERT_EQUAL(22050, OutputFormatStage::codecRateFor(22050));
+  TEST_ASSERT_EQUAL(48000, OutputFormatStage::codecRateFor(48000));
+  TEST_ASSERT_EQUAL(16000, OutputFormatStage::codecRateFor(12000));
+  TEST_ASSERT_EQUAL(48000, OutputFormatStage::codecRateFor(96000));
+}
+
+void test_output_stage_formats(void) {
+  CaptureSink sink;
+  OutputFormatStage stage(sink, 2);
+  std::vector<int16_t> mono = randomPcm(1152, 7);
+
+  // Native rate, mono: no resampling, only upmix to the stereo I2S link
+  stage.setAudioInfo(AudioInfo(24000, 1, 16));
+  TEST_ASSERT_EQUAL(24000, sink.audioInfo().sample_rate);
+  TEST_ASSERT_EQUAL(2, sink.audioInfo().channels);
+  stage.write(reinterpret_cast<const uint8_t *>(mono.data()), mono.size() * 2);
+  TEST_ASSERT_EQUAL(mono.size() * 2, sink.samples.size());
+  TEST_ASSERT_EQUAL(mono[5], sink.samples[10]);
+  TEST_ASSERT_EQUAL(mono[5], sink.samples[11]);
+
+  // Same format again (next clip): the link is not reconfigured
+  int configured = sink.configureCount;
+  stage.setAudioInfo(AudioInfo(24000, 1, 16));
+  TEST_ASSERT_EQUAL(configured, sink.configureCount);
+
+  // Stereo at a native rate passes straight through
+  sink.samples.clear();
+  stage.setAudioInfo(AudioInfo(44100, 2, 16));
+  TEST_ASSERT_FALSE(stage.isConverting());
+  stage.write(reinterpret_cast<const uint8_t *>(mono.data()), mono.size() * 2);
+  TEST_ASSERT_EQUAL(mono.size(), sink.samples.size());
+
+  // 12 kHz has no codec clock setup: resampled to 16 kHz and upmixed
+  sink.samples.clear();
+  stage.setAudioInfo(AudioInfo(12000, 1, 16));
+  TEST_ASSERT_EQUAL(16000, sink.audioInfo().sample_rate);
+  TEST_ASSERT_TRUE(stage.isConverting());
+  stage.write(reinterpret_cast<const uint8_t *>(mono.data()), mono.size() * 2);
+  TEST_ASSERT_INT_WITHIN(4, 1152 * 16000 / 12000 * 2, (int)sink.samples.size());
+}
+
+void test_dsp_kernels_match_reference(void) {
+  alignas(16) int16_t a[133], b[133], expected[133], actual[133];
+  std::vector<int16_t> ra = randomPcm(133, 11), rb = randomPcm(133, 12);
+  const int16_t gains[] = {0, 1, 8192, 16384, 23170, Q15_ONE};
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t count = 0; count + offset <= 133; count += 13) {
+      for (int16_t gain : gains) {
+        std::copy(ra.begin(), ra.end(), expected);
+        std::copy(ra.begin(), ra.end(), actual);
+        scaleQ15Reference(expected + offset, count, gain);
+        scaleQ15(actual + offset, count, gain);
+        TEST_ASSERT_EQUAL_INT16_ARRAY(expected, actual, 133);
+      }
+      std::copy(ra.begin(), ra.end(), a);
+      std::copy(rb.begin(), rb.end(), b);
+      mixSaturateReference(a + offset, b + offset, expected, count);
+      mixSaturate(a + offset, b + offset, actual, count);
+      TEST_ASSERT_EQUAL_INT16_ARRAY(expected, actual, count);
+    }
+  }
+  // Saturation at both rails
+  int16_t hi[2] = {30000, -30000}, out[2];
+  mixSaturate(hi, hi, out, 2);
+  TEST_ASSERT_EQUAL(32767, out[0]);
+  TEST_ASSERT_EQUAL(-32768, out[1]);
+}
+
+void test_soft_clip_curve(void) {
+  int16_t previous = softClip(-65536);
+  for (int32_t x = -65536; x <= 65535; x++) {
+    int16_t y = softClip(x);
+    if (x >= -SOFT_CLIP_KNEE && x <= SOFT_CLIP_KNEE) {
+      TEST_ASSERT_EQUAL(x, y);
+    }
+    TEST_ASSERT_TRUE(y >= previous);
+    TEST_ASSERT_TRUE(y <= 32767 && y >= -32767);
+    previous = y;
+  }
+}
+
+void test_gain_ramp(void) {
+  GainRamp ramp;
+  ramp.set(0);
+  ramp.rampTo(Q15_ONE, 1000);
+  std::vector<int16_t> ones(2 * 1500, 32767);
+  ramp.process(ones.data(), 1500, 2);
+  for (size_t i = 1; i < 1000; i++) {
+    TEST_ASSERT_TRUE(ones[2 * i] >= ones[2 * (i - 1)]);
+    TEST_ASSERT_EQUAL(ones[2 * i], ones[2 * i + 1]);
+  }
+  TEST_ASSERT_FALSE(ramp.isRamping());
+  TEST_ASSERT_EQUAL(Q15_ONE, ramp.current());
+  TEST_ASSERT_EQUAL(32767, ones[2 * 999]);  // the frame that lands on unity is untouched too
+  TEST_ASSERT_EQUAL(32767, ones[2 * 1499]); // unity after the ramp: untouched
+
+  // Ramp down over several blocks ends exactly on the target
+  ramp.rampTo(8192, 333);
+  for (int block = 0; block < 10; block++) {
+    int16_t scratch[2 * 50] = {};
+    ramp.process(scratch, 50, 2);
+  }
+  TEST_ASSERT_EQUAL(8192, ramp.current());
+}
+
+void test_ui_mixer_over_speech(void) {
+  CaptureSink sink;
+  UiSoundMixer mixer(sink);
+  mixer.setAudioInfo(AudioInfo(UiSoundMixer::SOUND_RATE, 2, 16));
+  std::vector<int16_t> speech = randomPcm(2 * 600, 21);
+  for (auto &s : speech) {
+    s /= 4;
+  }
+
+  // Nothing triggered: untouched
+  mixer.write(reinterpret_cast<const uint8_t *>(speech.data()), speech.size() * 2);
+  TEST_ASSERT_EQUAL_INT16_ARRAY(speech.data(), sink.samples.data(), speech.size());
+
+  // A 300-frame ramp at the link rate: mixed sample for sample, both channels, then gone
+  std::vector<int16_t> tone(300);
+  for (size_t i = 0; i < tone.size(); i++) {
+    tone[i] = (int16_t)(i * 20);
+  }
+  mixer.setSound(UiSound::LookupDone, tone.data(), tone.size());
+  TEST_ASSERT_FALSE(mixer.trigger(UiSound::Error)); // never loaded
+  TEST_ASSERT_TRUE(mixer.trigger(UiSound::LookupDone));
+  sink.samples.clear();
+  mixer.write(reinterpret_cast<const uint8_t *>(speech.data()), speech.size() * 2);
+  TEST_ASSERT_EQUAL(speech.size(), sink.samples.size());
+  for (size_t f = 0; f < 600; f++) {
+    int32_t voice = f < tone.size() ? tone[f] : 0;
+    TEST_ASSERT_EQUAL(softClip(speech[2 * f] + voice), sink.samples[2 * f]);
+    TEST_ASSERT_EQUAL(softClip(speech[2 * f + 1] + voice), sink.samples[2 * f + 1]);
+  }
+  TEST_ASSERT_FALSE(mixer.isActive());
+
+  // Built-in sounds fit in 16-bit positions and synthesize without clipping
+  for (size_t i = 0; i < UI_SOUND_COUNT; i++) {
+    size_t frames = UiSoundMixer::synthesizedFrames((UiSound)i);
+    std::vector<int16_t> pcm(frames);
+    TEST_ASSERT_TRUE(frames > 0 && frames < 0xFFFF);
+    TEST_ASSERT_EQUAL(frames, UiSoundMixer::synthesize((UiSound)i, pcm.data(), pcm.size()));
+    TEST_ASSERT_EQUAL(0, UiSoundMixer::synthesize((UiSound)i, pcm.data(), frames - 1));
+  }
+}
+
+void test_ui_mixer_pump_and_voice_limit(void) {
+  CaptureSink sink;
+  UiSoundMixer mixer(sink);
+  mixer.setAudioInfo(AudioInfo(48000, 2, 16));
+  std::vector<int16_t> click(UiSoundMixer::synthesizedFrames(UiSound::KeyClick));
+  UiSoundMixer::synthesize(UiSound::KeyClick, click.data(), click.size());
+  mixer.setSound(UiSound::KeyClick, click.data(), click.size());
+
+  TEST_ASSERT_EQUAL(0, mixer.pump(1000)); // idle: writes nothing
+  for (size_t i = 0; i < UiSoundMixer::MAX_VOICES + 3; i++) {
+    TEST_ASSERT_TRUE(mixer.trigger(UiSound::KeyClick, Q15_ONE / 4));
+  }
+  size_t total = 0;
+  size_t calls = 0;
+  while (mixer.isActive() && calls < 1000) {
+    size_t frames = mixer.pump(1000);
+    TEST_ASSERT_TRUE(frames > 0 && frames <= UiSoundMixer::BLOCK_FRAMES);
+    total += frames;
+    calls++;
+  }
+  // Resampled 16 kHz -> 48 kHz: three output frames per sound frame
+  TEST_ASSERT_INT_WITHIN((int)UiSoundMixer::BLOCK_FRAMES, (int)click.size() * 3, (int)total);
+  TEST_ASSERT_EQUAL(total * 2, sink.samples.size());
+  TEST_ASSERT_FALSE(mixer.isActive());
+}
+
+void test_ui_mixer_not_metered(void) {
+  CaptureSink sink;
+  AudioMetrics metrics;
+  MeteredOutput boardTap(sink, metrics, MeteredOutput::Board);
+  UiSoundMixer mixer(boardTap);
+  MeteredOutput meter(mixer, metrics);
+  meter.setAudioInfo(AudioInfo(48000, 2, 16));
+  std::vector<int16_t> click(UiSoundMixer::synthesizedFrames(UiSound::KeyClick));
+  UiSoundMixer::synthesize(UiSound::KeyClick, click.data(), click.size());
+  mixer.setSound(UiSound::KeyClick, click.data(), click.size());
+
+  // A clip is starting; key clicks play over silence before its first frame
+  metrics.onClipStart();
+  TEST_ASSERT_TRUE(mixer.trigger(UiSound::KeyClick));
+  while (mixer.isActive()) {
+    mixer.pump(UiSoundMixer::BLOCK_FRAMES);
+  }
+  TEST_ASSERT_TRUE(sink.samples.size() > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, metrics.getTimeToFirstSampleMs());
+
+  // The connection takes a while; the wait before the read returns is not decode time
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  std::vector<int16_t> frame = randomPcm(2 * 1152, 41);
+  metrics.markDecodeStart();
+  meter.write(reinterpret_cast<const uint8_t *>(frame.data()), frame.size() * 2);
+  meter.write(reinterpret_cast<const uint8_t *>(frame.data()), frame.size() * 2);
+  uint32_t decoded = 0;
+  for (int i = 0; i < AudioMetrics::DECODE_BUCKETS; i++) {
+    decoded += metrics.getDecodeHistogram(i);
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, decoded);
+  TEST_ASSERT_EQUAL_UINT32(2, metrics.getDecodeHistogram(0));
+  TEST_ASSERT_TRUE(metrics.getTimeToFirstSampleMs() >= 30);
+}
+
+static std::vector<int16_t> sinePcm(size_t frames, uint8_t channels, uint32_t rate, float hz) {
+  std::vector<int16_t> pcm(frames * channels);
+  for (size_t i = 0; i < frames; i++) {
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      pcm[i * channels + ch] = (int16_t)(12000 * sinf(2.0f * (float)M_PI * hz * i / rate));
+    }
+  }
+  return pcm;
+}
+
+// Writes in decoder-sized pieces, then flushes like the end of a clip
+static void stretchAll(TimeStretchStage &stage, const std::vector<int16_t> &pcm, uint8_t channels) {
+  const size_t piece = 1152 * channels;
+  for (size_t pos = 0; pos < pcm.size(); pos += piece) {
+    size_t n = pcm.size() - pos < piece ? pcm.size() - pos : piece;
+    stage.write(reinterpret_cast<const uint8_t *>(&pcm[pos]), n * 2);
+  }
+  stage.flush();
+}
+
+static size_t zeroCrossings(const int16_t *pcm, size_t frames, uint8_t channels) {
+  size_t count = 0;
+  for (size_t i = 1; i < frames; i++) {
+    if ((pcm[(i - 1) * channels] < 0) != (pcm[i * channels] < 0)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void test_time_stretch_passthrough(void) {
+  std::vector<int16_t> pcm = randomPcm(2 * 5000, 31);
+  std::vector<int16_t> work(TimeStretchStage::WORK_SAMPLES);
+
+  // No working buffer: can't stretch, passes through even at 0.75x
+  CaptureSink bare;
+  TimeStretchStage unbuffered(bare);
+  unbuffered.setSpeed(0.75f);
+  unbuffered.setAudioInfo(AudioInfo(16000, 2, 16));
+  TEST_ASSERT_FALSE(unbuffered.isStretching());
+  stretchAll(unbuffered, pcm, 2);
+  TEST_ASSERT_EQUAL_INT16_ARRAY(pcm.data(), bare.samples.data(), pcm.size());
+
+  CaptureSink sink;
+  TimeStretchStage stage(sink);
+  stage.setWorkBuffer(work.data(), work.size());
+  stage.setAudioInfo(AudioInfo(16000, 2, 16));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, stage.speed());
+  stretchAll(stage, pcm, 2);
+  TEST_ASSERT_EQUAL(pcm.size(), sink.samples.size());
+  TEST_ASSERT_EQUAL_INT16_ARRAY(pcm.data(), sink.samples.data(), pcm.size());
+
+  // Out of range speeds are clamped
+  stage.setSpeed(0.1f);
+  TEST_ASSERT_EQUAL_FLOAT(TimeStretchStage::MIN_SPEED, stage.speed());
+  stage.setSpeed(4.0f);
+  TEST_ASSERT_EQUAL_FLOAT(TimeStretchStage::MAX_SPEED, stage.speed());
+}
+
+void test_time_stretch_length_and_pitch(void) {
+  const float speeds[] = {0.75f, 0.875f, 1.25f, 1.5f};
+  const uint32_t rates[] = {16000, 24000, 44100};
+  std::vector<int16_t> work(TimeStretchStage::WORK_SAMPLES);
+  for (uint8_t channels = 1; channels <= 2; channels++) {
+    for (uint32_t rate : rates) {
+      const size_t frames = rate * 2;
+      std::vector<int16_t> pcm = sinePcm(frames, channels, rate, 220.0f);
+      size_t inCrossings = zeroCrossings(pcm.data(), frames, channels);
+      for (float speed : speeds) {
+        CaptureSink sink;
+        TimeStretchStage stage(sink);
+        stage.setWorkBuffer(work.data(), work.size());
+        stage.setSpeed(speed);
+        stage.setAudioInfo(AudioInfo(rate, channels, 16));
+        stretchAll(stage, pcm, channels);
+
+        size_t outFrames = sink.samples.size() / channels;
+        size_t overlap = rate * TimeStretchStage::OVERLAP_MS / 1000;
+        TEST_ASSERT_INT_WITHIN((int)(3 * overlap), (int)(frames / speed), (int)outFrames);
+
+        // Same tone: crossings per frame match the input within 2%
+        double inRate = (double)inCrossings / frames;
+        double outRate = (double)zeroCrossings(sink.samples.data(), outFrames, channels) / outFrames;
+        TEST_ASSERT_TRUE(fabs(outRate - inRate) / inRate < 0.02);
+      }
+    }
+  }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_upmix_matches_reference);
+  RUN_TEST(test_resampler_matches_reference);
+  RUN_TEST(test_codec_rate_selection);
+  RUN_TEST(test_output_stage_formats);
+  RUN_TEST(test_dsp_kernels_match_reference);
+  RUN_TEST(test_soft_clip_curve);
+  RUN_TEST(test_gain_ramp);
+  RUN_TEST(test_ui_mixer_over_speech);
+  RUN_TEST(test_ui_mixer_pump_and_voice_limit);
+  RUN_TEST(test_ui_mixer_not_metered);
+  RUN_TEST(test_time_stretch_passthrough);
+  RUN_TEST(test_time_stretch_length_and_pitch);
+  return UNITY_END();
+}
@@ -0,0 +1,180 @@
+// Host tests for the event trace format and player in lib/core_replay.
+//
+//   pio test -e native -f test_native_event_trace
+#include "core_replay/event_trace.h"
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+using namespace dict;
+
+// What are tested here:
+// Round trip: key, function key and response records read back exactly as written, in order.
+void test_trace_round_trip(void);
+// Bad files: a missing file or a foreign header does not open; a truncated record ends the trace.
+void test_trace_rejects_bad_files(void);
+// Player pace: input is due at record time / speed after the first input record (1x and 4x).
+void test_player_pace(void);
+// Player as fast as possible: speed 0 delivers everything, at most MAX_PER_POLL per poll.
+void test_player_unpaced_batches(void);
+// Player responses: every response is available from the start, even those recorded late.
+void test_player_responses(void);
+
+static const char *TRACE_PATH = "test_event_trace.trc";
+
+static void writeSampleTrace() {
+  EventTraceWriter writer;
+  TEST_ASSERT_TRUE(writer.open(TRACE_PATH));
+  TEST_ASSERT_TRUE(writer.writeKey(1000, 'h', 0x0B, 0));
+  TEST_ASSERT_TRUE(writer.writeKey(1200, 'I', 0x0C, 0x02));
+  TEST_ASSERT_TRUE(writer.writeFunctionKey(5000, 11, 3));
+  TEST_ASSERT_TRUE(writer.writeKey(9000, '\n', 0x28, 0, false));
+  TEST_ASSERT_TRUE(writer.writeResponse(250000, "hi", "{\"word\":\"hi\",\"explanation\":\"a greeting\"}"));
+  TEST_ASSERT_EQUAL_UINT32(5, writer.getRecordCount());
+  writer.close();
+}
+
+// =================================== TESTS ===================================
+void test_trace_round_trip(void) {
+  writeSampleTrace();
+  EventTraceReader reader;
+  TEST_ASSERT_TRUE(reader.open(TRACE_PATH));
+  TraceRecord record;
+
+  TEST_ASSERT_TRUE(reader.next(record));
+  TEST_ASSERT_EQUAL(TraceRecord::Key, record.kind);
+  TEST_ASSERT_EQUAL_UINT32(1000, record.timeUs);
+  TEST_ASSERT_EQUAL('h', (char)record.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x0B, record.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(1, record.data[3]);
+
+  TEST_ASSERT_TRUE(reader.next(record));
+  TEST_ASSERT_EQUAL_UINT8(0x02, record.data[2]);
+
+  TEST_ASSERT_TRUE(reader.next(record));
+  TEST_ASSERT_EQUAL(TraceRecord::FunctionKey, record.kind);
+  TEST_ASSERT_EQUAL_UINT8(11, record.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(3, record.data[1]);
+
+  TEST_ASSERT_TRUE(reader.next(record));
+  TEST_ASSERT_EQUAL('\n', (char)record.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(0, record.data[3]); // release
+
+  TEST_ASSERT_TRUE(reader.next(record));
+  TEST_ASSERT_EQUAL(TraceRecord::Response, record.kind);
+  TEST_ASSERT_EQUAL_STRING("hi", record.key.c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"word\":\"hi\",\"explanation\":\"a greeting\"}", record.body.c_str());
+
+  TEST_ASSERT_FALSE(reader.next(record));
+  TEST_ASSERT_TRUE(reader.rewind());
+  TEST_ASSERT_TRUE(reader.next(record));
+  TEST_ASSERT_EQUAL_UINT32(1000, record.timeUs);
+}
+
+void test_trace_rejects_bad_files(void) {
+  EventTraceReader reader;
+  TEST_ASSERT_FALSE(reader.open("no_such_trace.trc"));
+
+  FILE *file = fopen(TRACE_PATH, "wb");
+  fputs("RIFF....", file);
+  fclose(file);
+  TEST_ASSERT_FALSE(reader.open(TRACE_PATH));
+
+  // Cut the sample in the middle of its last record
+  writeSampleTrace();
+  file = fopen(TRACE_PATH, "rb");
+  std::vector<char> bytes(4096);
+  size_t size = fread(bytes.data(), 1, bytes.size(), file);
+  fclose(file);
+  file = fopen(TRACE_PATH, "wb");
+  fwrite(bytes.data(), 1, size - 5, file);
+  fclose(file);
+
+  TEST_ASSERT_TRUE(reader.open(TRACE_PATH));
+  TraceRecord record;
+  int records = 0;
+  while (reader.next(record)) {
+    records++;
+  }
+  TEST_ASSERT_EQUAL(4, records);
+}
+
+void test_player_pace(void) {
+  writeSampleTrace();
+  std::vector<uint32_t> times;
+  auto collect = [&](const TraceRecord &record) { times.push_back(record.timeUs); };
+
+  // 1x: the first input is due at once, the others at their offset from it
+  TracePlayer player;
+  TEST_ASSERT_TRUE(player.open(TRACE_PATH, 1.0f, 100));
+  TEST_ASSERT_TRUE(player.poll(100, collect));
+  TEST_ASSERT_EQUAL(1, times.size());
+  TEST_ASSERT_TRUE(player.poll(100 + 199, collect));
+  TEST_ASSERT_EQUAL(1, times.size());
+  TEST_ASSERT_TRUE(player.poll(100 + 200, collect));
+  TEST_ASSERT_EQUAL(2, times.size());
+  TEST_ASSERT_TRUE(player.poll(100 + 4000, collect));
+  TEST_ASSERT_EQUAL(3, times.size());
+  TEST_ASSERT_FALSE(player.poll(100 + 8000, collect)); // the response is not input
+  TEST_ASSERT_EQUAL(4, times.size());
+  TEST_ASSERT_EQUAL_UINT32(4, player.getDeliveredCount());
+
+  // 4x: the last input (8 ms after the first) is due after 2 ms
+  times.clear();
+  TEST_ASSERT_TRUE(player.open(TRACE_PATH, 4.0f, 0));
+  player.poll(1999, collect);
+  TEST_ASSERT_EQUAL(3, times.size());
+  TEST_ASSERT_FALSE(player.poll(2000, collect));
+  TEST_ASSERT_EQUAL(4, times.size());
+}
+
+void test_player_unpaced_batches(void) {
+  EventTraceWriter writer;
+  TEST_ASSERT_TRUE(writer.open(TRACE_PATH));
+  for (uint32_t i = 0; i < 20; i++) {
+    writer.writeKey(i * 100000, 'a', 0x04, 0);
+  }
+  writer.close();
+
+  TracePlayer player;
+  TEST_ASSERT_TRUE(player.open(TRACE_PATH, 0.0f, 0));
+  int delivered = 0;
+  int polls = 0;
+  bool more = true;
+  while (more) {
+    int before = delivered;
+    more = player.poll(0, [&](const TraceRecord &) { delivered++; });
+    TEST_ASSERT_TRUE(delivered - before <= (int)TracePlayer::MAX_PER_POLL);
+    polls++;
+  }
+  TEST_ASSERT_EQUAL(20, delivered);
+  TEST_ASSERT_EQUAL(3, polls);
+}
+
+void test_player_responses(void) {
+  writeSampleTrace();
+  TracePlayer player;
+  TEST_ASSERT_TRUE(player.open(TRACE_PATH, 1.0f, 0));
+  TEST_ASSERT_EQUAL(1, player.getResponseCount());
+  std::string body;
+  TEST_ASSERT_TRUE(player.response("hi", body));
+  TEST_ASSERT_EQUAL_STRING("{\"word\":\"hi\",\"explanation\":\"a greeting\"}", body.c_str());
+  TEST_ASSERT_FALSE(player.response("bye", body));
+  player.close();
+  TEST_ASSERT_FALSE(player.response("hi", body));
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_trace_round_trip);
+  RUN_TEST(test_trace_rejects_bad_files);
+  RUN_TEST(test_player_pace);
+  RUN_TEST(test_player_unpaced_batches);
+  RUN_TEST(test_player_responses);
+  remove(TRACE_PATH);
+  return UNITY_END();
+}
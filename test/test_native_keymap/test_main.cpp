@@ -0,0 +1,206 @@
+// Host tests for the keyboard layout tables and function key map in lib/core_keymap.
+//
+//   pio test -e native -f test_native_keymap
+#include "core_keymap/function_key_map.h"
+#include "core_keymap/keyboard_layout.h"
+#include <string.h>
+#include <unity.h>
+
+using namespace dict;
+
+// What are tested here:
+// Every layout: only ASCII, each letter once per plane, Shift of a letter is its capital, common keys the same.
+void test_layouts_well_formed(void);
+// US: the whole table against the keycaps; Non-US # (0x32) is backslash and grave (0x35) is backtick.
+void test_layout_us(void);
+// UK, DE, FR, Dvorak: moved letters and symbols, AltGr plane, non-ASCII keys give 0.
+void test_layouts_national(void);
+// CapsLock flips Shift for letters only; Right Alt is ignored on layouts without AltGr.
+void test_layout_caps_lock_and_alt(void);
+// Lookup by name, case-insensitive; unknown ids fall back to US.
+void test_layout_find_by_name(void);
+// Function keys: defaults, remap, unbind, reset.
+void test_function_key_remap(void);
+// Function keys: format() writes only remapped keys, parse() reads them back, bad entries are skipped.
+void test_function_key_format_parse(void);
+
+static const uint8_t KEY_A = 0x04; // HID usage of the key labelled A on US keycaps
+static uint8_t letterKey(char usKeycap) { return KEY_A + (usKeycap - 'a'); }
+
+static char type(LayoutId id, uint8_t keyCode, uint8_t modifiers = 0, bool caps = false) {
+  return translateKey(getKeyboardLayout(id), keyCode, modifiers, caps);
+}
+
+// =================================== TESTS ===================================
+void test_layouts_well_formed(void) {
+  for (size_t i = 0; i < (size_t)LayoutId::COUNT; i++) {
+    const KeyboardLayout &layout = getKeyboardLayout((LayoutId)i);
+    for (int plane = 0; plane < KeyboardLayout::PLANES; plane++) {
+      int letters[26] = {};
+      for (int keyCode = 0; keyCode < KeyboardLayout::KEY_COUNT; keyCode++) {
+        char c = layout.keys[plane][keyCode];
+        TEST_ASSERT_TRUE(c == 0 || c == '\n' || c == '\t' || c == 0x08 || (c >= 32 && c <= 126));
+        if (plane == KeyboardLayout::Base && c >= 'a' && c <= 'z') {
+          letters[c - 'a']++;
+          TEST_ASSERT_EQUAL(c - 'a' + 'A', layout.keys[KeyboardLayout::Shift][keyCode]);
+        }
+      }
+      if (plane == KeyboardLayout::Base) {
+        for (int l = 0; l < 26; l++) {
+          TEST_ASSERT_EQUAL(1, letters[l]);
+        }
+      }
+      if (plane != KeyboardLayout::AltGr || layout.hasAltGr) {
+        TEST_ASSERT_EQUAL('\n', layout.keys[plane][0x28]);
+        TEST_ASSERT_EQUAL(0, layout.keys[plane][0x29]); // Escape is a function key
+        TEST_ASSERT_EQUAL(0x08, layout.keys[plane][0x2A]);
+        TEST_ASSERT_EQUAL(' ', layout.keys[plane][0x2C]);
+      }
+    }
+    TEST_ASSERT_EQUAL(0, type((LayoutId)i, 0x3A)); // F1
+    TEST_ASSERT_EQUAL(0, type((LayoutId)i, 0xE1)); // beyond the table
+  }
+}
+
+void test_layout_us(void) {
+  const char *base = "abcdefghijklmnopqrstuvwxyz1234567890\n\0\b\t -=[]\\\\;'`,./";
+  const char *shift = "ABCDEFGHIJKLMNOPQRSTUVWXYZ!@#$%^&*()\n\0\b\t _+{}||:\"~<>?";
+  for (uint8_t keyCode = 0x04; keyCode <= 0x38; keyCode++) {
+    TEST_ASSERT_EQUAL(base[keyCode - 0x04], type(LayoutId::US, keyCode));
+    TEST_ASSERT_EQUAL(shift[keyCode - 0x04], type(LayoutId::US, keyCode, HID_MOD_LEFT_SHIFT));
+    TEST_ASSERT_EQUAL(shift[keyCode - 0x04], type(LayoutId::US, keyCode, HID_MOD_RIGHT_SHIFT));
+  }
+  TEST_ASSERT_EQUAL('\\', type(LayoutId::US, 0x32));
+  TEST_ASSERT_EQUAL('`', type(LayoutId::US, 0x35));
+  TEST_ASSERT_EQUAL('<', type(LayoutId::US, 0x64));
+}
+
+void test_layouts_national(void) {
+  // UK: # next to Enter, " on Shift+2, no ASCII for £ and ¬
+  TEST_ASSERT_EQUAL('#', type(LayoutId::UK, 0x32));
+  TEST_ASSERT_EQUAL('~', type(LayoutId::UK, 0x32, HID_MOD_LEFT_SHIFT));
+  TEST_ASSERT_EQUAL('"', type(LayoutId::UK, 0x1F, HID_MOD_LEFT_SHIFT));
+  TEST_ASSERT_EQUAL('@', type(LayoutId::UK, 0x34, HID_MOD_LEFT_SHIFT));
+  TEST_ASSERT_EQUAL(0, type(LayoutId::UK, 0x20, HID_MOD_LEFT_SHIFT));
+  TEST_ASSERT_EQUAL('\\', type(LayoutId::UK, 0x64));
+
+  // DE: QWERTZ, AltGr symbols, umlauts and ß give nothing
+  TEST_ASSERT_EQUAL('z', type(LayoutId::DE, letterKey('y')));
+  TEST_ASSERT_EQUAL('y', type(LayoutId::DE, letterKey('z')));
+  TEST_ASSERT_EQUAL('@', type(LayoutId::DE, letterKey('q'), HID_MOD_RIGHT_ALT));
+  TEST_ASSERT_EQUAL('{', type(LayoutId::DE, 0x24, HID_MOD_RIGHT_ALT));
+  TEST_ASSERT_EQUAL('\\', type(LayoutId::DE, 0x2D, HID_MOD_RIGHT_ALT));
+  TEST_ASSERT_EQUAL('|', type(LayoutId::DE, 0x64, HID_MOD_RIGHT_ALT));
+  TEST_ASSERT_EQUAL(0, type(LayoutId::DE, letterKey('e'), HID_MOD_RIGHT_ALT)); // €
+  TEST_ASSERT_EQUAL('-', type(LayoutId::DE, 0x38));
+  TEST_ASSERT_EQUAL('=', type(LayoutId::DE, 0x27, HID_MOD_LEFT_SHIFT));
+  TEST_ASSERT_EQUAL(0, type(LayoutId::DE, 0x33)); // ö
+  TEST_ASSERT_EQUAL(0, type(LayoutId::DE, 0x2D)); // ß
+
+  // FR: AZERTY, digits on Shift, M right of L
+  TEST_ASSERT_EQUAL('a', type(LayoutId::FR, letterKey('q')));
+  TEST_ASSERT_EQUAL('q', type(LayoutId::FR, letterKey('a')));
+  TEST_ASSERT_EQUAL('w', type(LayoutId::FR, letterKey('z')));
+  TEST_ASSERT_EQUAL('m', type(LayoutId::FR, 0x33));
+  TEST_ASSERT_EQUAL(',', type(LayoutId::FR, letterKey('m')));
+  TEST_ASSERT_EQUAL('&', type(LayoutId::FR, 0x1E));
+  TEST_ASSERT_EQUAL('1', type(LayoutId::FR, 0x1E, HID_MOD_LEFT_SHIFT));
+  TEST_ASSERT_EQUAL(0, type(LayoutId::FR, 0x1F)); // é
+  TEST_ASSERT_EQUAL('@', type(LayoutId::FR, 0x27, HID_MOD_RIGHT_ALT));
+
+  // Dvorak: home row
+  const char *home = "asdfghjkl";
+  const char *expected = "aoeuidhtn";
+  for (int i = 0; home[i]; i++) {
+    TEST_ASSERT_EQUAL(expected[i], type(LayoutId::Dvorak, letterKey(home[i])));
+  }
+  TEST_ASSERT_EQUAL('s', type(LayoutId::Dvorak, 0x33));
+  TEST_ASSERT_EQUAL('"', type(LayoutId::Dvorak, letterKey('q'), HID_MOD_LEFT_SHIFT));
+}
+
+void test_layout_caps_lock_and_alt(void) {
+  TEST_ASSERT_EQUAL('A', type(LayoutId::US, KEY_A, 0, true));
+  TEST_ASSERT_EQUAL('a', type(LayoutId::US, KEY_A, HID_MOD_LEFT_SHIFT, true));
+  TEST_ASSERT_EQUAL('1', type(LayoutId::US, 0x1E, 0, true));
+  TEST_ASSERT_EQUAL('M', type(LayoutId::FR, 0x33, 0, true));
+  TEST_ASSERT_EQUAL(',', type(LayoutId::FR, letterKey('m'), 0, true));
+  TEST_ASSERT_EQUAL('&', type(LayoutId::FR, 0x1E, 0, true));
+  TEST_ASSERT_EQUAL('a', type(LayoutId::US, KEY_A, HID_MOD_RIGHT_ALT));
+  TEST_ASSERT_EQUAL('A', type(LayoutId::UK, KEY_A, HID_MOD_RIGHT_ALT | HID_MOD_LEFT_SHIFT));
+}
+
+void test_layout_find_by_name(void) {
+  LayoutId id = LayoutId::US;
+  TEST_ASSERT_TRUE(findKeyboardLayout("dvorak", id));
+  TEST_ASSERT_EQUAL((int)LayoutId::Dvorak, (int)id);
+  TEST_ASSERT_TRUE(findKeyboardLayout("De", id));
+  TEST_ASSERT_EQUAL((int)LayoutId::DE, (int)id);
+  TEST_ASSERT_FALSE(findKeyboardLayout("D", id));
+  TEST_ASSERT_FALSE(findKeyboardLayout("colemak", id));
+  TEST_ASSERT_FALSE(findKeyboardLayout(nullptr, id));
+  TEST_ASSERT_EQUAL_STRING("US", getKeyboardLayout((LayoutId)200).name);
+}
+
+static constexpr FunctionKeyMap::Binding BINDINGS[] = {{0x3A, 4}, {0x3B, 5}, {0x4F, 15}};
+static constexpr FunctionKeyMap::Table DEFAULTS = FunctionKeyMap::makeFunctionKeyTable(BINDINGS);
+
+void test_function_key_remap(void) {
+  FunctionKeyMap map(DEFAULTS);
+  TEST_ASSERT_EQUAL_UINT8(4, map.lookup(0x3A));
+  TEST_ASSERT_EQUAL_UINT8(15, map.lookup(0x4F));
+  TEST_ASSERT_EQUAL_UINT8(0, map.lookup(0x04));
+  TEST_ASSERT_FALSE(map.isRemapped());
+
+  map.remap(0x3A, 5);
+  map.remap(0x4F, 0);
+  map.remap(0x44, 9);
+  TEST_ASSERT_EQUAL_UINT8(5, map.lookup(0x3A));
+  TEST_ASSERT_EQUAL_UINT8(0, map.lookup(0x4F));
+  TEST_ASSERT_EQUAL_UINT8(9, map.lookup(0x44));
+  TEST_ASSERT_TRUE(map.isRemapped());
+
+  map.reset();
+  TEST_ASSERT_EQUAL_UINT8(4, map.lookup(0x3A));
+  TEST_ASSERT_EQUAL_UINT8(0, map.lookup(0x44));
+  TEST_ASSERT_FALSE(map.isRemapped());
+}
+
+void test_function_key_format_parse(void) {
+  FunctionKeyMap map(DEFAULTS);
+  char text[64];
+  TEST_ASSERT_EQUAL_UINT32(0, map.format(text, sizeof(text)));
+  TEST_ASSERT_EQUAL_STRING("", text);
+
+  map.remap(0x3A, 5);
+  map.remap(0x4F, 0);
+  TEST_ASSERT_EQUAL_UINT32(strlen("3a=5,4f=0"), map.format(text, sizeof(text)));
+  TEST_ASSERT_EQUAL_STRING("3a=5,4f=0", text);
+  TEST_ASSERT_EQUAL_UINT32(0, map.format(text, 6)); // does not fit
+
+  FunctionKeyMap copy(DEFAULTS);
+  TEST_ASSERT_EQUAL_UINT32(2, copy.parse("3a=5,4f=0"));
+  TEST_ASSERT_EQUAL_UINT8(5, copy.lookup(0x3A));
+  TEST_ASSERT_EQUAL_UINT8(0, copy.lookup(0x4F));
+
+  copy.reset();
+  TEST_ASSERT_EQUAL_UINT32(1, copy.parse("zz=1,3b,100=2,3b=300,44=7"));
+  TEST_ASSERT_EQUAL_UINT8(7, copy.lookup(0x44));
+  TEST_ASSERT_EQUAL_UINT8(5, copy.lookup(0x3B));
+  TEST_ASSERT_EQUAL_UINT32(0, copy.parse(""));
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_layouts_well_formed);
+  RUN_TEST(test_layout_us);
+  RUN_TEST(test_layouts_national);
+  RUN_TEST(test_layout_caps_lock_and_alt);
+  RUN_TEST(test_layout_find_by_name);
+  RUN_TEST(test_function_key_remap);
+  RUN_TEST(test_function_key_format_parse);
+  return UNITY_END();
+}